@@ -135,20 +135,7 @@ jsg::Promise<jsg::Value> DurableObjectStorageOperations::get(
   KJ_UNREACHABLE
 }
 
-jsg::Value listResultsToMap(v8::Isolate* isolate, ActorCacheOps::GetResultList value, bool completelyCached) {
-  v8::HandleScope scope(isolate);
-  auto context = isolate->GetCurrentContext();
-
-  auto map = v8::Map::New(isolate);
-  size_t cachedReadBytes = 0;
-  size_t uncachedReadBytes = 0;
-  for (auto entry: value) {
-    auto& bytesRef = entry.status == ActorCacheOps::CacheStatus::CACHED
-                   ? cachedReadBytes : uncachedReadBytes;
-    bytesRef += entry.key.size() + entry.value.size();
-    jsg::check(map->Set(context, jsg::v8Str(isolate, entry.key),
-        deserializeV8Value(entry.key, entry.value, isolate)));
-  }
+void addListReadUnits(size_t cachedReadBytes, size_t uncachedReadBytes, bool completelyCached) {
   auto& actorMetrics = currentActorMetrics();
   if (cachedReadBytes || uncachedReadBytes) {
     size_t totalReadBytes = cachedReadBytes + uncachedReadBytes;
@@ -167,10 +154,49 @@ jsg::Value listResultsToMap(v8::Isolate* isolate, ActorCacheOps::GetResultList v
     // We bill 1 uncached read unit if there was no results from the list.
     actorMetrics.addUncachedStorageReadUnits(1);
   }
+}
+
+jsg::Value listResultsToMap(v8::Isolate* isolate, ActorCacheOps::GetResultList value, bool completelyCached) {
+  v8::HandleScope scope(isolate);
+  auto context = isolate->GetCurrentContext();
+
+  auto map = v8::Map::New(isolate);
+  size_t cachedReadBytes = 0;
+  size_t uncachedReadBytes = 0;
+  for (auto entry: value) {
+    auto& bytesRef = entry.status == ActorCacheOps::CacheStatus::CACHED
+                   ? cachedReadBytes : uncachedReadBytes;
+    bytesRef += entry.key.size() + entry.value.size();
+    jsg::check(map->Set(context, jsg::v8Str(isolate, entry.key),
+        deserializeV8Value(entry.key, entry.value, isolate)));
+  }
+  addListReadUnits(cachedReadBytes, uncachedReadBytes, completelyCached);
 
   return jsg::Value(isolate, map);
 }
 
+void addGetMultipleReadUnits(uint32_t cachedUnits, uint32_t uncachedUnits,
+                             size_t numInputKeys, size_t numResults) {
+  auto& actorMetrics = currentActorMetrics();
+  actorMetrics.addCachedStorageReadUnits(cachedUnits);
+
+  size_t leftoverKeys = 0;
+  if (numInputKeys >= numResults) {
+    leftoverKeys = numInputKeys - numResults;
+  } else {
+    KJ_LOG(ERROR, "More returned pairs than provided input keys in getMultipleResultsToMap",
+        numInputKeys, numResults);
+  }
+
+  // leftover keys weren't in the result set, but potentially still
+  // had to be queried for existence.
+  //
+  // TODO(someday): This isn't quite accurate -- we do cache negative entries.
+  // Billing will still be correct today, but if we do ever start billing
+  // only for uncached reads, we'll need to address this.
+  actorMetrics.addUncachedStorageReadUnits(leftoverKeys + uncachedUnits);
+}
+
 kj::Function<jsg::Value(v8::Isolate*, ActorCacheOps::GetResultList)> getMultipleResultsToMap(
     size_t numInputKeys) {
   return [numInputKeys](v8::Isolate* isolate, ActorCacheOps::GetResultList value) mutable {
@@ -187,24 +213,7 @@ kj::Function<jsg::Value(v8::Isolate*, ActorCacheOps::GetResultList)> getMultiple
       jsg::check(map->Set(context, jsg::v8Str(isolate, entry.key),
           deserializeV8Value(entry.key, entry.value, isolate)));
     }
-    auto& actorMetrics = currentActorMetrics();
-    actorMetrics.addCachedStorageReadUnits(cachedUnits);
-
-    size_t leftoverKeys = 0;
-    if (numInputKeys >= value.size()) {
-      leftoverKeys = numInputKeys - value.size();
-    } else {
-      KJ_LOG(ERROR, "More returned pairs than provided input keys in getMultipleResultsToMap",
-          numInputKeys, value.size());
-    }
-
-    // leftover keys weren't in the result set, but potentially still
-    // had to be queried for existence.
-    //
-    // TODO(someday): This isn't quite accurate -- we do cache negative entries.
-    // Billing will still be correct today, but if we do ever start billing
-    // only for uncached reads, we'll need to address this.
-    actorMetrics.addUncachedStorageReadUnits(leftoverKeys + uncachedUnits);
+    addGetMultipleReadUnits(cachedUnits, uncachedUnits, numInputKeys, value.size());
 
     return jsg::Value(isolate, map);
   };
@@ -214,7 +223,23 @@ jsg::Promise<jsg::Value> DurableObjectStorageOperations::getOne(
     kj::String key, const GetOptions& options, v8::Isolate* isolate) {
   ActorStorageLimits::checkMaxKeySize(key);
 
-  auto result = getCache(OP_GET).get(kj::str(key), options);
+  auto& cache = getCache(OP_GET);
+  KJ_IF_MAYBE(direct, cache.getDirectReader()) {
+    // Deserialize straight out of storage, if supported. Direct reads are always synchronous, so
+    // they are billed as cached, same as a synchronous result from get() would be.
+    v8::Local<v8::Value> value = v8::Undefined(isolate);
+    uint32_t units = 1;
+    auto found = direct->getDirect(key, options, [&](ActorCacheOps::ValuePtr bytes) {
+      units = billingUnits(bytes.size());
+      value = deserializeV8Value(key, bytes, isolate);
+    });
+    if (found != nullptr) {
+      currentActorMetrics().addCachedStorageReadUnits(units);
+      return jsg::resolvedPromise(isolate, jsg::Value(isolate, value));
+    }
+  }
+
+  auto result = cache.get(kj::str(key), options);
   return transformCacheResultWithCacheStatus(isolate, kj::mv(result), options,
       [key = kj::mv(key)](v8::Isolate* isolate, kj::Maybe<ActorCacheOps::Value> value, bool cached) {
     uint32_t units = 1;
@@ -354,9 +379,30 @@ jsg::Promise<jsg::Value> DurableObjectStorageOperations::list(
   auto options = configureOptions(kj::mv(maybeOptions).orDefault(ListOptions{}));
   ActorCacheOps::ReadOptions readOptions = options;
 
+  auto& cache = getCache(OP_LIST);
+  KJ_IF_MAYBE(direct, cache.getDirectReader()) {
+    v8::HandleScope scope(isolate);
+    auto context = isolate->GetCurrentContext();
+    auto map = v8::Map::New(isolate);
+    size_t readBytes = 0;
+    auto callback = [&](ActorCacheOps::KeyPtr key, ActorCacheOps::ValuePtr value) {
+      readBytes += key.size() + value.size();
+      jsg::check(map->Set(context, jsg::v8Str(isolate, key),
+          deserializeV8Value(key, value, isolate)));
+    };
+    auto endPtr = end.map([](kj::String& e) -> ActorCacheOps::KeyPtr { return e; });
+    auto count = reverse
+        ? direct->listReverseDirect(start, endPtr, limit, readOptions, callback)
+        : direct->listDirect(start, endPtr, limit, readOptions, callback);
+    if (count != nullptr) {
+      addListReadUnits(readBytes, 0, true);
+      return jsg::resolvedPromise(isolate, jsg::Value(isolate, map));
+    }
+  }
+
   auto result = reverse
-      ? getCache(OP_LIST).listReverse(kj::mv(start), kj::mv(end), limit, readOptions)
-      : getCache(OP_LIST).list(kj::mv(start), kj::mv(end), limit, readOptions);
+      ? cache.listReverse(kj::mv(start), kj::mv(end), limit, readOptions)
+      : cache.list(kj::mv(start), kj::mv(end), limit, readOptions);
   return transformCacheResultWithCacheStatus(isolate, kj::mv(result), options, &listResultsToMap);
 }
 
@@ -522,7 +568,25 @@ jsg::Promise<jsg::Value> DurableObjectStorageOperations::getMultiple(
 
   auto numKeys = keys.size();
 
-  return transformCacheResult(isolate, getCache(OP_GET).get(kj::mv(keys), options),
+  auto& cache = getCache(OP_GET);
+  KJ_IF_MAYBE(direct, cache.getDirectReader()) {
+    v8::HandleScope scope(isolate);
+    auto context = isolate->GetCurrentContext();
+    auto map = v8::Map::New(isolate);
+    uint32_t units = 0;
+    auto count = direct->getDirect(keys, options,
+        [&](ActorCacheOps::KeyPtr key, ActorCacheOps::ValuePtr value) {
+      units += billingUnits(key.size() + value.size());
+      jsg::check(map->Set(context, jsg::v8Str(isolate, key),
+          deserializeV8Value(key, value, isolate)));
+    });
+    KJ_IF_MAYBE(c, count) {
+      addGetMultipleReadUnits(units, 0, numKeys, *c);
+      return jsg::resolvedPromise(isolate, jsg::Value(isolate, map));
+    }
+  }
+
+  return transformCacheResult(isolate, cache.get(kj::mv(keys), options),
                               options, getMultipleResultsToMap(numKeys));
 }
 
@@ -42,6 +42,33 @@ export default {
       reader.releaseLock();
     }
 
+    {
+      // Blobs composed of other Blobs, and slices spanning several of their parts.
+      let parts = [];
+      for (let i = 0; i < 100; i++) {
+        parts.push(new Blob([`${i % 10}`]));
+      }
+      let rope = new Blob([new Blob(parts), "-", new Blob(parts)]);
+      let expected = "0123456789".repeat(10) + "-" + "0123456789".repeat(10);
+      assertEqual(rope.size, 201);
+      assertEqual(await rope.text(), expected);
+      assertEqual(new TextDecoder().decode(await rope.arrayBuffer()), expected);
+      assertEqual(await rope.slice(95, 107).text(), expected.slice(95, 107));
+      assertEqual(await rope.slice(95, 107).slice(3, -3).text(), expected.slice(98, 104));
+      assertEqual(await new Blob([rope.slice(99, 102), rope.slice(0, 1)]).text(), "9-00");
+
+      // Streaming walks the segments.
+      let reader = rope.slice(5, 196).stream().getReader();
+      let chunks = [];
+      for (;;) {
+        let readResult = await reader.read();
+        if (readResult.done) break;
+        chunks.push(new TextDecoder().decode(readResult.value));
+      }
+      assertEqual(chunks.join(""), expected.slice(5, 196));
+      assertEqual(await new Response(rope.slice(5, 196)).text(), expected.slice(5, 196));
+    }
+
     let before = Date.now();
 
     let file = new File([blob, "qux"], "filename.txt");
@@ -7,53 +7,97 @@
 
 namespace workerd::api {
 
-static kj::Array<byte> concat(jsg::Optional<Blob::Bits> maybeBits) {
-  // Concatenate an array of segments (parameter to Blob constructor).
-  //
-  // TODO(perf): Make it so that a Blob can keep references to the input data rather than copy it.
-  //   Note that we can't keep references to ArrayBuffers since they are mutable, but we can
-  //   reference other Blobs in the input.
+void Blob::Rope::addOwned(kj::Array<byte> bytes) {
+  auto segment = bytes.asPtr();
+  addOwned(kj::mv(bytes), segment);
+}
 
-  auto bits = kj::mv(maybeBits).orDefault(nullptr);
+void Blob::Rope::addOwned(kj::Array<byte> bytes, kj::ArrayPtr<const byte> segment) {
+  if (segment.size() == 0) return;
+  owners.add(kj::mv(bytes));
+  segments.add(segment);
+  size += segment.size();
+}
 
-  size_t size = 0;
-  for (auto& part: bits) {
-    KJ_SWITCH_ONEOF(part) {
-      KJ_CASE_ONEOF(bytes, kj::Array<const byte>) {
-        size += bytes.size();
-      }
-      KJ_CASE_ONEOF(text, kj::String) {
-        size += text.size();
-      }
-      KJ_CASE_ONEOF(blob, jsg::Ref<Blob>) {
-        size += blob->getData().size();
-      }
+void Blob::Rope::addBlob(jsg::Ref<Blob> blob, size_t start, size_t end) {
+  if (start >= end) return;
+
+  size_t offset = 0;
+  for (auto segment: blob->content.segments) {
+    size_t segmentEnd = offset + segment.size();
+    if (segmentEnd > start && offset < end) {
+      auto piece = segment.slice(kj::max(start, offset) - offset,
+                                 kj::min(end, segmentEnd) - offset);
+      segments.add(piece);
+      size += piece.size();
     }
+    if (segmentEnd >= end) break;
+    offset = segmentEnd;
   }
 
-  if (size == 0) return nullptr;
+  owners.add(kj::mv(blob));
+}
 
-  auto result = kj::heapArray<byte>(size);
-  byte* ptr = result.begin();
+static Blob::Rope concat(jsg::Optional<Blob::Bits> maybeBits) {
+  // Concatenate an array of segments (parameter to Blob constructor).
+  //
+  // We can't keep references to ArrayBuffers since they are mutable, so runs of them (and of
+  // strings) are copied into one buffer, but other Blobs are immutable and are referenced
+  // instead. A string on its own is already ours, so it is adopted without a copy.
 
-  for (auto& part: bits) {
-    KJ_SWITCH_ONEOF(part) {
-      KJ_CASE_ONEOF(bytes, kj::Array<const byte>) {
-        memcpy(ptr, bytes.begin(), bytes.size());
-        ptr += bytes.size();
-      }
-      KJ_CASE_ONEOF(text, kj::String) {
-        memcpy(ptr, text.begin(), text.size());
-        ptr += text.size();
+  auto bits = kj::mv(maybeBits).orDefault(nullptr);
+
+  Blob::Rope result;
+  for (size_t i = 0; i < bits.size();) {
+    KJ_IF_MAYBE(blob, bits[i].tryGet<jsg::Ref<Blob>>()) {
+      size_t size = (*blob)->getSize();
+      result.addBlob(kj::mv(*blob), 0, size);
+      ++i;
+      continue;
+    }
+
+    // Find the end of this run of parts that aren't Blobs.
+    size_t runEnd = i;
+    size_t runSize = 0;
+    for (; runEnd < bits.size(); ++runEnd) {
+      KJ_IF_MAYBE(bytes, bits[runEnd].tryGet<kj::Array<const byte>>()) {
+        runSize += bytes->size();
+      } else KJ_IF_MAYBE(text, bits[runEnd].tryGet<kj::String>()) {
+        runSize += text->size();
+      } else {
+        break;
       }
-      KJ_CASE_ONEOF(blob, jsg::Ref<Blob>) {
-        memcpy(ptr, blob->getData().begin(), blob->getData().size());
-        ptr += blob->getData().size();
+    }
+
+    if (runEnd == i + 1 && bits[i].is<kj::String>()) {
+      auto bytes = bits[i].get<kj::String>().releaseArray().releaseAsBytes();
+      auto segment = bytes.slice(0, runSize);
+      result.addOwned(kj::mv(bytes), segment);
+    } else if (runSize > 0) {
+      auto buffer = kj::heapArray<byte>(runSize);
+      byte* ptr = buffer.begin();
+      for (; i < runEnd; ++i) {
+        KJ_SWITCH_ONEOF(bits[i]) {
+          KJ_CASE_ONEOF(bytes, kj::Array<const byte>) {
+            memcpy(ptr, bytes.begin(), bytes.size());
+            ptr += bytes.size();
+          }
+          KJ_CASE_ONEOF(text, kj::String) {
+            memcpy(ptr, text.begin(), text.size());
+            ptr += text.size();
+          }
+          KJ_CASE_ONEOF(blob, jsg::Ref<Blob>) {
+            KJ_UNREACHABLE;
+          }
+        }
       }
+      KJ_ASSERT(ptr == buffer.end());
+      result.addOwned(kj::mv(buffer));
     }
+
+    i = runEnd;
   }
 
-  KJ_ASSERT(ptr == result.end());
   return result;
 }
 
@@ -73,6 +117,28 @@ static kj::String normalizeType(kj::String type) {
   return kj::mv(type);
 }
 
+Blob::Blob(kj::Array<byte> data, kj::String type): type(kj::mv(type)) {
+  content.addOwned(kj::mv(data));
+}
+
+kj::ArrayPtr<const byte> Blob::getData() const {
+  if (content.segments.size() == 0) {
+    return nullptr;
+  } else if (content.segments.size() == 1) {
+    return content.segments[0];
+  }
+
+  if (flattened == nullptr) {
+    flattened = kj::heapArray<byte>(content.size);
+    byte* ptr = flattened.begin();
+    for (auto segment: content.segments) {
+      memcpy(ptr, segment.begin(), segment.size());
+      ptr += segment.size();
+    }
+  }
+  return flattened;
+}
+
 jsg::Ref<Blob> Blob::constructor(jsg::Optional<Bits> bits, jsg::Optional<Options> options) {
   kj::String type;  // note: default value is intentionally empty string
   KJ_IF_MAYBE(o, options) {
@@ -86,59 +152,83 @@ jsg::Ref<Blob> Blob::constructor(jsg::Optional<Bits> bits, jsg::Optional<Options
 
 jsg::Ref<Blob> Blob::slice(jsg::Optional<int> maybeStart, jsg::Optional<int> maybeEnd,
                             jsg::Optional<kj::String> type) {
+  int size = content.size;
   int start = maybeStart.orDefault(0);
-  int end = maybeEnd.orDefault(data.size());
+  int end = maybeEnd.orDefault(size);
 
   if (start < 0) {
     // Negative value interpreted as offset from end.
-    start += data.size();
+    start += size;
   }
   // Clamp start to range.
   if (start < 0) {
     start = 0;
-  } else if (start > data.size()) {
-    start = data.size();
+  } else if (start > size) {
+    start = size;
   }
 
   if (end < 0) {
     // Negative value interpreted as offset from end.
-    end += data.size();
+    end += size;
   }
   // Clamp end to range.
   if (end < start) {
     end = start;
-  } else if (end > data.size()) {
-    end = data.size();
+  } else if (end > size) {
+    end = size;
   }
 
-  return jsg::alloc<Blob>(JSG_THIS, data.slice(start, end),
-      normalizeType(kj::mv(type).orDefault(nullptr)));
+  // The slice references our segments, so it costs O(segments) rather than O(bytes).
+  Rope rope;
+  rope.addBlob(JSG_THIS, start, end);
+  return jsg::alloc<Blob>(kj::mv(rope), normalizeType(kj::mv(type).orDefault(nullptr)));
 }
 
 jsg::Promise<kj::Array<kj::byte>> Blob::arrayBuffer(v8::Isolate* isolate) {
-  // TODO(perf): Find a way to avoid the copy.
-  return jsg::resolvedPromise(isolate, kj::heapArray<byte>(data));
+  // The ArrayBuffer is mutable, so it needs its own copy, but we gather the segments straight into
+  // it rather than flattening first.
+  auto result = kj::heapArray<byte>(content.size);
+  byte* ptr = result.begin();
+  for (auto segment: content.segments) {
+    memcpy(ptr, segment.begin(), segment.size());
+    ptr += segment.size();
+  }
+  return jsg::resolvedPromise(isolate, kj::mv(result));
 }
 jsg::Promise<kj::String> Blob::text(v8::Isolate* isolate) {
-  return jsg::resolvedPromise(isolate, kj::str(data.asChars()));
+  return jsg::resolvedPromise(isolate, kj::strArray(
+      KJ_MAP(segment, content.segments) { return segment.asChars(); }, ""));
 }
 
 class Blob::BlobInputStream final: public ReadableStreamSource {
 public:
   BlobInputStream(jsg::Ref<Blob> blob)
-      : unread(blob->data),
+      : unread(blob->content.segments.asPtr()),
+        unreadSize(blob->content.size),
         blob(kj::mv(blob)) {}
 
   kj::Promise<size_t> tryRead(void* buffer, size_t minBytes, size_t maxBytes) override {
-    size_t amount = kj::min(maxBytes, unread.size());
-    memcpy(buffer, unread.begin(), amount);
-    unread = unread.slice(amount, unread.size());
+    byte* out = reinterpret_cast<byte*>(buffer);
+    size_t amount = 0;
+    while (amount < maxBytes && unread.size() > 0) {
+      auto segment = unread[0].slice(offset, unread[0].size());
+      size_t n = kj::min(maxBytes - amount, segment.size());
+      memcpy(out + amount, segment.begin(), n);
+      amount += n;
+      if (n == segment.size()) {
+        unread = unread.slice(1, unread.size());
+        offset = 0;
+      } else {
+        offset += n;
+      }
+    }
+    unreadSize -= amount;
     return amount;
   }
 
   kj::Maybe<uint64_t> tryGetLength(StreamEncoding encoding) override {
     if (encoding == StreamEncoding::IDENTITY) {
-      return unread.size();
+      return unreadSize;
     } else {
       return nullptr;
     }
@@ -149,8 +239,13 @@ public:
       return addNoopDeferredProxy(kj::READY_NOW);
     }
 
-    auto promise = output.write(unread.begin(), unread.size());
+    // Write all the segments at once, without flattening them.
+    auto pieces = kj::heapArray(unread);
+    pieces[0] = pieces[0].slice(offset, pieces[0].size());
+    auto promise = output.write(pieces).attach(kj::mv(pieces));
     unread = nullptr;
+    offset = 0;
+    unreadSize = 0;
 
     if (end) {
       promise = promise.then([&output]() { return output.end(); });
@@ -162,7 +257,9 @@ public:
   }
 
 private:
-  kj::ArrayPtr<const byte> unread;
+  kj::ArrayPtr<const kj::ArrayPtr<const byte>> unread;
+  size_t offset = 0;  // bytes of unread[0] already read
+  size_t unreadSize;
   jsg::Ref<Blob> blob;
 };
 
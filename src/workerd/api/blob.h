@@ -12,12 +12,35 @@ namespace workerd::api {
 
 class Blob: public jsg::Object {
 public:
-  Blob(kj::Array<byte> data, kj::String type)
-      : ownData(kj::mv(data)), data(ownData.get<kj::Array<byte>>()), type(kj::mv(type)) {}
-  Blob(jsg::Ref<Blob> parent, kj::ArrayPtr<const byte> data, kj::String type)
-      : ownData(kj::mv(parent)), data(data), type(kj::mv(type)) {}
+  struct Rope {
+    // A Blob's content: a sequence of immutable segments, some of which may point into other
+    // Blobs, so that composing and slicing Blobs doesn't copy any bytes.
 
-  inline kj::ArrayPtr<const byte> getData() const KJ_LIFETIMEBOUND { return data; }
+    kj::Vector<kj::OneOf<kj::Array<byte>, jsg::Ref<Blob>>> owners;
+    // Keeps the memory pointed to by `segments` alive.
+
+    kj::Vector<kj::ArrayPtr<const byte>> segments;
+    // Never contains empty segments.
+
+    size_t size = 0;
+
+    void addOwned(kj::Array<byte> bytes);
+    void addOwned(kj::Array<byte> bytes, kj::ArrayPtr<const byte> segment);
+    void addBlob(jsg::Ref<Blob> blob, size_t start, size_t end);
+    // Appends bytes [start, end) of `blob`, which are referenced rather than copied.
+  };
+
+  Blob(kj::Array<byte> data, kj::String type);
+  Blob(Rope content, kj::String type)
+      : content(kj::mv(content)), type(kj::mv(type)) {}
+
+  kj::ArrayPtr<const byte> getData() const KJ_LIFETIMEBOUND;
+  // Returns the content as one contiguous array. A Blob composed of several segments is flattened
+  // into a buffer the first time this is called, so prefer getSegments() where possible.
+
+  kj::ArrayPtr<const kj::ArrayPtr<const byte>> getSegments() const KJ_LIFETIMEBOUND {
+    return content.segments.asPtr();
+  }
 
   // ---------------------------------------------------------------------------
   // JS API
@@ -33,7 +56,7 @@ public:
 
   static jsg::Ref<Blob> constructor(jsg::Optional<Bits> bits, jsg::Optional<Options> options);
 
-  int getSize() { return data.size(); }
+  int getSize() { return content.size; }
   kj::StringPtr getType() { return type; }
 
   jsg::Ref<Blob> slice(jsg::Optional<int> start, jsg::Optional<int> end,
@@ -59,13 +82,17 @@ public:
   }
 
 private:
-  kj::OneOf<kj::Array<byte>, jsg::Ref<Blob>> ownData;
-  kj::ArrayPtr<const byte> data;
+  Rope content;
   kj::String type;
 
+  mutable kj::Array<byte> flattened;
+  // Filled in by getData() if `content` has more than one segment.
+
   void visitForGc(jsg::GcVisitor& visitor) {
-    KJ_IF_MAYBE(b, ownData.tryGet<jsg::Ref<Blob>>()) {
-      visitor.visit(*b);
+    for (auto& owner: content.owners) {
+      KJ_IF_MAYBE(b, owner.tryGet<jsg::Ref<Blob>>()) {
+        visitor.visit(*b);
+      }
     }
   }
 
@@ -77,6 +104,9 @@ public:
   File(kj::Array<byte> data, kj::String name, kj::String type, double lastModified)
       : Blob(kj::mv(data), kj::mv(type)),
         name(kj::mv(name)), lastModified(lastModified) {}
+  File(Rope content, kj::String name, kj::String type, double lastModified)
+      : Blob(kj::mv(content), kj::mv(type)),
+        name(kj::mv(name)), lastModified(lastModified) {}
 
   struct Options {
     jsg::Optional<kj::String> type;
@@ -4,6 +4,7 @@
 
 #include "form-data.h"
 #include "util.h"
+#include <workerd/util/byte-search.h>
 #include <kj/vector.h>
 #include <kj/encoding.h>
 #include <algorithm>
@@ -24,12 +25,15 @@ kj::ArrayPtr<const char> splitAtSubString(
     kj::ArrayPtr<const char>& text, kj::StringPtr subString) {
   // Like split() in kj/compat/url.c++, but splits at a substring rather than a character.
 
-  // TODO(perf): Use a Boyer-Moore search?
-  auto iter = std::search(text.begin(), text.end(), subString.begin(), subString.end());
-  auto result = kj::arrayPtr(text.begin(), iter - text.begin());
-  text = text.slice(kj::min(text.size(), result.end() - text.begin() + subString.size()),
-                    text.size());
-  return result;
+  KJ_IF_MAYBE(index, findBytes(text, subString.asArray())) {
+    auto result = text.slice(0, *index);
+    text = text.slice(*index + subString.size(), text.size());
+    return result;
+  } else {
+    auto result = text;
+    text = text.slice(text.size(), text.size());
+    return result;
+  }
 }
 
 bool startsWith(kj::ArrayPtr<const char> bytes, kj::StringPtr prefix) {
@@ -186,8 +190,12 @@ blobToFile(kj::StringPtr name, kj::OneOf<jsg::Ref<File>, jsg::Ref<Blob>, kj::Str
     } else {
       fn = kj::str(name);
     }
-    return jsg::alloc<File>(kj::heapArray(blob->getData()), kj::mv(fn),
-                             kj::str(blob->getType()), dateNow());
+    // Reference the Blob's content rather than copying it.
+    auto type = kj::str(blob->getType());
+    size_t size = blob->getSize();
+    Blob::Rope content;
+    content.addBlob(kj::mv(blob), 0, size);
+    return jsg::alloc<File>(kj::mv(content), kj::mv(fn), kj::mv(type), dateNow());
   };
 
   KJ_SWITCH_ONEOF(value) {
@@ -275,7 +283,9 @@ kj::Array<kj::byte> FormData::serialize(kj::ArrayPtr<const char> boundary) {
         }
         builder.addAll(type);
         builder.addAll("\r\n\r\n"_kj);
-        builder.addAll(file->getData().asChars());
+        for (auto segment: file->getSegments()) {
+          builder.addAll(segment.asChars());
+        }
       }
     }
     builder.addAll("\r\n"_kj);
@@ -0,0 +1,97 @@
+function assertEqual(a, b) {
+  if (a !== b) {
+    throw new Error(a + " !== " + b);
+  }
+}
+
+export default {
+  async test(ctrl, env, ctx) {
+    // Entries are kept sorted by lower-cased name, regardless of insertion order or casing.
+    let headers = new Headers({
+      "X-Custom": "1",
+      "content-type": "text/plain",
+      "Accept": "*/*",
+      "Zeta": "z",
+      "x-a": "a",
+    });
+    assertEqual([...headers.keys()].join(","), "accept,content-type,x-a,x-custom,zeta");
+    assertEqual(headers.get("CONTENT-TYPE"), "text/plain");
+    assertEqual(headers.get("x-CUSTOM"), "1");
+    assertEqual(headers.get("x-missing"), null);
+    assertEqual(headers.has("ZETA"), true);
+    assertEqual(headers.has("zet"), false);
+
+    // Appending combines values; set() overwrites them; delete() removes them.
+    headers.append("accept", "text/html");
+    assertEqual(headers.get("Accept"), "*/*, text/html");
+    headers.set("ACCEPT", "application/json");
+    assertEqual(headers.get("accept"), "application/json");
+    headers.delete("X-A");
+    headers.delete("not-there");
+    assertEqual([...headers.keys()].join(","), "accept,content-type,x-custom,zeta");
+
+    // Names that differ only in case refer to the same header.
+    let req = new Request("https://example.com", { headers: { "X-Mixed-Case": "1" } });
+    req.headers.append("x-mixed-case", "2");
+    assertEqual(req.headers.get("x-mixed-case"), "1, 2");
+
+    // Set-Cookie values are never combined.
+    headers.append("Set-Cookie", "a=1; Expires=Wed, 21 Oct 2015 07:28:00 GMT");
+    headers.append("set-cookie", "b=2");
+    assertEqual(headers.getSetCookie().length, 2);
+    assertEqual([...headers.values()].filter(v => v == "b=2").length, 1);
+
+    // Iterators see the headers as they were when the iterator was created.
+    let iter = headers.entries();
+    let iter2 = headers.entries();
+    headers.set("aaa", "first");
+    headers.delete("zeta");
+    let seen = [...iter].map(([k, v]) => k);
+    assertEqual(seen.includes("aaa"), false);
+    assertEqual(seen.includes("zeta"), true);
+    assertEqual([...iter2].length, seen.length);
+    assertEqual([...headers.keys()][0], "aaa");
+
+    // forEach() isn't confused by the callback modifying the headers.
+    let count = 0;
+    headers.forEach((value, key, h) => {
+      h.delete(key);
+      ++count;
+    });
+    assertEqual(count, seen.length);
+    assertEqual([...headers].length, 0);
+
+    // Copies are independent of the original.
+    let many = new Headers();
+    for (let i = 0; i < 100; i++) {
+      many.append("header-" + (99 - i), "" + i);
+    }
+    let copy = new Headers(many);
+    many.delete("header-50");
+    assertEqual(copy.get("header-50"), "49");
+    assertEqual(many.get("header-50"), null);
+    assertEqual([...copy.keys()][0], "header-0");
+    assertEqual([...copy].length, 100);
+
+    // Headers that come from the runtime rather than from JavaScript, like these, are only
+    // converted to the sorted representation when needed.
+    let redirect = Response.redirect("https://example.com/foo", 301);
+    assertEqual(redirect.headers.get("LOCATION"), "https://example.com/foo");
+    assertEqual(redirect.headers.has("location"), true);
+    assertEqual(redirect.headers.has("content-type"), false);
+    let threw = false;
+    try {
+      redirect.headers.set("x", "y");
+    } catch (e) {
+      threw = true;
+    }
+    assertEqual(threw, true);
+    let redirectCopy = new Headers(redirect.headers);
+    redirectCopy.append("Location", "again");
+    redirectCopy.set("a", "b");
+    assertEqual([...redirectCopy.keys()].join(","), "a,location");
+    assertEqual(redirectCopy.get("location"), "https://example.com/foo, again");
+    assertEqual(redirect.headers.get("location"), "https://example.com/foo");
+    assertEqual([...redirect.headers].length, 1);
+  }
+}
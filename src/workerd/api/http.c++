@@ -14,6 +14,7 @@
 #include <workerd/jsg/ser.h>
 #include <workerd/io/io-context.h>
 #include <set>
+#include <algorithm>
 
 namespace workerd::api {
 
@@ -55,12 +56,9 @@ void warnIfBadHeaderString(const jsg::ByteString& byteString) {
   }
 }
 
-jsg::ByteString normalizeHeaderValue(jsg::ByteString value) {
-  // Left- and right-trim HTTP whitespace from `value`.
-
-  warnIfBadHeaderString(value);
+kj::ArrayPtr<const char> trimHeaderValue(kj::ArrayPtr<const char> slice) {
+  // Left- and right-trim HTTP whitespace from `slice`.
 
-  kj::ArrayPtr<char> slice = value;
   auto isHttpWhitespace = [](char c) {
     return c == '\t' || c == '\r' || c == '\n' || c == ' ';
   };
@@ -70,17 +68,24 @@ jsg::ByteString normalizeHeaderValue(jsg::ByteString value) {
   while (slice.size() > 0 && isHttpWhitespace(slice.back())) {
     slice = slice.slice(0, slice.size() - 1);
   }
+  return slice;
+}
+
+jsg::ByteString normalizeHeaderValue(jsg::ByteString value) {
+  // Left- and right-trim HTTP whitespace from `value`.
+
+  warnIfBadHeaderString(value);
+
+  auto slice = trimHeaderValue(value);
   if (slice.size() == value.size()) {
     return kj::mv(value);
   }
   return jsg::ByteString(kj::str(slice));
 }
 
-void requireValidHeaderName(const jsg::ByteString& name) {
+void requireValidHeaderName(kj::StringPtr name) {
   // TODO(cleanup): Code duplication with kj/compat/http.c++
 
-  warnIfBadHeaderString(name);
-
   constexpr auto HTTP_SEPARATOR_CHARS = kj::parse::anyOfChars("()<>@,;:\\\"/[]?={} \t");
   // RFC2616 section 2.2: https://www.w3.org/Protocols/rfc2616/rfc2616-sec2.html#sec2.2
 
@@ -97,6 +102,11 @@ void requireValidHeaderName(const jsg::ByteString& name) {
   }
 }
 
+void requireValidHeaderName(const jsg::ByteString& name) {
+  warnIfBadHeaderString(name);
+  requireValidHeaderName(kj::StringPtr(name));
+}
+
 void requireValidHeaderValue(kj::StringPtr value) {
   // TODO(cleanup): Code duplication with kj/compat/http.c++
 
@@ -105,8 +115,152 @@ void requireValidHeaderValue(kj::StringPtr value) {
   }
 }
 
+constexpr kj::StringPtr WELL_KNOWN_HEADER_NAMES[] = {
+  "accept"_kj, "accept-charset"_kj, "accept-encoding"_kj, "accept-language"_kj, "accept-ranges"_kj,
+  "access-control-allow-credentials"_kj, "access-control-allow-headers"_kj,
+  "access-control-allow-methods"_kj, "access-control-allow-origin"_kj,
+  "access-control-expose-headers"_kj, "access-control-max-age"_kj,
+  "access-control-request-headers"_kj, "access-control-request-method"_kj, "age"_kj, "allow"_kj,
+  "authorization"_kj, "cache-control"_kj, "cdn-loop"_kj, "cf-connecting-ip"_kj, "cf-ipcountry"_kj,
+  "cf-ray"_kj, "cf-visitor"_kj, "connection"_kj, "content-disposition"_kj, "content-encoding"_kj,
+  "content-language"_kj, "content-length"_kj, "content-location"_kj, "content-range"_kj,
+  "content-security-policy"_kj, "content-type"_kj, "cookie"_kj, "date"_kj, "etag"_kj, "expect"_kj,
+  "expires"_kj, "forwarded"_kj, "host"_kj, "if-match"_kj, "if-modified-since"_kj,
+  "if-none-match"_kj, "if-range"_kj, "if-unmodified-since"_kj, "keep-alive"_kj, "last-modified"_kj,
+  "link"_kj, "location"_kj, "origin"_kj, "pragma"_kj, "range"_kj, "referer"_kj,
+  "referrer-policy"_kj, "retry-after"_kj, "sec-fetch-dest"_kj, "sec-fetch-mode"_kj,
+  "sec-fetch-site"_kj, "sec-fetch-user"_kj, "sec-websocket-accept"_kj,
+  "sec-websocket-extensions"_kj, "sec-websocket-key"_kj, "sec-websocket-protocol"_kj,
+  "sec-websocket-version"_kj, "server"_kj, "set-cookie"_kj, "strict-transport-security"_kj,
+  "te"_kj, "trailer"_kj, "transfer-encoding"_kj, "upgrade"_kj, "upgrade-insecure-requests"_kj,
+  "user-agent"_kj, "vary"_kj, "via"_kj, "www-authenticate"_kj, "x-content-type-options"_kj,
+  "x-forwarded-for"_kj, "x-forwarded-proto"_kj, "x-frame-options"_kj, "x-real-ip"_kj,
+  "x-requested-with"_kj,
+};
+// Lower-cased names of headers that show up in most requests and responses, sorted. Headers
+// entries for these names point at the literals here rather than allocating a lower-cased copy.
+// This includes every header kj::HttpHeaderTable has a builtin id for.
+
+inline char toLowerAscii(char c) {
+  return 'A' <= c && c <= 'Z' ? c + ('a' - 'A') : c;
+}
+
+int compareHeaderName(kj::StringPtr key, kj::StringPtr name) {
+  // Compares the lower-case `key` to `name` as if `name` were lower-cased too, without actually
+  // lower-casing it. Orders like kj::StringPtr::operator<().
+
+  size_t size = kj::min(key.size(), name.size());
+  for (size_t i = 0; i < size; i++) {
+    kj::byte a = key[i];
+    kj::byte b = toLowerAscii(name[i]);
+    if (a != b) return a < b ? -1 : 1;
+  }
+  return key.size() < name.size() ? -1 : key.size() > name.size() ? 1 : 0;
+}
+
+bool headerNameEquals(kj::StringPtr a, kj::StringPtr b) {
+  if (a.size() != b.size()) return false;
+  for (size_t i = 0; i < a.size(); i++) {
+    if (toLowerAscii(a[i]) != toLowerAscii(b[i])) return false;
+  }
+  return true;
+}
+
+kj::Maybe<kj::StringPtr> findWellKnownHeaderName(kj::StringPtr name) {
+  auto begin = std::begin(WELL_KNOWN_HEADER_NAMES);
+  auto end = std::end(WELL_KNOWN_HEADER_NAMES);
+  auto iter = std::lower_bound(begin, end, name, [](kj::StringPtr key, kj::StringPtr other) {
+    return compareHeaderName(key, other) < 0;
+  });
+  if (iter != end && compareHeaderName(*iter, name) == 0) {
+    return *iter;
+  }
+  return nullptr;
+}
+
 }  // namespace
 
+Headers::Header::Header(jsg::ByteString nameParam)
+    : name(kj::mv(nameParam)) {
+  KJ_IF_MAYBE(wellKnown, findWellKnownHeaderName(name)) {
+    key = *wellKnown;
+  } else {
+    ownKey = toLower(kj::str(name));
+    key = ownKey;
+  }
+}
+
+Headers::Header::Header(const Header& other)
+    : Header(jsg::ByteString(kj::str(other.name))) {
+  values.reserve(other.values.size());
+  for (auto& value: other.values) {
+    values.add(jsg::ByteString(kj::str(value)));
+  }
+}
+
+kj::Maybe<jsg::ByteString> Headers::RawHeaders::get(kj::StringPtr name) const {
+  kj::Vector<kj::StringPtr> values;
+  for (auto& entry: entries) {
+    if (headerNameEquals(entry.name, name)) {
+      values.add(entry.value);
+    }
+  }
+  if (values.empty()) {
+    return nullptr;
+  }
+  return jsg::ByteString(kj::strArray(values, ", "));
+}
+
+bool Headers::RawHeaders::has(kj::StringPtr name) const {
+  for (auto& entry: entries) {
+    if (headerNameEquals(entry.name, name)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void Headers::materialize() {
+  KJ_IF_MAYBE(r, raw) {
+    auto rawHeaders = kj::mv(*r);
+    raw = nullptr;
+    for (auto& entry: rawHeaders->entries) {
+      jsg::ByteString name(kj::str(entry.name));
+      jsg::ByteString value(kj::str(entry.value));
+      warnIfBadHeaderString(name);
+      warnIfBadHeaderString(value);
+      findOrInsert(kj::mv(name)).values.add(kj::mv(value));
+    }
+  }
+}
+
+Headers::Header* Headers::lowerBound(kj::StringPtr name) {
+  return std::lower_bound(headers.begin(), headers.end(), name,
+      [](const Header& header, kj::StringPtr other) {
+    return compareHeaderName(header.key, other) < 0;
+  });
+}
+
+kj::Maybe<Headers::Header&> Headers::find(kj::StringPtr name) {
+  auto iter = lowerBound(name);
+  if (iter != headers.end() && compareHeaderName(iter->key, name) == 0) {
+    return *iter;
+  }
+  return nullptr;
+}
+
+Headers::Header& Headers::findOrInsert(jsg::ByteString name) {
+  auto iter = lowerBound(name);
+  if (iter != headers.end() && compareHeaderName(iter->key, name) == 0) {
+    return *iter;
+  }
+
+  size_t index = iter - headers.begin();
+  headers.add(kj::mv(name));
+  std::rotate(headers.begin() + index, headers.end() - 1, headers.end());
+  return headers[index];
+}
+
 Headers::Headers(jsg::Dict<jsg::ByteString, jsg::ByteString> dict)
     : guard(Guard::NONE) {
   for (auto& field: dict.fields) {
@@ -116,24 +270,49 @@ Headers::Headers(jsg::Dict<jsg::ByteString, jsg::ByteString> dict)
 
 Headers::Headers(const Headers& other)
     : guard(Guard::NONE) {
+  KJ_IF_MAYBE(r, other.raw) {
+    raw = kj::addRef(**r);
+    return;
+  }
+
+  headers.reserve(other.headers.size());
   for (auto& header: other.headers) {
-    Header copy {
-      jsg::ByteString(kj::str(header.second.key)),
-      jsg::ByteString(kj::str(header.second.name)),
-      KJ_MAP(value, header.second.values) { return jsg::ByteString(kj::str(value)); },
-    };
-    kj::StringPtr keyRef = copy.key;
-    KJ_ASSERT(headers.insert(std::make_pair(keyRef, kj::mv(copy))).second);
+    headers.add(header);
   }
 }
 
 Headers::Headers(const kj::HttpHeaders& other, Guard guard)
-    : guard(Guard::NONE) {
-  other.forEach([this](auto name, auto value) {
-    append(jsg::ByteString(kj::str(name)), jsg::ByteString(kj::str(value)));
+    : guard(guard) {
+  // Copy all the names and values into one buffer rather than allocating a pair of strings per
+  // header. See `raw`.
+
+  size_t count = 0;
+  size_t textSize = 0;
+  other.forEach([&](kj::StringPtr name, kj::StringPtr value) {
+    requireValidHeaderName(name);
+    requireValidHeaderValue(value);
+    ++count;
+    textSize += name.size() + trimHeaderValue(value).size() + 2;
   });
-
-  this->guard = guard;
+  if (count == 0) return;
+
+  auto rawHeaders = kj::refcounted<RawHeaders>();
+  rawHeaders->text = kj::heapArray<char>(textSize);
+  auto entries = kj::heapArrayBuilder<RawHeaders::Entry>(count);
+  char* pos = rawHeaders->text.begin();
+  auto copy = [&pos](kj::ArrayPtr<const char> str) {
+    memcpy(pos, str.begin(), str.size());
+    pos[str.size()] = '\0';
+    kj::StringPtr result(pos, str.size());
+    pos += str.size() + 1;
+    return result;
+  };
+  other.forEach([&](kj::StringPtr name, kj::StringPtr value) {
+    auto nameCopy = copy(name);
+    entries.add(RawHeaders::Entry { nameCopy, copy(trimHeaderValue(value)) });
+  });
+  rawHeaders->entries = entries.finish();
+  raw = kj::mv(rawHeaders);
 }
 
 jsg::Ref<Headers> Headers::clone() const {
@@ -146,9 +325,16 @@ void Headers::shallowCopyTo(kj::HttpHeaders& out) {
   // Fill in the given HttpHeaders with these headers. Note that strings are inserted by
   // reference, so the output must be consumed immediately.
 
-  for (auto& entry: headers) {
-    for (auto& value: entry.second.values) {
-      out.add(entry.second.name, value);
+  KJ_IF_MAYBE(r, raw) {
+    for (auto& entry: (*r)->entries) {
+      out.add(entry.name, entry.value);
+    }
+    return;
+  }
+
+  for (auto& header: headers) {
+    for (auto& value: header.values) {
+      out.add(header.name, value);
     }
   }
 }
@@ -159,43 +345,56 @@ bool Headers::hasLowerCase(kj::StringPtr name) {
     KJ_DREQUIRE(!('A' <= c && c <= 'Z'));
   }
 #endif
-  return headers.find(name) != headers.end();
+  KJ_IF_MAYBE(r, raw) {
+    return (*r)->has(name);
+  }
+  return find(name) != nullptr;
 }
 
 kj::Array<Headers::DisplayedHeader> Headers::getDisplayedHeaders(
     CompatibilityFlags::Reader featureFlags) {
+  return KJ_MAP(entry, getSnapshot(featureFlags).entries) {
+    return DisplayedHeader {
+      jsg::ByteString(kj::str(entry.key)),
+      jsg::ByteString(kj::str(entry.value))
+    };
+  };
+}
 
-  if (featureFlags.getHttpHeadersGetSetCookie()) {
-    kj::Vector<Headers::DisplayedHeader> copy;
-    for (auto& entry : headers) {
-      if (entry.first == "set-cookie") {
-        // For set-cookie entries, we iterate each individually without
-        // combining them.
-        for (auto& value : entry.second.values) {
-          copy.add(Headers::DisplayedHeader {
-            .key = jsg::ByteString(kj::str(entry.first)),
-            .value = jsg::ByteString(kj::str(value)),
-          });
-        }
-      } else {
-        copy.add(Headers::DisplayedHeader {
-          .key = jsg::ByteString(kj::str(entry.first)),
-          .value = jsg::ByteString(kj::strArray(entry.second.values, ", "))
+Headers::Snapshot& Headers::getSnapshot(CompatibilityFlags::Reader featureFlags) {
+  materialize();
+
+  bool splitSetCookie = featureFlags.getHttpHeadersGetSetCookie();
+  KJ_IF_MAYBE(s, snapshot) {
+    if ((*s)->splitSetCookie == splitSetCookie) {
+      return **s;
+    }
+  }
+
+  kj::Vector<DisplayedHeader> entries(headers.size());
+  for (auto& header: headers) {
+    if (splitSetCookie && header.key == "set-cookie") {
+      // For set-cookie entries, we iterate each individually without combining them. The old
+      // behavior before the standard getSetCookie() API was introduced combined them like any
+      // other header.
+      for (auto& value: header.values) {
+        entries.add(DisplayedHeader {
+          .key = jsg::ByteString(kj::str(header.key)),
+          .value = jsg::ByteString(kj::str(value)),
         });
       }
+    } else {
+      entries.add(DisplayedHeader {
+        .key = jsg::ByteString(kj::str(header.key)),
+        .value = jsg::ByteString(kj::strArray(header.values, ", "))
+      });
     }
-    return copy.releaseAsArray();
-  } else {
-    // The old behavior before the standard getSetCookie() API was introduced...
-    auto headersCopy = KJ_MAP(mapEntry, headers) {
-      const auto& header = mapEntry.second;
-      return DisplayedHeader {
-        jsg::ByteString(kj::str(header.key)),
-        jsg::ByteString(kj::strArray(header.values, ", "))
-      };
-    };
-    return headersCopy;
   }
+
+  auto result = kj::refcounted<Snapshot>();
+  result->entries = entries.releaseAsArray();
+  result->splitSetCookie = splitSetCookie;
+  return *snapshot.emplace(kj::mv(result));
 }
 
 jsg::Ref<Headers> Headers::constructor(jsg::Lock& js, jsg::Optional<Initializer> init) {
@@ -245,20 +444,20 @@ jsg::Ref<Headers> Headers::constructor(jsg::Lock& js, jsg::Optional<Initializer>
 
 kj::Maybe<jsg::ByteString> Headers::get(jsg::ByteString name) {
   requireValidHeaderName(name);
-  auto iter = headers.find(toLower(kj::mv(name)));
-  if (iter == headers.end()) {
-    return nullptr;
-  } else {
-    return jsg::ByteString(kj::strArray(iter->second.values, ", "));
+  KJ_IF_MAYBE(r, raw) {
+    return (*r)->get(name);
   }
+  return find(name).map([](Header& header) {
+    return jsg::ByteString(kj::strArray(header.values, ", "));
+  });
 }
 
 kj::ArrayPtr<jsg::ByteString> Headers::getSetCookie() {
-  auto iter = headers.find("set-cookie");
-  if (iter == headers.end()) {
-    return nullptr;
+  materialize();
+  KJ_IF_MAYBE(header, find("set-cookie"_kj)) {
+    return header->values.asPtr();
   } else {
-    return iter->second.values.asPtr();
+    return nullptr;
   }
 }
 
@@ -277,121 +476,82 @@ kj::ArrayPtr<jsg::ByteString> Headers::getAll(jsg::ByteString name) {
 
 bool Headers::has(jsg::ByteString name) {
   requireValidHeaderName(name);
-  return headers.find(toLower(kj::mv(name))) != headers.end();
+  KJ_IF_MAYBE(r, raw) {
+    return (*r)->has(name);
+  }
+  return find(name) != nullptr;
 }
 
 void Headers::set(jsg::ByteString name, jsg::ByteString value) {
   checkGuard();
   requireValidHeaderName(name);
-  auto key = toLower(name);
   value = normalizeHeaderValue(kj::mv(value));
   requireValidHeaderValue(value);
-  auto [iter, emplaced] = headers.try_emplace(key, kj::mv(key), kj::mv(name), kj::mv(value));
-  if (!emplaced) {
-    // Overwrite existing value(s).
-    iter->second.values.clear();
-    iter->second.values.add(kj::mv(value));
-  }
+  materialize();
+  auto& header = findOrInsert(kj::mv(name));
+  // Overwrite existing value(s).
+  header.values.clear();
+  header.values.add(kj::mv(value));
+  snapshot = nullptr;
 }
 
 void Headers::append(jsg::ByteString name, jsg::ByteString value) {
   checkGuard();
   requireValidHeaderName(name);
-  auto key = toLower(name);
   value = normalizeHeaderValue(kj::mv(value));
   requireValidHeaderValue(value);
-  auto [iter, emplaced] = headers.try_emplace(key, kj::mv(key), kj::mv(name), kj::mv(value));
-  if (!emplaced) {
-    iter->second.values.add(kj::mv(value));
-  }
+  materialize();
+  findOrInsert(kj::mv(name)).values.add(kj::mv(value));
+  snapshot = nullptr;
 }
 
 void Headers::delete_(jsg::ByteString name) {
   checkGuard();
   requireValidHeaderName(name);
-  headers.erase(toLower(kj::mv(name)));
+  materialize();
+  auto iter = lowerBound(name);
+  if (iter != headers.end() && compareHeaderName(iter->key, name) == 0) {
+    std::move(iter + 1, headers.end(), iter);
+    headers.removeLast();
+    snapshot = nullptr;
+  }
 }
 
 // There are a couple implementation details of the Headers iterators worth calling out.
 //
-// 1. Each iterator gets its own copy of the keys and/or values of the headers. While nauseating
-//    from a performance perspective, this solves both the iterator -> iterable lifetime dependence
-//    and the iterator invalidation issue: i.e., it's impossible for a user to unsafely modify the
-//    Headers data structure while iterating over it, because they are simply two separate data
-//    structures. By empirical testing, this seems to be how Chrome implements Headers iteration.
+// 1. Each iterator holds a reference to an immutable Snapshot of the displayed headers, rather
+//    than to the Headers object itself. This solves both the iterator -> iterable lifetime
+//    dependence and the iterator invalidation issue: i.e., it's impossible for a user to unsafely
+//    modify the Headers data structure while iterating over it, because they are simply two
+//    separate data structures. By empirical testing, this seems to be how Chrome implements
+//    Headers iteration.
 //
-//    Other alternatives bring their own pitfalls. We could store a Ref of the parent Headers
-//    object, solving the lifetime issue. To solve the iterator invalidation issue, we could store a
-//    copy of the currently-iterated-over key and use std::upper_bound() to find the next entry
-//    every time we want to increment the iterator (making the increment operation O(lg n) rather
-//    than O(1)); or we could make each Header entry in the map store a set of back-pointers to all
-//    live iterators pointing to it, with delete_() incrementing all iterators in the set whenever
-//    it deletes a header entry. Neither hack appealed to me.
+// 2. The snapshot is copy-on-write: it is built the first time it's needed and then shared by
+//    every iterator (and forEach() call) until the headers are next modified, at which point the
+//    Headers object drops its reference and builds a new one on demand. Iterators that are still
+//    live keep the old one alive. So repeatedly iterating over unchanging headers -- by far the
+//    common case -- only builds the displayed form once.
 //
-// 2. Notice that the next() member function of the iterator classes moves the string(s) they
-//    contain, rather than making a copy of them as in the FormData iterators. This is safe to do
-//    because, unlike FormData, these iterators have their own copies of the strings, and since they
-//    are forward-only iterators, we know we won't need the strings again.
-//
-// TODO(perf): On point 1, perhaps we could avoid most copies by using a copy-on-write strategy
-//   applied to the header map elements? We'd still copy the whole data structure to avoid iterator
-//   invalidation, but the elements would be cheaper to copy.
+// 3. Since the snapshot is shared, the next() member function of the iterator classes copies the
+//    string(s) it returns, as in the FormData iterators.
 
 jsg::Ref<Headers::EntryIterator> Headers::entries(
     jsg::Lock&,
     CompatibilityFlags::Reader featureFlags) {
-  return jsg::alloc<EntryIterator>(IteratorState<DisplayedHeader> {
-    getDisplayedHeaders(featureFlags)
-  });
+  return jsg::alloc<EntryIterator>(IteratorState { kj::addRef(getSnapshot(featureFlags)) });
 }
 jsg::Ref<Headers::KeyIterator> Headers::keys(
     jsg::Lock&,
     CompatibilityFlags::Reader featureFlags) {
-  if (featureFlags.getHttpHeadersGetSetCookie()) {
-    kj::Vector<jsg::ByteString> keysCopy;
-    for (auto& entry : headers) {
-      // Set-Cookie headers must be handled specially. They should never be combined into a
-      // single value, so the values iterator must separate them. It seems a bit silly, but
-      // the keys iterator can end up having multiple set-cookie instances.
-      if (entry.first == "set-cookie") {
-        for (auto n = 0; n < entry.second.values.size(); n++) {
-          keysCopy.add(jsg::ByteString(kj::str(entry.first)));
-        }
-      } else {
-        keysCopy.add(jsg::ByteString(kj::str(entry.first)));
-      }
-    }
-    return jsg::alloc<KeyIterator>(IteratorState<jsg::ByteString> { keysCopy.releaseAsArray() });
-  } else {
-    auto keysCopy = KJ_MAP(mapEntry, headers) {
-      return jsg::ByteString(kj::str(mapEntry.second.key));
-    };
-    return jsg::alloc<KeyIterator>(IteratorState<jsg::ByteString> { kj::mv(keysCopy) });
-  }
+  // With httpHeadersGetSetCookie, Set-Cookie headers are never combined into a single value, so
+  // the values iterator must separate them. It seems a bit silly, but the keys iterator can end
+  // up having multiple set-cookie instances, too. The snapshot takes care of this.
+  return jsg::alloc<KeyIterator>(IteratorState { kj::addRef(getSnapshot(featureFlags)) });
 }
 jsg::Ref<Headers::ValueIterator> Headers::values(
     jsg::Lock&,
     CompatibilityFlags::Reader featureFlags) {
-  if (featureFlags.getHttpHeadersGetSetCookie()) {
-    kj::Vector<jsg::ByteString> values;
-    for (auto& entry : headers) {
-      // Set-Cookie headers must be handled specially. They should never be combined into a
-      // single value, so the values iterator must separate them.
-      if (entry.first == "set-cookie") {
-        for (auto& value : entry.second.values) {
-          values.add(jsg::ByteString(kj::str(value)));
-        }
-      } else {
-        values.add(jsg::ByteString(kj::strArray(entry.second.values, ", ")));
-      }
-    }
-    return jsg::alloc<ValueIterator>(IteratorState<jsg::ByteString> { values.releaseAsArray() });
-  } else {
-    auto valuesCopy = KJ_MAP(mapEntry, headers) {
-      return jsg::ByteString(kj::strArray(mapEntry.second.values, ", "));
-    };
-    return jsg::alloc<ValueIterator>(IteratorState<jsg::ByteString> { kj::mv(valuesCopy) });
-  }
+  return jsg::alloc<ValueIterator>(IteratorState { kj::addRef(getSnapshot(featureFlags)) });
 }
 
 void Headers::forEach(
@@ -410,7 +570,10 @@ void Headers::forEach(
   auto localHeaders = KJ_ASSERT_NONNULL(JSG_THIS.tryGetHandle(isolate));
 
   auto context = isolate->GetCurrentContext();  // Needed later for Call().
-  for (auto& entry: getDisplayedHeaders(featureFlags)) {
+
+  // Hold on to the snapshot, since the callback may modify the headers.
+  auto snapshot = kj::addRef(getSnapshot(featureFlags));
+  for (auto& entry: snapshot->entries) {
     static constexpr auto ARG_COUNT = 3;
     v8::Local<v8::Value> args[ARG_COUNT] = {
       jsg::v8Str(isolate, entry.value),
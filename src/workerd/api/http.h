@@ -8,7 +8,6 @@
 #include <workerd/jsg/async-context.h>
 #include <workerd/util/abortable.h>
 #include <kj/compat/http.h>
-#include <map>
 #include "basics.h"
 #include "streams.h"
 #include "form-data.h"
@@ -22,10 +21,10 @@ namespace workerd::api {
 
 class Headers: public jsg::Object {
 private:
-  template <typename T>
+  struct Snapshot;
   struct IteratorState {
-    kj::Array<T> copy;
-    decltype(copy.begin()) cursor = copy.begin();
+    kj::Own<Snapshot> snapshot;
+    size_t index = 0;
   };
 
 public:
@@ -102,16 +101,16 @@ public:
 
   JSG_ITERATOR(EntryIterator, entries,
                 kj::Array<jsg::ByteString>,
-                IteratorState<DisplayedHeader>,
+                IteratorState,
                 entryIteratorNext)
   JSG_ITERATOR(KeyIterator, keys,
                 jsg::ByteString,
-                IteratorState<jsg::ByteString>,
-                keyOrValueIteratorNext)
+                IteratorState,
+                keyIteratorNext)
   JSG_ITERATOR(ValueIterator, values,
                 jsg::ByteString,
-                IteratorState<jsg::ByteString>,
-                keyOrValueIteratorNext)
+                IteratorState,
+                valueIteratorNext)
 
   // JavaScript API.
 
@@ -148,50 +147,104 @@ public:
 
 private:
   struct Header {
-    jsg::ByteString key;   // lower-cased name
+    kj::StringPtr key;   // lower-cased name; points into `ownKey` unless the name is well-known
+    kj::String ownKey;
     jsg::ByteString name;
     kj::Vector<jsg::ByteString> values;
     // We intentionally do not comma-concatenate header values of the same name, as we need to be
     // able to re-serialize them separately. This is particularly important for the Set-Cookie
     // header, which uses a date format that requires a comma. This would normally suggest using a
-    // std::multimap, but we also need to be able to display the values in comma-concatenated form
-    // via Headers.entries()[1] in order to be Fetch-conformant. Storing a vector of strings in a
-    // std::map makes this easier, and also makes it easy to honor the "first header name casing is
+    // multimap, but we also need to be able to display the values in comma-concatenated form
+    // via Headers.entries()[1] in order to be Fetch-conformant. Storing a vector of strings per
+    // name makes this easier, and also makes it easy to honor the "first header name casing is
     // used for all duplicate header names" rule[2] that the Fetch spec mandates.
     //
     // See: 1: https://fetch.spec.whatwg.org/#concept-header-list-sort-and-combine
     //      2: https://fetch.spec.whatwg.org/#concept-header-list-append
 
-    explicit Header(jsg::ByteString key, jsg::ByteString name,
-                    kj::Vector<jsg::ByteString> values)
-        : key(kj::mv(key)), name(kj::mv(name)), values(kj::mv(values)) {}
-    explicit Header(jsg::ByteString key, jsg::ByteString name, jsg::ByteString value)
-        : key(kj::mv(key)), name(kj::mv(name)), values(1) {
-      values.add(kj::mv(value));
-    }
+    explicit Header(jsg::ByteString name);
+    // Computes `key` from `name`. `values` starts out empty.
+
+    Header(const Header& other);
+    Header(Header&&) = default;
+    Header& operator=(Header&&) = default;
+  };
+
+  struct Snapshot: public kj::Refcounted {
+    // The displayed form of the headers at some point in time, as iterated by entries(), keys(),
+    // values(), and forEach(). Shared by every iterator created between two modifications.
+
+    kj::Array<DisplayedHeader> entries;
+    bool splitSetCookie;  // whether built with the httpHeadersGetSetCookie flag
+  };
+
+  struct RawHeaders: public kj::Refcounted {
+    // The contents of a kj::HttpHeaders, in their original order and casing, copied into a single
+    // buffer.
+
+    struct Entry {
+      kj::StringPtr name;
+      kj::StringPtr value;  // already trimmed of whitespace
+    };
+
+    kj::Array<char> text;
+    kj::Array<Entry> entries;
+
+    kj::Maybe<jsg::ByteString> get(kj::StringPtr name) const;
+    bool has(kj::StringPtr name) const;
   };
 
   Guard guard;
-  std::map<kj::StringPtr, Header> headers;
+  kj::Vector<Header> headers;
+  // Sorted by `key`. Requests rarely have more than a few dozen headers, so a flat array beats a
+  // node-based tree on both lookups and construction, and insertion in the middle is cheap.
+
+  kj::Maybe<kj::Own<RawHeaders>> raw;
+  // Headers constructed from a kj::HttpHeaders -- incoming requests and subrequest responses --
+  // start out in this form instead of `headers`, which stays empty until materialize() is called.
+  // Such headers are usually immutable and are typically only read a few times and/or forwarded
+  // unchanged, so building the sorted representation is often wasted work. The buffer is shared
+  // by copies of the Headers object.
+
+  void materialize();
+  // Converts `raw`, if any, to `headers`.
+
+  kj::Maybe<kj::Own<Snapshot>> snapshot;
+  // Cached by getSnapshot(), and dropped by anything that modifies `headers`.
 
   void checkGuard() {
     JSG_REQUIRE(guard == Guard::NONE, TypeError, "Can't modify immutable headers.");
   }
 
+  Header* lowerBound(kj::StringPtr name);
+  kj::Maybe<Header&> find(kj::StringPtr name);
+  // Binary-search `headers` for `name`, compared case-insensitively.
+
+  Header& findOrInsert(jsg::ByteString name);
+  // Returns the entry for `name`, inserting it with no values if there isn't one yet.
+
+  Snapshot& getSnapshot(CompatibilityFlags::Reader featureFlags);
+
   static kj::Maybe<kj::Array<jsg::ByteString>> entryIteratorNext(jsg::Lock& js, auto& state) {
-    if (state.cursor == state.copy.end()) {
+    if (state.index == state.snapshot->entries.size()) {
+      return nullptr;
+    }
+    auto& entry = state.snapshot->entries[state.index++];
+    return kj::arr(jsg::ByteString(kj::str(entry.key)), jsg::ByteString(kj::str(entry.value)));
+  }
+
+  static kj::Maybe<jsg::ByteString> keyIteratorNext(jsg::Lock& js, auto& state) {
+    if (state.index == state.snapshot->entries.size()) {
       return nullptr;
     }
-    auto& ret = *state.cursor++;
-    return kj::arr(kj::mv(ret.key), kj::mv(ret.value));
+    return jsg::ByteString(kj::str(state.snapshot->entries[state.index++].key));
   }
 
-  static kj::Maybe<jsg::ByteString> keyOrValueIteratorNext(jsg::Lock& js, auto& state) {
-    if (state.cursor == state.copy.end()) {
+  static kj::Maybe<jsg::ByteString> valueIteratorNext(jsg::Lock& js, auto& state) {
+    if (state.index == state.snapshot->entries.size()) {
       return nullptr;
     }
-    auto& ret = *state.cursor++;
-    return kj::mv(ret);
+    return jsg::ByteString(kj::str(state.snapshot->entries[state.index++].value));
   }
 };
 
@@ -5567,3 +5567,40 @@ export const toStringRange = {
     });
   }
 };
+
+export const viewsIntoLargerBuffers = {
+  test(ctrl, env, ctx) {
+    // The native helpers read their arguments in place, so make sure they respect the view's
+    // offset and length rather than the whole underlying ArrayBuffer.
+    const backing = Buffer.from('xxhelloworldyy');
+    const hello = backing.subarray(2, 7);
+    const world = backing.subarray(7, 12);
+
+    strictEqual(hello.toString(), 'hello');
+    strictEqual(Buffer.compare(hello, Buffer.from('hello')), 0);
+    strictEqual(Buffer.compare(hello, world), -1);
+    strictEqual(hello.compare(backing, 2, 7), 0);
+    strictEqual(hello.indexOf('x'), -1);
+    strictEqual(hello.indexOf(Buffer.from('yy').subarray(0, 1)), -1);
+    strictEqual(world.indexOf(backing.subarray(9, 11)), 2);
+    strictEqual(Buffer.concat([hello, world]).toString(), 'helloworld');
+
+    const swapped = Buffer.from('xxabcdyy').subarray(2, 6);
+    swapped.swap16();
+    strictEqual(swapped.toString(), 'badc');
+
+    hello.fill(world.subarray(0, 1));
+    strictEqual(backing.toString(), 'xxwwwwwworldyy');
+    world.write('W');
+    strictEqual(backing.toString(), 'xxwwwwwWorldyy');
+
+    // Small typed arrays live on V8's heap until something asks for their buffer. Read-only
+    // helpers copy them out instead of reading them in place.
+    strictEqual(Buffer.compare(new Uint8Array([1, 2, 3]), new Uint8Array([1, 2, 4])), -1);
+    strictEqual(Buffer.concat([new Uint8Array([1, 2]), new Uint8Array([3])]).join(','), '1,2,3');
+
+    // Asking for the buffer moves it off the heap, after which views into it are read in place.
+    const small = new Uint8Array([1, 2, 3]);
+    strictEqual(Buffer.compare(Buffer.from(small.buffer, 1, 2), Buffer.from([2, 3])), 0);
+  }
+};
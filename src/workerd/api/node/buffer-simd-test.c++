@@ -0,0 +1,197 @@
+// Copyright (c) 2017-2023 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#include "buffer-simd.h"
+#include <kj/test.h>
+#include <kj/string.h>
+
+namespace workerd::api::node {
+namespace {
+
+// The vectorized kernels only kick in for inputs of a few dozen bytes or more and handle any
+// remainder with the scalar code, so these tests run every length up to a few hundred bytes, at a
+// few misalignments, and compare against the scalar implementations.
+
+constexpr size_t MAX_LENGTH = 300;
+
+kj::Array<kj::byte> randomBytes(size_t size, uint& seed) {
+  auto result = kj::heapArray<kj::byte>(size);
+  for (auto& b: result) {
+    seed = seed * 1103515245 + 12345;
+    b = seed >> 16;
+  }
+  return result;
+}
+
+kj::ArrayPtr<const kj::byte> bytes(kj::StringPtr text) {
+  return text.asBytes();
+}
+
+KJ_TEST("node:buffer SIMD byte swaps match scalar") {
+  KJ_LOG(INFO, "AVX2", haveAvx2());
+  uint seed = 1;
+  for (size_t size = 0; size <= MAX_LENGTH; size += 8) {
+    for (size_t offset = 0; offset < 3; offset++) {
+      auto input = randomBytes(size + offset, seed);
+      auto region = input.slice(offset, input.size());
+
+      auto a = kj::heapArray<kj::byte>(region);
+      auto b = kj::heapArray<kj::byte>(region);
+      swapBytes16(a);
+      scalar::swapBytes16(b);
+      KJ_EXPECT(a.asPtr() == b.asPtr(), size, offset);
+
+      swapBytes32(a);
+      scalar::swapBytes32(b);
+      KJ_EXPECT(a.asPtr() == b.asPtr(), size, offset);
+
+      swapBytes64(a);
+      scalar::swapBytes64(b);
+      KJ_EXPECT(a.asPtr() == b.asPtr(), size, offset);
+    }
+  }
+
+  kj::byte data[] = {1, 2, 3, 4, 5, 6, 7, 8};
+  kj::byte swapped16[] = {2, 1, 4, 3, 6, 5, 8, 7};
+  kj::byte swapped64[] = {7, 8, 5, 6, 3, 4, 1, 2};
+  swapBytes16(data);
+  KJ_EXPECT(kj::arrayPtr(data, 8) == kj::arrayPtr(swapped16, 8));
+  swapBytes64(data);
+  KJ_EXPECT(kj::arrayPtr(data, 8) == kj::arrayPtr(swapped64, 8));
+}
+
+KJ_TEST("node:buffer SIMD hex matches scalar") {
+  uint seed = 2;
+  for (size_t size = 0; size <= MAX_LENGTH; size++) {
+    for (size_t offset = 0; offset < 3; offset++) {
+      auto input = randomBytes(size + offset, seed);
+      auto region = input.slice(offset, input.size());
+
+      auto text = kj::heapArray<kj::byte>(size * 2);
+      auto expected = kj::heapArray<kj::byte>(size * 2);
+      encodeHex(region, text);
+      scalar::encodeHex(region, expected);
+      KJ_EXPECT(text.asPtr() == expected.asPtr(), size, offset);
+
+      auto decoded = kj::heapArray<kj::byte>(size);
+      KJ_EXPECT(decodeHex(text, decoded) == size);
+      KJ_EXPECT(decoded.asPtr() == region, size, offset);
+
+      // Upper case decodes too.
+      for (auto& c: text) {
+        if ('a' <= c && c <= 'f') c -= 'a' - 'A';
+      }
+      KJ_EXPECT(decodeHex(text, decoded) == size);
+      KJ_EXPECT(decoded.asPtr() == region, size, offset);
+
+      // Decoding stops at the pair containing the first invalid digit.
+      if (size > 0) {
+        size_t bad = seed % text.size();
+        text[bad] = "g\0/:@`G "[seed % 8];
+        size_t n = decodeHex(text, decoded);
+        KJ_EXPECT(n == bad / 2, size, offset, bad);
+        KJ_EXPECT(decoded.slice(0, n) == region.slice(0, n));
+        KJ_EXPECT(n == scalar::decodeHex(text, decoded));
+      }
+    }
+  }
+}
+
+KJ_TEST("node:buffer SIMD hex known values") {
+  kj::byte out[32];
+  encodeHex(bytes("\x01\x23\x45\x67\x89\xab\xcd\xef\xfe\xdc\xba\x98\x76\x54\x32\x10"),
+            kj::arrayPtr(out, 32));
+  KJ_EXPECT(kj::heapString(kj::arrayPtr(out, 32).asChars()) ==
+      "0123456789abcdeffedcba9876543210"_kj);
+
+  KJ_EXPECT(decodeHex(bytes("0123456789abcdefFEDCBA9876543210"), kj::arrayPtr(out, 16)) == 16);
+  KJ_EXPECT(kj::arrayPtr(out, 16) ==
+      bytes("\x01\x23\x45\x67\x89\xab\xcd\xef\xfe\xdc\xba\x98\x76\x54\x32\x10"));
+}
+
+KJ_TEST("node:buffer SIMD base64 matches scalar") {
+  uint seed = 3;
+  for (size_t size = 0; size <= MAX_LENGTH; size++) {
+    for (size_t offset = 0; offset < 3; offset++) {
+      auto input = randomBytes(size + offset, seed);
+      auto region = input.slice(offset, input.size());
+
+      for (auto mode: {Base64Mode::NORMAL, Base64Mode::URL}) {
+        auto text = kj::heapArray<kj::byte>(base64_encoded_size(size, mode));
+        auto expected = kj::heapArray<kj::byte>(text.size());
+        encodeBase64(region, text, mode);
+        scalar::encodeBase64(region, expected, mode);
+        KJ_EXPECT(text.asPtr() == expected.asPtr(), size, offset);
+
+        auto decoded = kj::heapArray<kj::byte>(size + 4);
+        size_t n = decodeBase64(text, decoded);
+        KJ_EXPECT(n == size, size, offset);
+        KJ_EXPECT(decoded.slice(0, n) == region, size, offset);
+
+        // Whitespace anywhere, including in the middle of what would otherwise be a whole vector,
+        // is skipped.
+        if (text.size() > 0) {
+          auto spaced = kj::heapArray<kj::byte>(text.size() + 1);
+          size_t at = seed % text.size();
+          memcpy(spaced.begin(), text.begin(), at);
+          spaced[at] = '\n';
+          memcpy(spaced.begin() + at + 1, text.begin() + at, text.size() - at);
+
+          auto expectedDecoded = kj::heapArray<kj::byte>(decoded.size());
+          size_t m = scalar::decodeBase64(spaced, expectedDecoded);
+          KJ_EXPECT(decodeBase64(spaced, decoded) == m, size, offset, at);
+          KJ_EXPECT(decoded.slice(0, m) == expectedDecoded.slice(0, m), size, offset, at);
+        }
+
+        // A short output buffer is filled as far as it goes, and no further.
+        if (size >= 2) {
+          auto shortOut = kj::heapArray<kj::byte>(size / 2 + 1);
+          auto expectedShort = kj::heapArray<kj::byte>(size / 2 + 1);
+          shortOut.back() = expectedShort.back() = 0xcc;
+          size_t m = scalar::decodeBase64(text, expectedShort.slice(0, size / 2));
+          KJ_EXPECT(decodeBase64(text, shortOut.slice(0, size / 2)) == m, size, offset);
+          KJ_EXPECT(shortOut.asPtr() == expectedShort.asPtr(), size, offset);
+        }
+      }
+    }
+  }
+}
+
+KJ_TEST("node:buffer SIMD base64 known values") {
+  auto input = bytes("The quick brown fox jumps over the lazy dog, twice: "
+                     "the quick brown fox jumps over the lazy dog?");
+  auto expected =
+      "VGhlIHF1aWNrIGJyb3duIGZveCBqdW1wcyBvdmVyIHRoZSBsYXp5IGRvZywgdHdpY2U6IHRoZSBxdWljayBi"
+      "cm93biBmb3gganVtcHMgb3ZlciB0aGUgbGF6eSBkb2c/"_kj;
+
+  auto text = kj::heapArray<kj::byte>(base64_encoded_size(input.size(), Base64Mode::NORMAL));
+  encodeBase64(input, text, Base64Mode::NORMAL);
+  KJ_EXPECT(kj::heapString(text.asChars()) == expected);
+
+  auto decoded = kj::heapArray<kj::byte>(input.size());
+  KJ_EXPECT(decodeBase64(text, decoded) == input.size());
+  KJ_EXPECT(decoded.asPtr() == input);
+
+  kj::byte out[4];
+  encodeBase64(bytes("\xfb\xff"), kj::arrayPtr(out, 4), Base64Mode::NORMAL);
+  KJ_EXPECT(kj::heapString(kj::arrayPtr(out, 4).asChars()) == "+/8="_kj);
+  encodeBase64(bytes("\xfb\xff"), kj::arrayPtr(out, 3), Base64Mode::URL);
+  KJ_EXPECT(kj::heapString(kj::arrayPtr(out, 3).asChars()) == "-_8"_kj);
+}
+
+KJ_TEST("node:buffer SIMD ascii matches scalar") {
+  uint seed = 4;
+  for (size_t size = 0; size <= MAX_LENGTH; size++) {
+    auto input = randomBytes(size, seed);
+    auto a = kj::heapArray<kj::byte>(size);
+    auto b = kj::heapArray<kj::byte>(size);
+    clearHighBits(input, a);
+    scalar::clearHighBits(input, b);
+    KJ_EXPECT(a.asPtr() == b.asPtr(), size);
+    for (auto c: a) KJ_EXPECT(c < 0x80);
+  }
+}
+
+}  // namespace
+}  // namespace workerd::api::node
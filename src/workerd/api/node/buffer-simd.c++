@@ -0,0 +1,442 @@
+// Copyright (c) 2017-2023 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#include "buffer-simd.h"
+#include <string.h>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define BUFFER_SIMD_AVX2 1
+#include <immintrin.h>
+#endif
+
+// These are defined by <sys/byteorder.h> or <netinet/in.h> on some systems.
+// To avoid warnings, undefine them before redefining them.
+#ifdef BSWAP_2
+# undef BSWAP_2
+#endif
+#ifdef BSWAP_4
+# undef BSWAP_4
+#endif
+#ifdef BSWAP_8
+# undef BSWAP_8
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define BSWAP_2(x) _byteswap_ushort(x)
+#define BSWAP_4(x) _byteswap_ulong(x)
+#define BSWAP_8(x) _byteswap_uint64(x)
+#else
+#define BSWAP_2(x) ((x) << 8) | ((x) >> 8)
+#define BSWAP_4(x)                                                            \
+  (((x) & 0xFF) << 24)  |                                                     \
+  (((x) & 0xFF00) << 8) |                                                     \
+  (((x) >> 8) & 0xFF00) |                                                     \
+  (((x) >> 24) & 0xFF)
+#define BSWAP_8(x)                                                            \
+  (((x) & 0xFF00000000000000ull) >> 56) |                                     \
+  (((x) & 0x00FF000000000000ull) >> 40) |                                     \
+  (((x) & 0x0000FF0000000000ull) >> 24) |                                     \
+  (((x) & 0x000000FF00000000ull) >> 8)  |                                     \
+  (((x) & 0x00000000FF000000ull) << 8)  |                                     \
+  (((x) & 0x0000000000FF0000ull) << 24) |                                     \
+  (((x) & 0x000000000000FF00ull) << 40) |                                     \
+  (((x) & 0x00000000000000FFull) << 56)
+#endif
+
+namespace workerd::api::node {
+
+namespace {
+
+constexpr char HEX_DIGITS[] = "0123456789abcdef";
+constexpr char BASE64_TABLE[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+inline int hexDigitValue(kj::byte c) {
+  if ('0' <= c && c <= '9') {
+    return c - '0';
+  } else if ('a' <= c && c <= 'f') {
+    return c - ('a' - 10);
+  } else if ('A' <= c && c <= 'F') {
+    return c - ('A' - 10);
+  } else {
+    return -1;
+  }
+}
+
+template <typename T>
+inline void swapElements(kj::ArrayPtr<kj::byte> bytes) {
+  // The bytes may come from any Buffer, so they aren't necessarily aligned for T.
+  KJ_DASSERT(bytes.size() % sizeof(T) == 0);
+  for (size_t i = 0; i + sizeof(T) <= bytes.size(); i += sizeof(T)) {
+    T value;
+    memcpy(&value, bytes.begin() + i, sizeof(T));
+    if constexpr (sizeof(T) == 2) {
+      value = BSWAP_2(value);
+    } else if constexpr (sizeof(T) == 4) {
+      value = BSWAP_4(value);
+    } else {
+      value = BSWAP_8(value);
+    }
+    memcpy(bytes.begin() + i, &value, sizeof(T));
+  }
+}
+
+#if BUFFER_SIMD_AVX2
+
+// Each of the functions below processes as much of its input as it can in whole vectors, and
+// returns how far it got, leaving the rest to the corresponding scalar function.
+
+#define AVX2_FUNCTION __attribute__((target("avx2")))
+
+AVX2_FUNCTION size_t swapBytesAvx2(kj::ArrayPtr<kj::byte> bytes, __m256i shuffle) {
+  size_t i = 0;
+  for (; i + 32 <= bytes.size(); i += 32) {
+    auto p = reinterpret_cast<__m256i*>(bytes.begin() + i);
+    _mm256_storeu_si256(p, _mm256_shuffle_epi8(_mm256_loadu_si256(p), shuffle));
+  }
+  return i;
+}
+
+AVX2_FUNCTION size_t swapBytes16Avx2(kj::ArrayPtr<kj::byte> bytes) {
+  return swapBytesAvx2(bytes, _mm256_setr_epi8(
+      1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14,
+      1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14));
+}
+
+AVX2_FUNCTION size_t swapBytes32Avx2(kj::ArrayPtr<kj::byte> bytes) {
+  return swapBytesAvx2(bytes, _mm256_setr_epi8(
+      3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12,
+      3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12));
+}
+
+AVX2_FUNCTION size_t swapBytes64Avx2(kj::ArrayPtr<kj::byte> bytes) {
+  return swapBytesAvx2(bytes, _mm256_setr_epi8(
+      7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8,
+      7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8));
+}
+
+AVX2_FUNCTION size_t encodeHexAvx2(kj::ArrayPtr<const kj::byte> input, kj::byte* output) {
+  // Widen 16 bytes to 16-bit lanes holding (high nibble, low nibble), then look both up at once.
+  const auto digits = _mm256_setr_epi8(
+      '0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'a', 'b', 'c', 'd', 'e', 'f',
+      '0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'a', 'b', 'c', 'd', 'e', 'f');
+  const auto lowNibble = _mm256_set1_epi16(0x000f);
+
+  size_t i = 0;
+  for (; i + 16 <= input.size(); i += 16) {
+    auto in = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input.begin() + i));
+    auto wide = _mm256_cvtepu8_epi16(in);
+    auto nibbles = _mm256_or_si256(_mm256_srli_epi16(wide, 4),
+                                   _mm256_slli_epi16(_mm256_and_si256(wide, lowNibble), 8));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(output + i * 2),
+                        _mm256_shuffle_epi8(digits, nibbles));
+  }
+  return i;
+}
+
+AVX2_FUNCTION size_t decodeHexAvx2(kj::ArrayPtr<const kj::byte> input, kj::byte* output) {
+  // Returns the number of input characters consumed; stops before any vector containing a
+  // character that isn't a hex digit, so that the scalar code can find exactly where to stop.
+  const auto zero = _mm256_set1_epi8('0');
+  const auto nine = _mm256_set1_epi8(9);
+  const auto lowerA = _mm256_set1_epi8('a');
+  const auto five = _mm256_set1_epi8(5);
+  const auto ten = _mm256_set1_epi8(10);
+  const auto caseBit = _mm256_set1_epi8(0x20);
+  const auto weights = _mm256_set1_epi16(0x0110);  // high nibble * 16 + low nibble * 1
+
+  size_t i = 0;
+  for (; i + 32 <= input.size(); i += 32) {
+    auto c = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(input.begin() + i));
+
+    // Unsigned range checks: x <= n iff min(x, n) == x.
+    auto digit = _mm256_sub_epi8(c, zero);
+    auto isDigit = _mm256_cmpeq_epi8(_mm256_min_epu8(digit, nine), digit);
+    auto letter = _mm256_sub_epi8(_mm256_or_si256(c, caseBit), lowerA);
+    auto isLetter = _mm256_cmpeq_epi8(_mm256_min_epu8(letter, five), letter);
+    if (_mm256_movemask_epi8(_mm256_or_si256(isDigit, isLetter)) != -1) break;
+
+    auto nibbles = _mm256_blendv_epi8(_mm256_add_epi8(letter, ten), digit, isDigit);
+    auto pairs = _mm256_maddubs_epi16(nibbles, weights);
+    auto packed = _mm256_packus_epi16(pairs, pairs);
+    auto result = _mm256_permute4x64_epi64(packed, 0x08);  // qwords 0 and 2 to the bottom
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(output + i / 2),
+                     _mm256_castsi256_si128(result));
+  }
+  return i;
+}
+
+AVX2_FUNCTION size_t encodeBase64Avx2(
+    kj::ArrayPtr<const kj::byte> input, kj::byte* output, Base64Mode mode) {
+  // Turns 24 input bytes into 32 characters per iteration. See Wojciech Muła and Daniel Lemire,
+  // "Faster Base64 Encoding and Decoding using AVX2 Instructions" (2018).
+  const auto spread = _mm256_setr_epi8(
+      1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10,
+      1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10);
+  const char c62 = mode == Base64Mode::URL ? '-' : '+';
+  const char c63 = mode == Base64Mode::URL ? '_' : '/';
+  const auto offsets = _mm256_setr_epi8(
+      'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+      '0' - 52, '0' - 52, '0' - 52, c62 - 62, c63 - 63, 'A', 0, 0,
+      'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+      '0' - 52, '0' - 52, '0' - 52, c62 - 62, c63 - 63, 'A', 0, 0);
+
+  size_t i = 0;
+  size_t k = 0;
+  // Each iteration loads 28 bytes (two overlapping 16-byte loads 12 bytes apart) but uses 24.
+  for (; i + 28 <= input.size(); i += 24, k += 32) {
+    auto lo = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input.begin() + i));
+    auto hi = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input.begin() + i + 12));
+    auto in = _mm256_shuffle_epi8(_mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1),
+                                  spread);
+
+    // Extract the four 6-bit indices of each 3-byte group into separate bytes.
+    auto t0 = _mm256_and_si256(in, _mm256_set1_epi32(0x0fc0fc00));
+    auto t1 = _mm256_mulhi_epu16(t0, _mm256_set1_epi32(0x04000040));
+    auto t2 = _mm256_and_si256(in, _mm256_set1_epi32(0x003f03f0));
+    auto t3 = _mm256_mullo_epi16(t2, _mm256_set1_epi32(0x01000010));
+    auto indices = _mm256_or_si256(t1, t3);
+
+    // Map each index range to a slot in `offsets`: 0..25 -> 13, 26..51 -> 0, 52..61 -> 1..10,
+    // 62 -> 11, 63 -> 12.
+    auto slots = _mm256_subs_epu8(indices, _mm256_set1_epi8(51));
+    auto isUpper = _mm256_cmpgt_epi8(_mm256_set1_epi8(26), indices);
+    slots = _mm256_or_si256(slots, _mm256_and_si256(isUpper, _mm256_set1_epi8(13)));
+    auto chars = _mm256_add_epi8(indices, _mm256_shuffle_epi8(offsets, slots));
+
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(output + k), chars);
+  }
+  return i;
+}
+
+AVX2_FUNCTION inline __m256i inRange(__m256i c, char lo, char hi) {
+  // 0xff in each byte of `c` that is in [lo, hi], 0 in the others.
+  return _mm256_cmpeq_epi8(
+      _mm256_min_epu8(_mm256_max_epu8(c, _mm256_set1_epi8(lo)), _mm256_set1_epi8(hi)), c);
+}
+
+AVX2_FUNCTION inline __m256i equals(__m256i c, char x) {
+  return _mm256_cmpeq_epi8(c, _mm256_set1_epi8(x));
+}
+
+AVX2_FUNCTION size_t decodeBase64Avx2(kj::ArrayPtr<const kj::byte> input,
+                                      kj::ArrayPtr<kj::byte> output) {
+  // Decodes 32 characters into 24 bytes per iteration, as long as all 32 belong to the base64 or
+  // base64url alphabet. Returns the number of characters consumed, which is always a multiple of
+  // 32, and so of 4; the output is 3/4 of that.
+  const auto pack = _mm256_setr_epi8(
+      2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+      2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+  const auto compact = _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 7, 7);
+
+  size_t i = 0;
+  size_t k = 0;
+  for (; i + 32 <= input.size() && k + 24 <= output.size(); i += 32, k += 24) {
+    auto c = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(input.begin() + i));
+
+    auto upper = inRange(c, 'A', 'Z');
+    auto lower = inRange(c, 'a', 'z');
+    auto digit = inRange(c, '0', '9');
+    auto is62 = _mm256_or_si256(equals(c, '+'), equals(c, '-'));
+    auto is63 = _mm256_or_si256(equals(c, '/'), equals(c, '_'));
+    auto valid = _mm256_or_si256(_mm256_or_si256(upper, lower),
+                                 _mm256_or_si256(digit, _mm256_or_si256(is62, is63)));
+    if (_mm256_movemask_epi8(valid) != -1) break;
+
+    auto values = _mm256_or_si256(
+        _mm256_or_si256(
+            _mm256_and_si256(upper, _mm256_sub_epi8(c, _mm256_set1_epi8('A'))),
+            _mm256_and_si256(lower, _mm256_sub_epi8(c, _mm256_set1_epi8('a' - 26)))),
+        _mm256_or_si256(
+            _mm256_and_si256(digit, _mm256_add_epi8(c, _mm256_set1_epi8(52 - '0'))),
+            _mm256_or_si256(_mm256_and_si256(is62, _mm256_set1_epi8(62)),
+                            _mm256_and_si256(is63, _mm256_set1_epi8(63)))));
+
+    // Combine each group of four 6-bit values into a 24-bit value, then gather the 3 bytes of
+    // each, big-endian.
+    auto pairs = _mm256_maddubs_epi16(values, _mm256_set1_epi32(0x01400140));
+    auto groups = _mm256_madd_epi16(pairs, _mm256_set1_epi32(0x00011000));
+    auto bytes = _mm256_permutevar8x32_epi32(_mm256_shuffle_epi8(groups, pack), compact);
+
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(output.begin() + k),
+                     _mm256_castsi256_si128(bytes));
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(output.begin() + k + 16),
+                     _mm256_extracti128_si256(bytes, 1));
+  }
+  return i;
+}
+
+AVX2_FUNCTION size_t clearHighBitsAvx2(kj::ArrayPtr<const kj::byte> input, kj::byte* output) {
+  const auto mask = _mm256_set1_epi8(0x7f);
+  size_t i = 0;
+  for (; i + 32 <= input.size(); i += 32) {
+    auto in = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(input.begin() + i));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(output + i), _mm256_and_si256(in, mask));
+  }
+  return i;
+}
+
+#undef AVX2_FUNCTION
+
+#endif  // BUFFER_SIMD_AVX2
+
+}  // namespace
+
+namespace scalar {
+
+void swapBytes16(kj::ArrayPtr<kj::byte> bytes) { swapElements<uint16_t>(bytes); }
+void swapBytes32(kj::ArrayPtr<kj::byte> bytes) { swapElements<uint32_t>(bytes); }
+void swapBytes64(kj::ArrayPtr<kj::byte> bytes) { swapElements<uint64_t>(bytes); }
+
+void encodeHex(kj::ArrayPtr<const kj::byte> input, kj::ArrayPtr<kj::byte> output) {
+  KJ_DASSERT(output.size() == input.size() * 2);
+  for (size_t i = 0; i < input.size(); i++) {
+    output[i * 2] = HEX_DIGITS[input[i] >> 4];
+    output[i * 2 + 1] = HEX_DIGITS[input[i] & 0x0f];
+  }
+}
+
+size_t decodeHex(kj::ArrayPtr<const kj::byte> input, kj::ArrayPtr<kj::byte> output) {
+  KJ_DASSERT(input.size() % 2 == 0 && output.size() >= input.size() / 2);
+  size_t k = 0;
+  for (size_t i = 0; i + 1 < input.size(); i += 2) {
+    int hi = hexDigitValue(input[i]);
+    int lo = hexDigitValue(input[i + 1]);
+    if (hi < 0 || lo < 0) break;
+    output[k++] = (hi << 4) | lo;
+  }
+  return k;
+}
+
+void encodeBase64(kj::ArrayPtr<const kj::byte> input, kj::ArrayPtr<kj::byte> output,
+                  Base64Mode mode) {
+  KJ_DASSERT(output.size() == base64_encoded_size(input.size(), mode));
+  const char* table = mode == Base64Mode::URL ? base64_table_url : BASE64_TABLE;
+
+  size_t i = 0;
+  size_t k = 0;
+  for (; i + 3 <= input.size(); i += 3, k += 4) {
+    uint a = input[i];
+    uint b = input[i + 1];
+    uint c = input[i + 2];
+    output[k] = table[a >> 2];
+    output[k + 1] = table[((a & 0x03) << 4) | (b >> 4)];
+    output[k + 2] = table[((b & 0x0f) << 2) | (c >> 6)];
+    output[k + 3] = table[c & 0x3f];
+  }
+
+  size_t remaining = input.size() - i;
+  if (remaining > 0) {
+    uint a = input[i];
+    uint b = remaining > 1 ? input[i + 1] : 0;
+    output[k++] = table[a >> 2];
+    output[k++] = table[((a & 0x03) << 4) | (b >> 4)];
+    if (remaining > 1) {
+      output[k++] = table[(b & 0x0f) << 2];
+    }
+    if (mode == Base64Mode::NORMAL) {
+      while (k < output.size()) output[k++] = '=';
+    }
+  }
+}
+
+size_t decodeBase64(kj::ArrayPtr<const kj::byte> input, kj::ArrayPtr<kj::byte> output) {
+  return base64_decode(output.asChars().begin(), output.size(), input.begin(), input.size());
+}
+
+void clearHighBits(kj::ArrayPtr<const kj::byte> input, kj::ArrayPtr<kj::byte> output) {
+  KJ_DASSERT(output.size() == input.size());
+  for (size_t i = 0; i < input.size(); i++) {
+    output[i] = input[i] & 0x7f;
+  }
+}
+
+}  // namespace scalar
+
+bool haveAvx2() {
+#if BUFFER_SIMD_AVX2
+  static const bool result = __builtin_cpu_supports("avx2");
+  return result;
+#else
+  return false;
+#endif
+}
+
+void swapBytes16(kj::ArrayPtr<kj::byte> bytes) {
+  size_t done = 0;
+#if BUFFER_SIMD_AVX2
+  if (haveAvx2()) done = swapBytes16Avx2(bytes);
+#endif
+  scalar::swapBytes16(bytes.slice(done, bytes.size()));
+}
+
+void swapBytes32(kj::ArrayPtr<kj::byte> bytes) {
+  size_t done = 0;
+#if BUFFER_SIMD_AVX2
+  if (haveAvx2()) done = swapBytes32Avx2(bytes);
+#endif
+  scalar::swapBytes32(bytes.slice(done, bytes.size()));
+}
+
+void swapBytes64(kj::ArrayPtr<kj::byte> bytes) {
+  size_t done = 0;
+#if BUFFER_SIMD_AVX2
+  if (haveAvx2()) done = swapBytes64Avx2(bytes);
+#endif
+  scalar::swapBytes64(bytes.slice(done, bytes.size()));
+}
+
+void encodeHex(kj::ArrayPtr<const kj::byte> input, kj::ArrayPtr<kj::byte> output) {
+  KJ_DASSERT(output.size() == input.size() * 2);
+  size_t done = 0;
+#if BUFFER_SIMD_AVX2
+  if (haveAvx2()) done = encodeHexAvx2(input, output.begin());
+#endif
+  scalar::encodeHex(input.slice(done, input.size()), output.slice(done * 2, output.size()));
+}
+
+size_t decodeHex(kj::ArrayPtr<const kj::byte> input, kj::ArrayPtr<kj::byte> output) {
+  KJ_DASSERT(input.size() % 2 == 0 && output.size() >= input.size() / 2);
+  size_t done = 0;
+#if BUFFER_SIMD_AVX2
+  if (haveAvx2()) done = decodeHexAvx2(input, output.begin());
+#endif
+  return done / 2 +
+      scalar::decodeHex(input.slice(done, input.size()), output.slice(done / 2, output.size()));
+}
+
+void encodeBase64(kj::ArrayPtr<const kj::byte> input, kj::ArrayPtr<kj::byte> output,
+                  Base64Mode mode) {
+  KJ_DASSERT(output.size() == base64_encoded_size(input.size(), mode));
+  size_t done = 0;
+#if BUFFER_SIMD_AVX2
+  if (haveAvx2()) done = encodeBase64Avx2(input, output.begin(), mode);
+#endif
+  // `done` is a multiple of 3, so the rest encodes independently.
+  scalar::encodeBase64(input.slice(done, input.size()),
+                       output.slice(done / 3 * 4, output.size()), mode);
+}
+
+size_t decodeBase64(kj::ArrayPtr<const kj::byte> input, kj::ArrayPtr<kj::byte> output) {
+  size_t done = 0;
+#if BUFFER_SIMD_AVX2
+  if (haveAvx2()) done = decodeBase64Avx2(input, output);
+#endif
+  // `done` is a multiple of 4 and consists only of valid characters, so the rest decodes
+  // independently.
+  size_t written = done / 4 * 3;
+  return written + scalar::decodeBase64(input.slice(done, input.size()),
+                                        output.slice(written, output.size()));
+}
+
+void clearHighBits(kj::ArrayPtr<const kj::byte> input, kj::ArrayPtr<kj::byte> output) {
+  KJ_DASSERT(output.size() == input.size());
+  size_t done = 0;
+#if BUFFER_SIMD_AVX2
+  if (haveAvx2()) done = clearHighBitsAvx2(input, output.begin());
+#endif
+  scalar::clearHighBits(input.slice(done, input.size()), output.slice(done, output.size()));
+}
+
+}  // namespace workerd::api::node
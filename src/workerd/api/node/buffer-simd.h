@@ -0,0 +1,61 @@
+// Copyright (c) 2017-2023 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#pragma once
+
+#include "buffer-base64.h"
+#include <kj/common.h>
+
+namespace workerd::api::node {
+
+// Kernels for node:buffer's encoding conversions and byte swaps, which are commonly applied to
+// multi-megabyte payloads. Each function dispatches at run time to an AVX2 implementation on
+// x86-64 CPUs that support it, and otherwise uses a portable scalar loop. The scalar versions are
+// also exposed in the `scalar` namespace, so that tests can check the two agree.
+
+void swapBytes16(kj::ArrayPtr<kj::byte> bytes);
+void swapBytes32(kj::ArrayPtr<kj::byte> bytes);
+void swapBytes64(kj::ArrayPtr<kj::byte> bytes);
+// Reverse the byte order of each 2-, 4-, or 8-byte element of `bytes`, whose size must be a
+// multiple of the element size. `bytes` need not be aligned.
+
+void encodeHex(kj::ArrayPtr<const kj::byte> input, kj::ArrayPtr<kj::byte> output);
+// Writes two lower-case hex digits per byte of `input`. `output` must be exactly twice as big.
+
+size_t decodeHex(kj::ArrayPtr<const kj::byte> input, kj::ArrayPtr<kj::byte> output);
+// Decodes pairs of hex digits from `input`, which must have an even size, into `output`, which
+// must be at least half as big. Like Node.js, stops at the first pair that isn't valid hex.
+// Returns the number of bytes written.
+
+void encodeBase64(kj::ArrayPtr<const kj::byte> input, kj::ArrayPtr<kj::byte> output,
+                  Base64Mode mode);
+// `output` must be exactly base64_encoded_size(input.size(), mode) bytes. Like Node.js, pads with
+// '=' in NORMAL mode but not in URL mode.
+
+size_t decodeBase64(kj::ArrayPtr<const kj::byte> input, kj::ArrayPtr<kj::byte> output);
+// Equivalent to base64_decode(): accepts both alphabets, and skips characters that aren't part of
+// either. Returns the number of bytes written.
+
+void clearHighBits(kj::ArrayPtr<const kj::byte> input, kj::ArrayPtr<kj::byte> output);
+// Copies `input` to `output`, which must be the same size, masking each byte with 0x7f. This is
+// how Node.js converts to 'ascii'.
+
+bool haveAvx2();
+// Whether the functions above use their AVX2 implementations on this machine.
+
+namespace scalar {
+
+void swapBytes16(kj::ArrayPtr<kj::byte> bytes);
+void swapBytes32(kj::ArrayPtr<kj::byte> bytes);
+void swapBytes64(kj::ArrayPtr<kj::byte> bytes);
+void encodeHex(kj::ArrayPtr<const kj::byte> input, kj::ArrayPtr<kj::byte> output);
+size_t decodeHex(kj::ArrayPtr<const kj::byte> input, kj::ArrayPtr<kj::byte> output);
+void encodeBase64(kj::ArrayPtr<const kj::byte> input, kj::ArrayPtr<kj::byte> output,
+                  Base64Mode mode);
+size_t decodeBase64(kj::ArrayPtr<const kj::byte> input, kj::ArrayPtr<kj::byte> output);
+void clearHighBits(kj::ArrayPtr<const kj::byte> input, kj::ArrayPtr<kj::byte> output);
+
+}  // namespace scalar
+
+}  // namespace workerd::api::node
@@ -5,47 +5,13 @@
 
 #include "buffer.h"
 #include "buffer-base64.h"
+#include "buffer-simd.h"
 #include "buffer-string-search.h"
 #include <workerd/jsg/buffersource.h>
 #include <workerd/api/crypto-impl.h>
-#include <kj/encoding.h>
+#include <workerd/util/byte-search.h>
 #include <algorithm>
 
-// These are defined by <sys/byteorder.h> or <netinet/in.h> on some systems.
-// To avoid warnings, undefine them before redefining them.
-#ifdef BSWAP_2
-# undef BSWAP_2
-#endif
-#ifdef BSWAP_4
-# undef BSWAP_4
-#endif
-#ifdef BSWAP_8
-# undef BSWAP_8
-#endif
-
-#if defined(_MSC_VER)
-#include <intrin.h>
-#define BSWAP_2(x) _byteswap_ushort(x)
-#define BSWAP_4(x) _byteswap_ulong(x)
-#define BSWAP_8(x) _byteswap_uint64(x)
-#else
-#define BSWAP_2(x) ((x) << 8) | ((x) >> 8)
-#define BSWAP_4(x)                                                            \
-  (((x) & 0xFF) << 24)  |                                                     \
-  (((x) & 0xFF00) << 8) |                                                     \
-  (((x) >> 8) & 0xFF00) |                                                     \
-  (((x) >> 24) & 0xFF)
-#define BSWAP_8(x)                                                            \
-  (((x) & 0xFF00000000000000ull) >> 56) |                                     \
-  (((x) & 0x00FF000000000000ull) >> 40) |                                     \
-  (((x) & 0x0000FF0000000000ull) >> 24) |                                     \
-  (((x) & 0x000000FF00000000ull) >> 8)  |                                     \
-  (((x) & 0x00000000FF000000ull) << 8)  |                                     \
-  (((x) & 0x0000000000FF0000ull) << 24) |                                     \
-  (((x) & 0x000000000000FF00ull) << 40) |                                     \
-  (((x) & 0x00000000000000FFull) << 56)
-#endif
-
 namespace workerd::api::node {
 
 const int8_t unbase64_table[256] =
@@ -69,22 +35,6 @@ const int8_t unbase64_table[256] =
 
 namespace {
 
-template <typename T>
-void SwapBytes(kj::ArrayPtr<kj::byte> bytes) {
-  KJ_DASSERT((bytes.size() % sizeof(T)) == 0);
-  uint32_t len = bytes.size() / sizeof(T);
-  T* data = reinterpret_cast<T*>(bytes.begin());
-  for (uint32_t i = 0; i < len; i++) {
-    if constexpr (kj::isSameType<T, uint16_t>()) {
-      data[i] = BSWAP_2(data[i]);
-    } else if constexpr (kj::isSameType<T, uint32_t>()) {
-      data[i] = BSWAP_4(data[i]);
-    } else {
-      data[i] = BSWAP_8(data[i]);
-    }
-  }
-}
-
 enum class Encoding {
   ASCII,
   LATIN1,
@@ -115,18 +65,6 @@ Encoding getEncoding(kj::StringPtr encoding) {
   KJ_UNREACHABLE;
 }
 
-kj::Maybe<uint> tryFromHexDigit(char c) {
-  if ('0' <= c && c <= '9') {
-    return c - '0';
-  } else if ('a' <= c && c <= 'f') {
-    return c - ('a' - 10);
-  } else if ('A' <= c && c <= 'F') {
-    return c - ('A' - 10);
-  } else {
-    return nullptr;
-  }
-}
-
 kj::Array<byte> decodeHexTruncated(kj::ArrayPtr<kj::byte> text, bool strict = false) {
   // We do not use kj::decodeHex because we need to match Node.js'
   // behavior of truncating the response at the first invalid hex
@@ -138,30 +76,15 @@ kj::Array<byte> decodeHexTruncated(kj::ArrayPtr<kj::byte> text, bool strict = fa
     }
     text = text.slice(0, text.size() - 1);
   }
-  kj::Vector vec = kj::Vector<kj::byte>(text.size() / 2);
-
-  for (size_t i = 0; i < text.size(); i += 2) {
-    byte b = 0;
-    KJ_IF_MAYBE(d1, tryFromHexDigit(text[i])) {
-      b = *d1 << 4;
-    } else {
-      if (strict) {
-        JSG_FAIL_REQUIRE(TypeError, "The text is not valid hex");
-      }
-      break;
-    }
-    KJ_IF_MAYBE(d2, tryFromHexDigit(text[i+1])) {
-      b |= *d2;
-    } else {
-      if (strict) {
-        JSG_FAIL_REQUIRE(TypeError, "The text is not valid hex");
-      }
-      break;
+  auto dest = kj::heapArray<kj::byte>(text.size() / 2);
+  auto len = decodeHex(text, dest);
+  if (len < dest.size()) {
+    if (strict) {
+      JSG_FAIL_REQUIRE(TypeError, "The text is not valid hex");
     }
-    vec.add(b);
+    return dest.slice(0, len).attach(kj::mv(dest));
   }
-
-  return vec.releaseAsArray();
+  return kj::mv(dest);
 }
 
 uint32_t writeInto(
@@ -195,21 +118,17 @@ uint32_t writeInto(
       // Fall-through
     case Encoding::BASE64URL: {
       auto str = kj::str(string);
-      return base64_decode(
-          dest.asChars().begin(),
-          dest.size(),
-          str.begin(),
-          str.size());
+      return decodeBase64(str.asBytes(), dest);
     }
     case Encoding::HEX: {
       KJ_STACK_ARRAY(kj::byte, buf, string->Length(), 1024, 536870888);
       string->WriteOneByte(js.v8Isolate, buf.begin(), 0, -1,
                            v8::String::NO_NULL_TERMINATION |
                            v8::String::REPLACE_INVALID_UTF8);
-      auto bytes = decodeHexTruncated(buf, false);
-      auto amountToCopy = kj::min(bytes.size(), dest.size());
-      memcpy(dest.begin(), bytes.begin(), amountToCopy);
-      return amountToCopy;
+      // Decode straight into `dest`, ignoring any odd trailing digit and any pairs that wouldn't
+      // fit.
+      auto text = buf.slice(0, kj::min(buf.size() & ~size_t(1), dest.size() * 2));
+      return decodeHex(text, dest.slice(0, text.size() / 2));
     }
   }
   KJ_UNREACHABLE;
@@ -250,11 +169,7 @@ kj::Array<kj::byte> decodeStringImpl(
                                       v8::String::NO_NULL_TERMINATION |
                                       v8::String::REPLACE_INVALID_UTF8);
       auto dest = kj::heapArray<kj::byte>(base64_decoded_size(buf.begin(), len));
-      len = base64_decode(
-        dest.asChars().begin(),
-        dest.size(),
-        buf.begin(),
-        buf.size());
+      len = decodeBase64(buf, dest);
       return dest.slice(0, len).attach(kj::mv(dest));
     }
     case Encoding::HEX: {
@@ -278,11 +193,13 @@ uint32_t BufferUtil::byteLength(jsg::Lock& js, v8::Local<v8::String> str) {
 
 int BufferUtil::compare(
     jsg::Lock& js,
-    kj::Array<kj::byte> one,
-    kj::Array<kj::byte> two,
+    v8::Local<v8::ArrayBufferView> one,
+    v8::Local<v8::ArrayBufferView> two,
     jsg::Optional<CompareOptions> maybeOptions) {
-  kj::ArrayPtr<kj::byte> ptrOne = one;
-  kj::ArrayPtr<kj::byte> ptrTwo = two;
+  kj::byte scratchOne[jsg::ON_HEAP_BYTES_MAX];
+  kj::byte scratchTwo[jsg::ON_HEAP_BYTES_MAX];
+  auto ptrOne = jsg::asBytesBorrowed(one, scratchOne);
+  auto ptrTwo = jsg::asBytesBorrowed(two, scratchTwo);
 
   // The options allow comparing subranges within the two inputs.
   KJ_IF_MAYBE(options, maybeOptions) {
@@ -310,7 +227,7 @@ int BufferUtil::compare(
 
 kj::Array<kj::byte> BufferUtil::concat(
     jsg::Lock& js,
-    kj::Array<kj::Array<kj::byte>> list,
+    kj::Array<v8::Local<v8::ArrayBufferView>> list,
     uint32_t length) {
   if (length == 0) return kj::Array<kj::byte>();
 
@@ -318,7 +235,9 @@ kj::Array<kj::byte> BufferUtil::concat(
   uint32_t offset = 0;
   uint32_t remaining = length;
   auto ptr = dest.begin();
-  for (auto& src : list) {
+  kj::byte scratch[jsg::ON_HEAP_BYTES_MAX];
+  for (auto& view : list) {
+    auto src = jsg::asBytesBorrowed(view, scratch);
     if (src.size() == 0) continue;
     auto amountToCopy = kj::min(src.size(), remaining);
     std::copy(src.begin(), src.begin() + amountToCopy, ptr + offset);
@@ -342,14 +261,15 @@ kj::Array<kj::byte> BufferUtil::decodeString(
 
 void BufferUtil::fillImpl(
     jsg::Lock& js,
-    kj::Array<kj::byte> buffer,
-    kj::OneOf<v8::Local<v8::String>, jsg::BufferSource> value,
+    v8::Local<v8::ArrayBufferView> bufferHandle,
+    kj::OneOf<v8::Local<v8::String>, v8::Local<v8::ArrayBufferView>> value,
     uint32_t start,
     uint32_t end,
     jsg::Optional<kj::String> encoding) {
   if (end <= start) return;
+  auto buffer = jsg::asBytesBorrowed(bufferHandle);
 
-  const auto fillFromBytes = [&](kj::ArrayPtr<kj::byte> source) {
+  const auto fillFromBytes = [&](kj::ArrayPtr<const kj::byte> source) {
     if (source.size() == 0) return;
     auto ptr = buffer.begin() + start;
     auto src = source.begin();
@@ -369,8 +289,9 @@ void BufferUtil::fillImpl(
       auto decoded = decodeStringImpl(js, string, getEncoding(enc), true /* strict */);
       fillFromBytes(decoded);
     }
-    KJ_CASE_ONEOF(source, jsg::BufferSource) {
-      fillFromBytes(source.asArrayPtr());
+    KJ_CASE_ONEOF(source, v8::Local<v8::ArrayBufferView>) {
+      kj::byte scratch[jsg::ON_HEAP_BYTES_MAX];
+      fillFromBytes(jsg::asBytesBorrowed(source, scratch));
     }
   }
 }
@@ -413,10 +334,27 @@ int32_t indexOfOffset(size_t length,
   }
 }
 
+jsg::Optional<uint32_t> findBytesFrom(
+    kj::ArrayPtr<const kj::byte> hayStack,
+    kj::ArrayPtr<const kj::byte> needle,
+    size_t offset,
+    bool isForward) {
+  // Finds the first match starting at or after `offset`, or the last match starting at or before
+  // it, like SearchString() does for two-byte characters.
+  if (isForward) {
+    return findBytes(hayStack.slice(offset, hayStack.size()), needle)
+        .map([&](size_t index) -> uint32_t { return index + offset; });
+  } else {
+    auto searchable = hayStack.slice(0, kj::min(offset + needle.size(), hayStack.size()));
+    return findLastBytes(searchable, needle)
+        .map([](size_t index) -> uint32_t { return index; });
+  }
+}
+
 jsg::Optional<uint32_t> indexOfBuffer(
     jsg::Lock& js,
-    kj::ArrayPtr<kj::byte> hayStack,
-    jsg::BufferSource needle,
+    kj::ArrayPtr<const kj::byte> hayStack,
+    kj::ArrayPtr<const kj::byte> needle,
     int32_t byteOffset,
     kj::String encoding,
     bool isForward) {
@@ -439,19 +377,13 @@ jsg::Optional<uint32_t> indexOfBuffer(
     result = SearchString(
       reinterpret_cast<const uint16_t*>(hayStack.asChars().begin()),
       hayStack.size() / 2,
-      reinterpret_cast<const uint16_t*>(needle.asArrayPtr().asChars().begin()),
+      reinterpret_cast<const uint16_t*>(needle.asChars().begin()),
       needle.size() / 2,
       optOffset / 2,
       isForward);
     result *= 2;
   } else {
-    result = SearchString(
-      hayStack.asBytes().begin(),
-      hayStack.size(),
-      needle.asArrayPtr().asBytes().begin(),
-      needle.size(),
-      optOffset,
-      isForward);
+    return findBytesFrom(hayStack, needle, optOffset, isForward);
   }
 
   if (result == hayStack.size()) return nullptr;
@@ -461,7 +393,7 @@ jsg::Optional<uint32_t> indexOfBuffer(
 
 jsg::Optional<uint32_t> indexOfString(
     jsg::Lock& js,
-    kj::ArrayPtr<kj::byte> hayStack,
+    kj::ArrayPtr<const kj::byte> hayStack,
     v8::Local<v8::String> needle,
     int32_t byteOffset,
     kj::String encoding,
@@ -500,13 +432,7 @@ jsg::Optional<uint32_t> indexOfString(
       isForward);
     result *= 2;
   } else {
-    result = SearchString(
-      hayStack.asBytes().begin(),
-      hayStack.size(),
-      decodedNeedle.asBytes().begin(),
-      decodedNeedle.size(),
-      optOffset,
-      isForward);
+    return findBytesFrom(hayStack, decodedNeedle, optOffset, isForward);
   }
 
   if (result == hayStackLength) return nullptr;
@@ -516,7 +442,7 @@ jsg::Optional<uint32_t> indexOfString(
 
 v8::Local<v8::String> toStringImpl(
     jsg::Lock& js,
-    kj::ArrayPtr<kj::byte> bytes,
+    kj::ArrayPtr<const kj::byte> bytes,
     uint32_t start,
     uint32_t end,
     Encoding encoding) {
@@ -524,11 +450,9 @@ v8::Local<v8::String> toStringImpl(
   if (slice.size() == 0) return v8::String::Empty(js.v8Isolate);
   switch (encoding) {
     case Encoding::ASCII: {
-      // TODO(perf): We can look at making this more performant later.
-      // Essentially we have to modify the buffer such that every byte
-      // has the highest bit turned off. Whee! Node.js has a faster
-      // algorithm that it implements so we can likely adopt that.
-      kj::Array<kj::byte> copy = KJ_MAP(b, slice) -> kj::byte { return b & 0x7f; };
+      // Node.js decodes 'ascii' by turning off the highest bit of every byte.
+      auto copy = kj::heapArray<kj::byte>(slice.size());
+      clearHighBits(slice, copy);
       return jsg::v8StrFromLatin1(js.v8Isolate, copy);
     }
     case Encoding::LATIN1: {
@@ -540,17 +464,23 @@ v8::Local<v8::String> toStringImpl(
     case Encoding::UTF16LE: {
       // TODO(soon): Using just the slice here results in v8 hitting an IsAligned assertion.
       auto data = kj::heapArray<uint16_t>(
-          reinterpret_cast<uint16_t*>(slice.begin()), slice.size() / 2);
+          reinterpret_cast<const uint16_t*>(slice.begin()), slice.size() / 2);
       return jsg::v8Str<uint16_t>(js.v8Isolate, data);
     }
     case Encoding::BASE64: {
-      return jsg::v8Str(js.v8Isolate, kj::encodeBase64(slice));
+      auto text = kj::heapArray<kj::byte>(base64_encoded_size(slice.size(), Base64Mode::NORMAL));
+      encodeBase64(slice, text, Base64Mode::NORMAL);
+      return jsg::v8StrFromLatin1(js.v8Isolate, text);
     }
     case Encoding::BASE64URL: {
-      return jsg::v8Str(js.v8Isolate, kj::encodeBase64Url(slice));
+      auto text = kj::heapArray<kj::byte>(base64_encoded_size(slice.size(), Base64Mode::URL));
+      encodeBase64(slice, text, Base64Mode::URL);
+      return jsg::v8StrFromLatin1(js.v8Isolate, text);
     }
     case Encoding::HEX: {
-      return jsg::v8Str(js.v8Isolate, kj::encodeHex(slice));
+      auto text = kj::heapArray<kj::byte>(slice.size() * 2);
+      encodeHex(slice, text);
+      return jsg::v8StrFromLatin1(js.v8Isolate, text);
     }
   }
   KJ_UNREACHABLE;
@@ -560,50 +490,57 @@ v8::Local<v8::String> toStringImpl(
 
 jsg::Optional<uint32_t> BufferUtil::indexOf(
     jsg::Lock& js,
-    kj::Array<kj::byte> buffer,
-    kj::OneOf<v8::Local<v8::String>, jsg::BufferSource> value,
+    v8::Local<v8::ArrayBufferView> buffer,
+    kj::OneOf<v8::Local<v8::String>, v8::Local<v8::ArrayBufferView>> value,
     int32_t byteOffset,
     kj::String encoding,
     bool isForward) {
+  kj::byte hayStackScratch[jsg::ON_HEAP_BYTES_MAX];
+  auto hayStack = jsg::asBytesBorrowed(buffer, hayStackScratch);
 
   KJ_SWITCH_ONEOF(value) {
     KJ_CASE_ONEOF(string, v8::Local<v8::String>) {
-      return indexOfString(js, buffer, string, byteOffset, kj::mv(encoding), isForward);
+      return indexOfString(js, hayStack, string, byteOffset, kj::mv(encoding), isForward);
     }
-    KJ_CASE_ONEOF(source, jsg::BufferSource) {
-      return indexOfBuffer(js, buffer, kj::mv(source), byteOffset, kj::mv(encoding), isForward);
+    KJ_CASE_ONEOF(source, v8::Local<v8::ArrayBufferView>) {
+      kj::byte needleScratch[jsg::ON_HEAP_BYTES_MAX];
+      auto needle = jsg::asBytesBorrowed(source, needleScratch);
+      return indexOfBuffer(js, hayStack, needle, byteOffset, kj::mv(encoding), isForward);
     }
   }
   KJ_UNREACHABLE;
 }
 
-void BufferUtil::swap(jsg::Lock& js, kj::Array<kj::byte> buffer, int size) {
+void BufferUtil::swap(jsg::Lock& js, v8::Local<v8::ArrayBufferView> bufferHandle, int size) {
+  auto buffer = jsg::asBytesBorrowed(bufferHandle);
   if (buffer.size() <= 1) return;
   switch (size) {
-    case 16: return SwapBytes<uint16_t>(buffer);
-    case 32: return SwapBytes<uint32_t>(buffer);
-    case 64: return SwapBytes<uint64_t>(buffer);
+    case 16: return swapBytes16(buffer);
+    case 32: return swapBytes32(buffer);
+    case 64: return swapBytes64(buffer);
   }
   KJ_UNREACHABLE;
 }
 
 v8::Local<v8::String> BufferUtil::toString(
     jsg::Lock& js,
-    kj::Array<kj::byte> bytes,
+    v8::Local<v8::ArrayBufferView> bytes,
     uint32_t start,
     uint32_t end,
     kj::String encoding) {
-  return toStringImpl(js, bytes, start, end, getEncoding(encoding));
+  kj::byte scratch[jsg::ON_HEAP_BYTES_MAX];
+  return toStringImpl(js, jsg::asBytesBorrowed(bytes, scratch), start, end,
+                      getEncoding(encoding));
 }
 
 uint32_t BufferUtil::write(
     jsg::Lock& js,
-    kj::Array<kj::byte> buffer,
+    v8::Local<v8::ArrayBufferView> buffer,
     v8::Local<v8::String> string,
     uint32_t offset,
     uint32_t length,
     kj::String encoding) {
-  return writeInto(js, buffer, string, offset, length, getEncoding(encoding));
+  return writeInto(js, jsg::asBytesBorrowed(buffer), string, offset, length, getEncoding(encoding));
 }
 
 // ======================================================================================
@@ -683,8 +620,11 @@ v8::Local<v8::String> getBufferedString(jsg::Lock& js, kj::ArrayPtr<kj::byte> st
 }  // namespace
 
 v8::Local<v8::String> BufferUtil::decode(jsg::Lock& js,
-                                         kj::Array<kj::byte> bytes,
-                                         kj::Array<kj::byte> state) {
+                                         v8::Local<v8::ArrayBufferView> bytesHandle,
+                                         v8::Local<v8::ArrayBufferView> stateHandle) {
+  kj::byte scratch[jsg::ON_HEAP_BYTES_MAX];
+  auto bytes = jsg::asBytesBorrowed(bytesHandle, scratch);
+  auto state = jsg::asBytesBorrowed(stateHandle);
   JSG_REQUIRE(state.size() == BufferUtil::kSize, TypeError, "Invalid StringDecoder");
   auto enc = getEncoding(state);
   if (enc == Encoding::ASCII || enc == Encoding::LATIN1 || enc == Encoding::HEX) {
@@ -818,7 +758,7 @@ v8::Local<v8::String> BufferUtil::decode(jsg::Lock& js,
     }
 
     if (nread > 0) {
-      body = toStringImpl(js, kj::ArrayPtr<kj::byte>(data, data + nread), 0, nread, enc);
+      body = toStringImpl(js, kj::arrayPtr(data, nread), 0, nread, enc);
     } else {
       body = v8::String::Empty(js.v8Isolate);
     }
@@ -833,7 +773,9 @@ v8::Local<v8::String> BufferUtil::decode(jsg::Lock& js,
   return v8::String::Empty(js.v8Isolate);
 }
 
-v8::Local<v8::String> BufferUtil::flush(jsg::Lock& js, kj::Array<kj::byte> state) {
+v8::Local<v8::String> BufferUtil::flush(jsg::Lock& js,
+                                        v8::Local<v8::ArrayBufferView> stateHandle) {
+  auto state = jsg::asBytesBorrowed(stateHandle);
   JSG_REQUIRE(state.size() == BufferUtil::kSize, TypeError, "Invalid StringDecoder");
   auto enc = getEncoding(state);
   if (enc == Encoding::ASCII || enc == Encoding::HEX || enc == Encoding::LATIN1) {
@@ -12,6 +12,13 @@ namespace workerd::api::node {
 
 class BufferUtil final: public jsg::Object {
   // Implements utilities in support of the Node.js Buffer
+  //
+  // Buffer arguments are taken as v8::Local<v8::ArrayBufferView> and viewed with
+  // jsg::asBytesBorrowed() rather than as kj::Array<kj::byte>, which would take a reference to
+  // each one's backing store and allocate a holder for it. Arguments that are only read are
+  // copied to the stack if V8 still keeps them on its heap, rather than being moved off it;
+  // arguments that are written to are moved off the heap, as kj::Array<kj::byte> would have done.
+  // None of these methods run JavaScript while using the bytes.
 public:
 
   uint32_t byteLength(jsg::Lock& js, v8::Local<v8::String> str);
@@ -26,12 +33,12 @@ public:
   };
 
   int compare(jsg::Lock& js,
-              kj::Array<kj::byte> one,
-              kj::Array<kj::byte> two,
+              v8::Local<v8::ArrayBufferView> one,
+              v8::Local<v8::ArrayBufferView> two,
               jsg::Optional<CompareOptions> maybeOptions);
 
   kj::Array<kj::byte> concat(jsg::Lock& js,
-                             kj::Array<kj::Array<kj::byte>> list,
+                             kj::Array<v8::Local<v8::ArrayBufferView>> list,
                              uint32_t length);
 
   kj::Array<kj::byte> decodeString(jsg::Lock& js,
@@ -39,29 +46,30 @@ public:
                                    kj::String encoding);
 
   void fillImpl(jsg::Lock& js,
-                kj::Array<kj::byte> buffer,
-                kj::OneOf<v8::Local<v8::String>, jsg::BufferSource> value,
+                v8::Local<v8::ArrayBufferView> buffer,
+                kj::OneOf<v8::Local<v8::String>, v8::Local<v8::ArrayBufferView>> value,
                 uint32_t start,
                 uint32_t end,
                 jsg::Optional<kj::String> encoding);
 
-  jsg::Optional<uint32_t> indexOf(jsg::Lock& js,
-                                  kj::Array<kj::byte> buffer,
-                                  kj::OneOf<v8::Local<v8::String>, jsg::BufferSource> value,
-                                  int32_t byteOffset,
-                                  kj::String encoding,
-                                  bool isForward);
+  jsg::Optional<uint32_t> indexOf(
+      jsg::Lock& js,
+      v8::Local<v8::ArrayBufferView> buffer,
+      kj::OneOf<v8::Local<v8::String>, v8::Local<v8::ArrayBufferView>> value,
+      int32_t byteOffset,
+      kj::String encoding,
+      bool isForward);
 
-  void swap(jsg::Lock& js, kj::Array<kj::byte> buffer, int size);
+  void swap(jsg::Lock& js, v8::Local<v8::ArrayBufferView> buffer, int size);
 
   v8::Local<v8::String> toString(jsg::Lock& js,
-                                 kj::Array<kj::byte> bytes,
+                                 v8::Local<v8::ArrayBufferView> bytes,
                                  uint32_t start,
                                  uint32_t end,
                                  kj::String encoding);
 
   uint32_t write(jsg::Lock& js,
-                 kj::Array<kj::byte> buffer,
+                 v8::Local<v8::ArrayBufferView> buffer,
                  v8::Local<v8::String> string,
                  uint32_t offset,
                  uint32_t length,
@@ -77,9 +85,9 @@ public:
   };
 
   v8::Local<v8::String> decode(jsg::Lock& js,
-                               kj::Array<kj::byte> bytes,
-                               kj::Array<kj::byte> state);
-  v8::Local<v8::String> flush(jsg::Lock& js, kj::Array<kj::byte> state);
+                               v8::Local<v8::ArrayBufferView> bytes,
+                               v8::Local<v8::ArrayBufferView> state);
+  v8::Local<v8::String> flush(jsg::Lock& js, v8::Local<v8::ArrayBufferView> state);
 
   JSG_RESOURCE_TYPE(BufferUtil) {
     JSG_METHOD(byteLength);
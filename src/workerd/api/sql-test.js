@@ -97,20 +97,56 @@ function test(sql) {
   // Accessing pragmas is not allowed
   requireException(() => sql.exec("PRAGMA hard_heap_limit = 1024"),
     "not authorized");
+
+  // Transactions are managed by the runtime, so transaction statements are not allowed
+  requireException(() => sql.exec("BEGIN TRANSACTION"),
+    "not authorized");
+  requireException(() => sql.exec("COMMIT"),
+    "not authorized");
+  requireException(() => sql.exec("ROLLBACK"),
+    "not authorized");
+  requireException(() => sql.exec("SAVEPOINT foo"),
+    "not authorized");
+}
+
+async function testTransaction(storage, env) {
+  // This write holds the output gate until it's committed.
+  storage.put("before", 1);
+
+  await storage.transaction(async txn => {
+    await txn.put("foo", 2);
+
+    // Both of these wait for the output gate, which mustn't in turn be waiting for the
+    // transaction to finish.
+    let response = await env.self.fetch("http://self/");
+    assert.equal(await response.text(), "ok");
+    await storage.sync();
+
+    assert.equal(await txn.get("foo"), 2);
+  });
+
+  assert.equal(await storage.get("before"), 1);
+  assert.equal(await storage.get("foo"), 2);
 }
 
 export class DurableObjectExample {
   constructor(state, env) {
     this.state = state;
+    this.env = env;
   }
 
   async fetch() {
     test(this.state.storage.sql);
+    await testTransaction(this.state.storage, this.env);
     return new Response();
   }
 }
 
 export default {
+  async fetch(req, env, ctx) {
+    return new Response("ok");
+  },
+
   async test(ctrl, env, ctx) {
     let id = env.ns.idFromName("A");
     let obj = env.ns.get(id);
@@ -30,6 +30,12 @@ bool SqlStorage::isAllowedTrigger(kj::StringPtr name) {
   return true;
 }
 
+bool SqlStorage::isAllowedTransactionControl() {
+  // Writes through the storage API are batched into an implicit transaction, which BEGIN or
+  // COMMIT from the application would break. Use `storage.transaction()` instead.
+  return false;
+}
+
 void SqlStorage::onError(kj::StringPtr message) {
   JSG_ASSERT(false, Error, message);
 }
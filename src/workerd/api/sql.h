@@ -42,6 +42,7 @@ private:
 
   bool isAllowedName(kj::StringPtr name) override;
   bool isAllowedTrigger(kj::StringPtr name) override;
+  bool isAllowedTransactionControl() override;
   void onError(kj::StringPtr message) override;
 
   IoPtr<SqliteDatabase> sqlite;
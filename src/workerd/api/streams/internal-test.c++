@@ -0,0 +1,204 @@
+// Copyright (c) 2017-2023 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#include "internal.h"
+#include <kj/test.h>
+
+namespace workerd::api {
+namespace {
+
+class PatternSource final: public ReadableStreamSource {
+  // Produces `size` bytes of a repeating pattern, as fast as it's asked to.
+public:
+  explicit PatternSource(size_t size): size(size) {}
+
+  uint reads = 0;
+
+  kj::Promise<size_t> tryRead(void* buffer, size_t minBytes, size_t maxBytes) override {
+    ++reads;
+    size_t amount = kj::min(maxBytes, size - offset);
+    auto bytes = reinterpret_cast<kj::byte*>(buffer);
+    for (size_t i = 0; i < amount; i++) {
+      bytes[i] = (offset + i) % 251;
+    }
+    offset += amount;
+    return amount;
+  }
+
+private:
+  size_t size;
+  size_t offset = 0;
+};
+
+class CheckingSink final: public WritableStreamSink {
+  // Verifies the pattern written by PatternSource. Each write completes on a later turn of the
+  // event loop, like a real sink would.
+public:
+  size_t received = 0;
+  uint writes = 0;
+  bool ended = false;
+
+  kj::Promise<void> write(const void* buffer, size_t size) override {
+    return write(kj::arr(kj::arrayPtr(reinterpret_cast<const kj::byte*>(buffer), size)));
+  }
+
+  kj::Promise<void> write(kj::ArrayPtr<const kj::ArrayPtr<const byte>> pieces) override {
+    KJ_ASSERT(!ended);
+    ++writes;
+    for (auto piece: pieces) {
+      for (auto b: piece) {
+        KJ_ASSERT(b == received % 251, received);
+        ++received;
+      }
+    }
+    return kj::evalLater([]() {});
+  }
+
+  kj::Promise<void> end() override {
+    ended = true;
+    return kj::READY_NOW;
+  }
+
+  void abort(kj::Exception reason) override {}
+};
+
+KJ_TEST("pumpTo() grows its buffer and batches writes") {
+  kj::EventLoop loop;
+  kj::WaitScope ws(loop);
+
+  constexpr size_t SIZE = 16 << 20;
+  PatternSource source(SIZE);
+  CheckingSink sink;
+  source.pumpTo(sink, true).wait(ws).proxyTask.wait(ws);
+
+  KJ_EXPECT(sink.received == SIZE);
+  KJ_EXPECT(sink.ended);
+
+  // With a fixed 4 KiB buffer this would take 4096 reads and writes.
+  KJ_EXPECT(source.reads < 100, source.reads);
+  KJ_EXPECT(sink.writes <= source.reads, sink.writes);
+}
+
+KJ_TEST("pumpTo() gathers chunks read during a write into one write") {
+  kj::EventLoop loop;
+  kj::WaitScope ws(loop);
+
+  class SlowSink final: public WritableStreamSink {
+  public:
+    kj::Vector<size_t> writes;  // number of pieces in each write
+    kj::Vector<kj::Own<kj::PromiseFulfiller<void>>> blocked;
+
+    kj::Promise<void> write(const void* buffer, size_t size) override {
+      KJ_UNIMPLEMENTED("not used");
+    }
+    kj::Promise<void> write(kj::ArrayPtr<const kj::ArrayPtr<const byte>> pieces) override {
+      writes.add(pieces.size());
+      auto paf = kj::newPromiseAndFulfiller<void>();
+      blocked.add(kj::mv(paf.fulfiller));
+      return kj::mv(paf.promise);
+    }
+    kj::Promise<void> end() override { return kj::READY_NOW; }
+    void abort(kj::Exception reason) override {}
+  };
+
+  class TrickleSource final: public ReadableStreamSource {
+    // Returns one small chunk per read, for a total of 10.
+  public:
+    uint chunks = 0;
+    kj::Promise<size_t> tryRead(void* buffer, size_t minBytes, size_t maxBytes) override {
+      if (chunks == 10) return size_t(0);
+      ++chunks;
+      memset(buffer, 'a', 10);
+      return kj::evalLater([]() { return size_t(10); });
+    }
+  };
+
+  TrickleSource source;
+  SlowSink sink;
+  auto promise = source.pumpTo(sink, true).then([](DeferredProxy<void> proxy) {
+    return kj::mv(proxy.proxyTask);
+  });
+
+  // The first chunk is written right away. While that write is blocked, the rest are read.
+  promise.poll(ws);
+  KJ_ASSERT(sink.writes.size() == 1);
+  KJ_EXPECT(sink.writes[0] == 1);
+  KJ_EXPECT(source.chunks == 10);
+
+  // Once it completes, everything else goes out in one write.
+  sink.blocked[0]->fulfill();
+  promise.poll(ws);
+  KJ_ASSERT(sink.writes.size() == 2);
+  KJ_EXPECT(sink.writes[1] == 9);
+
+  sink.blocked[1]->fulfill();
+  promise.wait(ws);
+}
+
+KJ_TEST("pumpTo() fails a pending read when a write fails") {
+  kj::EventLoop loop;
+  kj::WaitScope ws(loop);
+
+  class FailingSink final: public WritableStreamSink {
+  public:
+    kj::Promise<void> write(const void* buffer, size_t size) override {
+      KJ_UNIMPLEMENTED("not used");
+    }
+    kj::Promise<void> write(kj::ArrayPtr<const kj::ArrayPtr<const byte>> pieces) override {
+      return KJ_EXCEPTION(DISCONNECTED, "sink went away");
+    }
+    kj::Promise<void> end() override { return kj::READY_NOW; }
+    void abort(kj::Exception reason) override {}
+  };
+
+  class HangingSource final: public ReadableStreamSource {
+    // Returns one chunk, and then never returns again.
+  public:
+    bool first = true;
+    kj::Promise<size_t> tryRead(void* buffer, size_t minBytes, size_t maxBytes) override {
+      if (!first) return kj::NEVER_DONE;
+      first = false;
+      memset(buffer, 'a', 10);
+      return size_t(10);
+    }
+  };
+
+  HangingSource source;
+  FailingSink sink;
+  KJ_EXPECT_THROW_MESSAGE("sink went away",
+      source.pumpTo(sink, true).wait(ws).proxyTask.wait(ws));
+}
+
+KJ_TEST("pumpTo() doesn't write again after a write fails") {
+  kj::EventLoop loop;
+  kj::WaitScope ws(loop);
+
+  class LaterFailingSink final: public WritableStreamSink {
+    // Fails each write on a later turn of the event loop, by which time a synchronous source has
+    // already completed another read.
+  public:
+    uint writes = 0;
+
+    kj::Promise<void> write(const void* buffer, size_t size) override {
+      KJ_UNIMPLEMENTED("not used");
+    }
+    kj::Promise<void> write(kj::ArrayPtr<const kj::ArrayPtr<const byte>> pieces) override {
+      ++writes;
+      return kj::evalLater([]() -> kj::Promise<void> {
+        return KJ_EXCEPTION(DISCONNECTED, "sink went away");
+      });
+    }
+    kj::Promise<void> end() override { return kj::READY_NOW; }
+    void abort(kj::Exception reason) override {}
+  };
+
+  PatternSource source(16 * 1024 * 1024);
+  LaterFailingSink sink;
+  KJ_EXPECT_THROW_MESSAGE("sink went away",
+      source.pumpTo(sink, true).wait(ws).proxyTask.wait(ws));
+  KJ_EXPECT(sink.writes == 1, sink.writes);
+}
+
+}  // namespace
+}  // namespace workerd::api
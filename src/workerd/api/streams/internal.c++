@@ -6,6 +6,7 @@
 #include "readable.h"
 #include "writable.h"
 #include "transform.h"
+#include "spill-tee.h"
 #include <workerd/jsg/jsg.h>
 
 namespace workerd::api {
@@ -28,34 +29,91 @@ namespace {
           kj::str(JSG_EXCEPTION(TypeError) ": ", message)));
 }
 
-kj::Promise<void> pumpToHelper(
-    ReadableStreamSource& input, WritableStreamSink& output, bool end,
-    kj::Array<kj::byte> bytes) {
-  auto promise = input.tryRead(bytes.begin(), 1, bytes.size());
+constexpr size_t MIN_PUMP_BUFFER_SIZE = 4096;
+constexpr size_t MAX_PUMP_BUFFER_SIZE = 1024 * 1024;
+// pumpTo() starts out with small buffers, since most bodies are small, and doubles the buffer
+// size each time a read fills its buffer completely, since that means the source had more
+// available than we asked for.
 
-  return promise.then(
-      [&input, &output, end, bytes = kj::mv(bytes)]
-      (size_t amount) mutable
-      -> kj::Promise<void> {
-    if (amount == 0) {
-      if (end) {
-        return output.end();
-      } else {
-        return kj::READY_NOW;
-      }
+kj::Promise<void> pumpTo(ReadableStreamSource& input, WritableStreamSink& output, bool end) {
+  // Reading continues while a write is in progress, and whatever was read in the meantime is then
+  // written with a single vectored write(). So, a fast source costs one write per round trip to
+  // the sink, rather than one write per chunk.
+
+  size_t bufferSize = MIN_PUMP_BUFFER_SIZE;
+
+  kj::Vector<kj::Array<kj::byte>> pending;
+  size_t pendingCapacity = 0;
+  // Chunks read but not yet written, and the total size of the buffers holding them.
+
+  bool writeDone = true;
+  kj::Maybe<kj::Exception> writeError;
+  auto writeFailed = kj::newPromiseAndFulfiller<void>();
+  auto writeFailedForked = writeFailed.promise.fork();
+  kj::Promise<void> writing = kj::READY_NOW;
+  // Declared after the state it updates, so that canceling the pump cancels the write first.
+
+  auto startWrite = [&]() {
+    auto chunks = pending.releaseAsArray();
+    auto pieces = KJ_MAP(chunk, chunks) -> kj::ArrayPtr<const kj::byte> { return chunk; };
+    pendingCapacity = 0;
+    writeDone = false;
+    writing = output.write(pieces).attach(kj::mv(pieces), kj::mv(chunks))
+        .then([&writeDone]() {
+      writeDone = true;
+    }, [&writeDone, &writeError, &writeFailed](kj::Exception&& exception) {
+      // Also fail any read in progress, rather than waiting for it to complete.
+      writeFailed.fulfiller->reject(kj::cp(exception));
+      writeError = kj::mv(exception);
+      writeDone = true;
+    }).eagerlyEvaluate(nullptr);
+  };
+
+  auto waitForWrite = [&]() -> kj::Promise<void> {
+    co_await kj::mv(writing);
+    writing = kj::READY_NOW;
+    KJ_IF_MAYBE(exception, writeError) {
+      kj::throwFatalException(kj::cp(*exception));
     }
+  };
 
-    auto promise = output.write(bytes.begin(), amount);
+  for (;;) {
+    auto buffer = kj::heapArray<kj::byte>(bufferSize);
+    size_t amount = co_await input.tryRead(buffer.begin(), 1, buffer.size())
+        .exclusiveJoin(writeFailedForked.addBranch().then([]() -> size_t { KJ_UNREACHABLE; }));
 
-    return promise.then(
-        [&input, &output, end, bytes = kj::mv(bytes)]() mutable {
-      return pumpToHelper(input, output, end, kj::mv(bytes));
-    });
-  });
-}
+    KJ_IF_MAYBE(exception, writeError) {
+      // The write failed, but the read completed first anyway. Don't write to the failed sink
+      // again.
+      kj::throwFatalException(kj::cp(*exception));
+    }
 
-kj::Promise<void> pumpTo(ReadableStreamSource& input, WritableStreamSink& output, bool end) {
-  return pumpToHelper(input, output, end, kj::heapArray<kj::byte>(4096));
+    if (amount == 0) break;
+
+    if (amount == buffer.size() && bufferSize < MAX_PUMP_BUFFER_SIZE) {
+      bufferSize *= 2;
+    }
+    pendingCapacity += buffer.size();
+    pending.add(buffer.slice(0, amount).attach(kj::mv(buffer)));
+
+    if (!writeDone && pendingCapacity >= MAX_PUMP_BUFFER_SIZE) {
+      // The sink is falling behind. Stop reading until it catches up.
+      co_await waitForWrite();
+    }
+    if (writeDone) {
+      startWrite();
+    }
+  }
+
+  co_await waitForWrite();
+  if (pending.size() > 0) {
+    startWrite();
+    co_await waitForWrite();
+  }
+
+  if (end) {
+    co_await output.end();
+  }
 }
 
 class AllReader {
@@ -597,7 +655,7 @@ ReadableStreamController::Tee ReadableStreamInternalController::tee(jsg::Lock& j
         return makeTee(kj::mv(tee->branches[0]), kj::mv(tee->branches[1]));
       }
 
-      auto tee = kj::newTee(kj::heap<TeeAdapter>(kj::mv(readable)), bufferLimit);
+      auto tee = newTee(ioContext, kj::heap<TeeAdapter>(kj::mv(readable)), bufferLimit);
 
       return makeTee(
           kj::heap<TeeBranch>(newTeeErrorAdapter(kj::mv(tee.branches[0]))),
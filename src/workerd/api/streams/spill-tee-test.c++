@@ -0,0 +1,150 @@
+// Copyright (c) 2017-2023 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#include "spill-tee.h"
+#include <kj/test.h>
+
+namespace workerd::api {
+namespace {
+
+class PatternStream final: public kj::AsyncInputStream {
+  // Produces `size` bytes of a repeating pattern, in reads of at most `chunkSize` bytes, then
+  // optionally fails instead of reporting EOF.
+public:
+  PatternStream(size_t size, size_t chunkSize, bool fail = false)
+      : size(size), chunkSize(chunkSize), fail(fail) {}
+
+  kj::Promise<size_t> tryRead(void* buffer, size_t minBytes, size_t maxBytes) override {
+    size_t amount = kj::min(kj::min(maxBytes, chunkSize), size - offset);
+    if (amount == 0 && fail) {
+      return KJ_EXCEPTION(DISCONNECTED, "source failed");
+    }
+    auto bytes = reinterpret_cast<kj::byte*>(buffer);
+    for (size_t i = 0; i < amount; i++) {
+      bytes[i] = (offset + i) % 251;
+    }
+    offset += amount;
+    return kj::evalLater([amount]() { return amount; });
+  }
+
+  kj::Maybe<uint64_t> tryGetLength() override { return size - offset; }
+
+private:
+  size_t size;
+  size_t chunkSize;
+  bool fail;
+  size_t offset = 0;
+};
+
+void expectPattern(kj::ArrayPtr<const kj::byte> bytes, size_t offset = 0) {
+  for (size_t i = 0; i < bytes.size(); i++) {
+    KJ_ASSERT(bytes[i] == (offset + i) % 251, offset + i);
+  }
+}
+
+KJ_TEST("spilling tee lets one branch run arbitrarily far ahead") {
+  kj::EventLoop loop;
+  kj::WaitScope ws(loop);
+  auto dir = kj::newInMemoryDirectory(kj::nullClock());
+
+  constexpr size_t SIZE = 4 << 20;
+  auto tee = newSpillingTee(kj::heap<PatternStream>(SIZE, 10000), kj::maxValue, 65536, *dir);
+
+  KJ_EXPECT(KJ_ASSERT_NONNULL(tee.branches[0]->tryGetLength()) == SIZE);
+
+  // kj::newTee() would fail the lagging branch here, having buffered far more than the limit.
+  auto first = tee.branches[0]->readAllBytes().wait(ws);
+  KJ_EXPECT(first.size() == SIZE);
+  expectPattern(first);
+
+  KJ_EXPECT(KJ_ASSERT_NONNULL(tee.branches[1]->tryGetLength()) == SIZE);
+  auto second = tee.branches[1]->readAllBytes().wait(ws);
+  KJ_EXPECT(second.size() == SIZE);
+  expectPattern(second);
+}
+
+KJ_TEST("spilling tee with interleaved reads") {
+  kj::EventLoop loop;
+  kj::WaitScope ws(loop);
+  auto dir = kj::newInMemoryDirectory(kj::nullClock());
+
+  constexpr size_t SIZE = 1 << 20;
+  auto tee = newSpillingTee(kj::heap<PatternStream>(SIZE, 3000), kj::maxValue, 16384, *dir);
+
+  // Branch 0 reads big chunks, branch 1 small ones, so branch 1 falls further and further behind,
+  // spills, and catches up again at the end.
+  auto buffer = kj::heapArray<kj::byte>(50000);
+  size_t offsets[2] = {0, 0};
+  for (uint i = 0;; i++) {
+    uint b = i % 2;
+    size_t maxBytes = b == 0 ? 50000 : 7000;
+    size_t n = tee.branches[b]->tryRead(buffer.begin(), 1, maxBytes).wait(ws);
+    if (n == 0) {
+      KJ_ASSERT(offsets[b] == SIZE);
+      if (offsets[0] == SIZE && offsets[1] == SIZE) break;
+      continue;
+    }
+    expectPattern(buffer.slice(0, n), offsets[b]);
+    offsets[b] += n;
+  }
+}
+
+KJ_TEST("spilling tee propagates errors to both branches") {
+  kj::EventLoop loop;
+  kj::WaitScope ws(loop);
+  auto dir = kj::newInMemoryDirectory(kj::nullClock());
+
+  auto tee = newSpillingTee(kj::heap<PatternStream>(100000, 10000, true), kj::maxValue, 4096,
+                            *dir);
+  KJ_EXPECT_THROW_MESSAGE("source failed", tee.branches[0]->readAllBytes().wait(ws));
+
+  // The other branch still gets all the data before the error.
+  auto buffer = kj::heapArray<kj::byte>(100000);
+  KJ_EXPECT(tee.branches[1]->tryRead(buffer.begin(), 100000, 100000).wait(ws) == 100000);
+  expectPattern(buffer);
+  KJ_EXPECT_THROW_MESSAGE("source failed",
+      tee.branches[1]->tryRead(buffer.begin(), 1, 1).wait(ws));
+}
+
+KJ_TEST("spilling tee stops retaining data once a branch is dropped") {
+  kj::EventLoop loop;
+  kj::WaitScope ws(loop);
+  auto dir = kj::newInMemoryDirectory(kj::nullClock());
+
+  constexpr size_t SIZE = 1 << 20;
+  auto tee = newSpillingTee(kj::heap<PatternStream>(SIZE, 10000), kj::maxValue, 4096, *dir);
+
+  auto buffer = kj::heapArray<kj::byte>(5000);
+  KJ_EXPECT(tee.branches[1]->tryRead(buffer.begin(), 5000, 5000).wait(ws) == 5000);
+  expectPattern(buffer);
+  tee.branches[1] = nullptr;
+
+  auto rest = tee.branches[0]->readAllBytes().wait(ws);
+  KJ_EXPECT(rest.size() == SIZE);
+  expectPattern(rest);
+}
+
+KJ_TEST("spilling tee fails a branch that falls more than the limit behind") {
+  kj::EventLoop loop;
+  kj::WaitScope ws(loop);
+  auto dir = kj::newInMemoryDirectory(kj::nullClock());
+
+  constexpr size_t SIZE = 1 << 20;
+  auto tee = newSpillingTee(kj::heap<PatternStream>(SIZE, 10000), 262144, 16384, *dir);
+
+  auto buffer = kj::heapArray<kj::byte>(5000);
+  KJ_EXPECT(tee.branches[1]->tryRead(buffer.begin(), 5000, 5000).wait(ws) == 5000);
+  expectPattern(buffer);
+
+  // The leading branch isn't affected.
+  auto first = tee.branches[0]->readAllBytes().wait(ws);
+  KJ_EXPECT(first.size() == SIZE);
+  expectPattern(first);
+
+  KJ_EXPECT_THROW_MESSAGE("tee buffer size limit exceeded",
+      tee.branches[1]->tryRead(buffer.begin(), 1, 5000).wait(ws));
+}
+
+}  // namespace
+}  // namespace workerd::api
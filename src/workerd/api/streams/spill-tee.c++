@@ -0,0 +1,345 @@
+// Copyright (c) 2017-2023 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#include "spill-tee.h"
+#include <workerd/io/io-context.h>
+#include <kj/mutex.h>
+#include <kj/thread.h>
+#include <deque>
+
+namespace workerd::api {
+
+namespace {
+
+constexpr size_t MIN_PULL_SIZE = 8192;
+constexpr size_t MAX_PULL_SIZE = 65536;
+
+kj::Own<const kj::Executor> startSpillThread() {
+  static kj::MutexGuarded<kj::Maybe<kj::Own<const kj::Executor>>> started;
+
+  kj::Thread([]() {
+    kj::EventLoop loop;
+    kj::WaitScope waitScope(loop);
+    *started.lockExclusive() = kj::getCurrentThreadExecutor().addRef();
+    kj::NEVER_DONE.wait(waitScope);
+  }).detach();
+
+  auto lock = started.when([](const kj::Maybe<kj::Own<const kj::Executor>>& executor) {
+    return executor != nullptr;
+  });
+  return kj::mv(KJ_ASSERT_NONNULL(*lock));
+}
+
+const kj::Executor& getSpillExecutor() {
+  // File I/O blocks, so spill files are only ever read and written on a thread of their own,
+  // started on first use and left running until the process exits.
+  static const kj::Own<const kj::Executor> executor = startSpillThread();
+  return *executor;
+}
+
+class SpillingTee final: public kj::Refcounted {
+  // State shared by the two branches of a tee created by newSpillingTee().
+  //
+  // Data pulled from `inner` is retained until both branches have read it. It's kept in memory
+  // until `memoryLimit` bytes are retained; beyond that, newly pulled data is appended to the
+  // spill file instead, until the lagging branch has caught up completely, at which point the
+  // file is emptied. A branch that falls more than `limit` bytes behind fails, as with
+  // kj::newTee().
+  //
+  // The spill file is only accessed through getSpillExecutor(), so that disk I/O never blocks
+  // the event loop.
+
+public:
+  SpillingTee(kj::Own<kj::AsyncInputStream> inner, uint64_t limit, uint64_t memoryLimit,
+              const kj::Directory& spillDirectory)
+      : inner(kj::mv(inner)), limit(limit), memoryLimit(memoryLimit),
+        spillDirectory(spillDirectory) {}
+
+  kj::Promise<size_t> read(uint branch, kj::ArrayPtr<kj::byte> buffer, size_t minBytes) {
+    size_t total = 0;
+    for (;;) {
+      KJ_IF_MAYBE(exception, branchError[branch]) {
+        kj::throwFatalException(kj::cp(*exception));
+      }
+
+      total += copyOut(branch, buffer.slice(total, buffer.size()));
+      if (total < minBytes && position[branch] < end) {
+        // The branch has caught up with data that is only in the spill file.
+        total += co_await readSpillFile(branch, buffer.slice(total, buffer.size()));
+        continue;
+      }
+      release();
+
+      if (total >= minBytes) co_return total;
+      KJ_IF_MAYBE(exception, error) {
+        kj::throwFatalException(kj::cp(*exception));
+      }
+      if (eof) co_return total;
+
+      if (!pullInProgress) {
+        pullInProgress = true;
+        pulling = pull(buffer.size() - total).fork();
+      }
+      co_await KJ_ASSERT_NONNULL(pulling).addBranch();
+    }
+  }
+
+  kj::Maybe<uint64_t> tryGetLength(uint branch) {
+    return inner->tryGetLength().map([&](uint64_t remaining) {
+      return remaining + (end - position[branch]);
+    });
+  }
+
+  void detach(uint branch) {
+    detached[branch] = true;
+    release();
+  }
+
+private:
+  kj::Own<kj::AsyncInputStream> inner;
+  uint64_t limit;
+  uint64_t memoryLimit;
+  const kj::Directory& spillDirectory;
+
+  uint64_t position[2] = {0, 0};
+  bool detached[2] = {false, false};
+  kj::Maybe<kj::Exception> branchError[2];
+  // Stream offset of the next byte each branch will read, whether each branch is gone (or has
+  // failed, and so doesn't need any more data), and why it failed.
+
+  std::deque<kj::Array<kj::byte>> memory;
+  uint64_t memoryStart = 0;    // offset of the first byte of memory.front()
+  uint64_t memoryEnd = 0;      // offset just past the last byte of memory.back()
+  uint64_t end = 0;            // offset just past the last byte pulled from `inner`
+  // Retained data. When spilling, [memoryEnd, end) lives in `spillFile`; otherwise
+  // memoryEnd == end.
+
+  kj::Maybe<kj::Own<const kj::File>> spillFile;
+  uint64_t spillStart = 0;     // stream offset of the byte at file offset zero
+  bool spillFileInUse = false;
+  bool spillWriteInProgress = false;
+  // Created on first use, and reused each time spilling resumes. While a write is in progress, the
+  // written data isn't counted in `end` yet, so the file must not be emptied even if every branch
+  // has read up to `end`.
+
+  kj::Array<kj::byte> lastPull;
+  // The most recently pulled data, ending at `end`, if it isn't in `memory`. While spilling, this
+  // lets the leading branch -- which is usually the one that asked for it -- read it without
+  // going through the file.
+
+  bool eof = false;
+  kj::Maybe<kj::Exception> error;
+
+  bool pullInProgress = false;
+  kj::Maybe<kj::ForkedPromise<void>> pulling;
+
+  bool isSpilling() { return memoryEnd < end; }
+
+  kj::Promise<void> pull(size_t size) {
+    auto buffer = kj::heapArray<kj::byte>(kj::min(kj::max(size, MIN_PULL_SIZE), MAX_PULL_SIZE));
+    try {
+      size_t amount = co_await inner->tryRead(buffer.begin(), 1, buffer.size());
+
+      if (amount == 0) {
+        eof = true;
+      } else if (amount < buffer.size()) {
+        co_await append(kj::heapArray(buffer.slice(0, amount)));
+      } else {
+        co_await append(kj::mv(buffer));
+      }
+    } catch (...) {
+      error = kj::getCaughtExceptionAsKj();
+    }
+    pullInProgress = false;
+  }
+
+  kj::Promise<void> append(kj::Array<kj::byte> bytes) {
+    enforceLimit(bytes.size());
+
+    if (detached[0] || detached[1]) {
+      // Only one branch is left, so nothing needs to be retained past its next read.
+    } else if (!isSpilling() && memoryEnd - memoryStart + bytes.size() <= memoryLimit) {
+      memoryEnd += bytes.size();
+      end += bytes.size();
+      memory.push_back(kj::mv(bytes));
+      lastPull = nullptr;
+      co_return;
+    } else {
+      if (!isSpilling()) spillStart = end;
+      bytes = co_await writeSpillFile(kj::mv(bytes));
+    }
+
+    end += bytes.size();
+    lastPull = kj::mv(bytes);
+  }
+
+  void enforceLimit(size_t size) {
+    // Fails any branch that would fall more than `limit` bytes behind once `size` more bytes are
+    // pulled. The branch that asked for them has already read everything, so never fails.
+
+    for (uint branch = 0; branch < 2; branch++) {
+      if (!detached[branch] && position[branch] < end && end + size - position[branch] > limit) {
+        branchError[branch] = KJ_EXCEPTION(FAILED, "tee buffer size limit exceeded");
+        detached[branch] = true;
+      }
+    }
+    release();
+  }
+
+  kj::Promise<kj::Array<kj::byte>> writeSpillFile(kj::Array<kj::byte> bytes) {
+    spillWriteInProgress = true;
+    KJ_DEFER(spillWriteInProgress = false);
+
+    if (spillFile == nullptr) {
+      spillFile = co_await getSpillExecutor().executeAsync([&dir = spillDirectory]() {
+        return dir.createTemporary();
+      });
+    }
+
+    auto& file = *KJ_ASSERT_NONNULL(spillFile);
+    bytes = co_await getSpillExecutor().executeAsync(
+        [&file, offset = end - spillStart, bytes = kj::mv(bytes)]() mutable {
+      file.write(offset, bytes);
+      return kj::mv(bytes);
+    });
+    spillFileInUse = true;
+    co_return kj::mv(bytes);
+  }
+
+  kj::Promise<size_t> readSpillFile(uint branch, kj::ArrayPtr<kj::byte> out) {
+    // Reads into `out` as much as possible of the spilled data starting at `branch`'s position.
+    // The data stays in the file until this branch has read it, so it can't be emptied meanwhile.
+
+    uint64_t pos = position[branch];
+    size_t n = kj::min(end - lastPull.size() - pos, out.size());
+    auto& file = *KJ_ASSERT_NONNULL(spillFile);
+    auto bytes = co_await getSpillExecutor().executeAsync(
+        [&file, offset = pos - spillStart, n]() {
+      auto result = kj::heapArray<kj::byte>(n);
+      KJ_ASSERT(file.read(offset, result) == n, "spill file truncated");
+      return result;
+    });
+
+    memcpy(out.begin(), bytes.begin(), n);
+    position[branch] += n;
+    co_return n;
+  }
+
+  size_t copyOut(uint branch, kj::ArrayPtr<kj::byte> out) {
+    // Copies what `branch` can read without going to the spill file.
+
+    uint64_t& pos = position[branch];
+    size_t copied = 0;
+
+    while (copied < out.size() && pos < end) {
+      auto dst = out.slice(copied, out.size());
+      size_t n;
+
+      if (pos < memoryEnd) {
+        uint64_t chunkStart = memoryStart;
+        auto chunk = memory.begin();
+        while (pos >= chunkStart + chunk->size()) {
+          chunkStart += chunk->size();
+          ++chunk;
+        }
+        auto src = chunk->slice(pos - chunkStart, chunk->size());
+        n = kj::min(src.size(), dst.size());
+        memcpy(dst.begin(), src.begin(), n);
+      } else if (pos >= end - lastPull.size()) {
+        auto src = lastPull.slice(pos - (end - lastPull.size()), lastPull.size());
+        n = kj::min(src.size(), dst.size());
+        memcpy(dst.begin(), src.begin(), n);
+      } else {
+        break;
+      }
+
+      copied += n;
+      pos += n;
+    }
+
+    return copied;
+  }
+
+  void release() {
+    // Drop data that no live branch still needs to read.
+
+    uint64_t needed;
+    if (detached[0] && detached[1]) {
+      needed = end;
+    } else if (detached[0]) {
+      needed = position[1];
+    } else if (detached[1]) {
+      needed = position[0];
+    } else {
+      needed = kj::min(position[0], position[1]);
+    }
+
+    while (!memory.empty() && memoryStart + memory.front().size() <= needed) {
+      memoryStart += memory.front().size();
+      memory.pop_front();
+    }
+
+    if (needed == end) {
+      // Everything has been read, so start over with an empty buffer.
+      memory.clear();
+      memoryStart = end;
+      memoryEnd = end;
+      if (spillFileInUse && !spillWriteInProgress) {
+        // Nothing still needs the file's contents, and anything already queued for it runs first.
+        // The truncation holds its own reference, in case the tee is gone by then.
+        auto file = KJ_ASSERT_NONNULL(spillFile)->clone();
+        getSpillExecutor().executeAsync([file = kj::mv(file)]() {
+          file->truncate(0);
+        }).detach([](kj::Exception&& exception) {
+          KJ_LOG(ERROR, "failed to empty tee spill file", exception);
+        });
+        spillFileInUse = false;
+      }
+    }
+  }
+};
+
+class SpillingTeeBranch final: public kj::AsyncInputStream {
+public:
+  SpillingTeeBranch(kj::Own<SpillingTee> tee, uint index): tee(kj::mv(tee)), index(index) {}
+  ~SpillingTeeBranch() noexcept(false) {
+    tee->detach(index);
+  }
+
+  kj::Promise<size_t> tryRead(void* buffer, size_t minBytes, size_t maxBytes) override {
+    return tee->read(index, kj::arrayPtr(reinterpret_cast<kj::byte*>(buffer), maxBytes), minBytes)
+        .attach(kj::addRef(*tee));
+  }
+
+  kj::Maybe<uint64_t> tryGetLength() override {
+    return tee->tryGetLength(index);
+  }
+
+private:
+  kj::Own<SpillingTee> tee;
+  uint index;
+};
+
+}  // namespace
+
+kj::Tee newSpillingTee(kj::Own<kj::AsyncInputStream> input, uint64_t limit,
+                       uint64_t memoryLimit, const kj::Directory& spillDirectory) {
+  auto tee = kj::refcounted<SpillingTee>(kj::mv(input), limit, memoryLimit, spillDirectory);
+  return { {
+    kj::heap<SpillingTeeBranch>(kj::addRef(*tee), 0),
+    kj::heap<SpillingTeeBranch>(kj::mv(tee), 1),
+  } };
+}
+
+kj::Tee newTee(IoContext& context, kj::Own<kj::AsyncInputStream> input, uint64_t limit) {
+  auto& limitEnforcer = context.getLimitEnforcer();
+  KJ_IF_MAYBE(dir, limitEnforcer.getSpillDirectory()) {
+    return newSpillingTee(kj::mv(input), limit,
+        kj::min(limit, limitEnforcer.getSpillThreshold()), *dir);
+  } else {
+    return kj::newTee(kj::mv(input), limit);
+  }
+}
+
+}  // namespace workerd::api
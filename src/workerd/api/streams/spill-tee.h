@@ -0,0 +1,31 @@
+// Copyright (c) 2017-2023 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#pragma once
+
+#include <kj/async-io.h>
+#include <kj/filesystem.h>
+
+namespace workerd {
+  class IoContext;
+}
+
+namespace workerd::api {
+
+kj::Tee newSpillingTee(kj::Own<kj::AsyncInputStream> input, uint64_t limit,
+                       uint64_t memoryLimit, const kj::Directory& spillDirectory);
+// Like kj::newTee(), but once one branch has fallen more than `memoryLimit` bytes behind the
+// other, the excess is written to an anonymous temporary file created in `spillDirectory`, from
+// which the lagging branch then reads it back. The lagging branch still fails once it falls more
+// than `limit` bytes behind, so memory use is bounded by `memoryLimit` and disk use by `limit`.
+//
+// The file is read and written on a separate thread, so the event loop never waits for the disk.
+// `spillDirectory` must outlive the branches.
+
+kj::Tee newTee(IoContext& context, kj::Own<kj::AsyncInputStream> input, uint64_t limit);
+// Tees `input` as appropriate for `context`: with newSpillingTee() if the context's
+// LimitEnforcer provides a spill directory, otherwise with kj::newTee(), which fails the lagging
+// branch once it falls more than `limit` bytes behind.
+
+}  // namespace workerd::api
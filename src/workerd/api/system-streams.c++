@@ -4,6 +4,7 @@
 
 #include "system-streams.h"
 #include "util.h"
+#include "streams/spill-tee.h"
 #include <kj/one-of.h>
 #include <kj/compat/gzip.h>
 
@@ -93,7 +94,7 @@ kj::Maybe<ReadableStreamSource::Tee> EncodedAsyncInputStream::tryTee(uint64_t li
   // Additionally, we should propagate the fact that this stream is a native stream to the branches
   // of the tee, so that branches which fall behind their siblings (and thus are reading from the
   // tee buffer) still register pending events correctly.
-  auto tee = kj::newTee(kj::mv(inner), limit);
+  auto tee = newTee(ioContext, kj::mv(inner), limit);
 
   Tee result;
   result.branches[0] = newSystemStream(newTeeErrorAdapter(kj::mv(tee.branches[0])), encoding);
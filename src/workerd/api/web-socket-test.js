@@ -0,0 +1,98 @@
+function assertEqual(a, b) {
+  if (a !== b) {
+    throw new Error(a + " !== " + b);
+  }
+}
+
+// Runs in a Durable Object so the test can use the input gate: messages that arrive together are
+// delivered in one run(), but that must never let one in while the gate is blocked.
+export class WebSocketBatching {
+  constructor(state) {
+    this.state = state;
+  }
+
+  async fetch() {
+    let [client, server] = Object.values(new WebSocketPair());
+    client.accept();
+    server.accept();
+
+    let blocked = false;
+    let delivered = 0;
+    let deliveredWhileBlocked = 0;
+    server.addEventListener("message", async event => {
+      ++delivered;
+      if (blocked) {
+        ++deliveredWhileBlocked;
+      } else if (event.data === "0") {
+        blocked = true;
+        this.state.blockConcurrencyWhile(async () => {
+          await new Promise(resolve => setTimeout(resolve, 10));
+          blocked = false;
+        });
+      }
+
+      // A read-modify-write loses updates if another message is delivered while the read is in
+      // flight.
+      let count = (await this.state.storage.get("count")) ?? 0;
+      this.state.storage.put("count", count + 1);
+    });
+    let closed = new Promise(resolve => server.addEventListener("close", resolve));
+
+    // Hold the gate while the messages arrive, so they queue up and are delivered together once it
+    // opens.
+    this.state.blockConcurrencyWhile(() => new Promise(resolve => setTimeout(resolve, 10)));
+    const COUNT = 10;
+    for (let i = 0; i < COUNT; i++) {
+      client.send(`${i}`);
+    }
+    client.close(1000, "bye");
+
+    await closed;
+    assertEqual(delivered, COUNT);
+    assertEqual(deliveredWhileBlocked, 0);
+    assertEqual(await this.state.storage.get("count"), COUNT);
+    return new Response("ok");
+  }
+}
+
+export default {
+  async test(ctrl, env, ctx) {
+    let [client, server] = Object.values(new WebSocketPair());
+    client.accept();
+    server.accept();
+
+    let received = [];
+    server.addEventListener("message", event => {
+      let data = typeof event.data === "string" ? event.data
+                                                : new Uint8Array(event.data).join(",");
+      received.push(data);
+      // Messages that are delivered together must still each get their own microtask checkpoint.
+      Promise.resolve().then(() => received.push("after " + data));
+    });
+    let closed = new Promise(resolve => server.addEventListener("close", resolve));
+
+    // Enough messages to span several batches.
+    const COUNT = 500;
+    for (let i = 0; i < COUNT; i++) {
+      client.send(`${i}`);
+    }
+    client.send(new Uint8Array([1, 2, 3]));
+    client.close(1000, "bye");
+
+    let event = await closed;
+    assertEqual(event.code, 1000);
+    assertEqual(event.reason, "bye");
+
+    assertEqual(received.length, 2 * COUNT + 2);
+    for (let i = 0; i < COUNT; i++) {
+      assertEqual(received[2 * i], `${i}`);
+      assertEqual(received[2 * i + 1], `after ${i}`);
+    }
+    assertEqual(received[2 * COUNT], "1,2,3");
+    assertEqual(received[2 * COUNT + 1], "after 1,2,3");
+
+    let stub = env.batching.get(env.batching.idFromName("test"));
+    let response = await stub.fetch("http://batching/");
+    assertEqual(await response.text(), "ok");
+  }
+}
@@ -452,7 +452,7 @@ void WebSocket::send(jsg::Lock& js, kj::OneOf<kj::Array<byte>, kj::String> messa
   JSG_REQUIRE(native.state.is<Accepted>(), TypeError,
       "You must call accept() on this WebSocket before sending messages.");
 
-  auto maybeOutputLock = IoContext::current().waitForOutputLocksIfNecessary();
+  auto maybeOutputLock = waitForOutputLocks(IoContext::current());
   auto msg = [&]() -> kj::WebSocket::Message {
     KJ_SWITCH_ONEOF(message) {
       KJ_CASE_ONEOF(text, kj::String) {
@@ -508,7 +508,7 @@ void WebSocket::close(
   }
 
   outgoingMessages->insert(GatedMessage{
-      IoContext::current().waitForOutputLocksIfNecessary(),
+      waitForOutputLocks(IoContext::current()),
       kj::WebSocket::Close {
         // Code 1005 actually translates to sending a close message with no body on the wire.
         static_cast<uint16_t>(code.orDefault(1005)),
@@ -612,6 +612,25 @@ void WebSocket::ensurePumping(jsg::Lock& js) {
   }
 }
 
+kj::Maybe<kj::Promise<void>> WebSocket::waitForOutputLocks(IoContext& context) {
+  KJ_IF_MAYBE(actor, context.getActor()) {
+    auto& gate = actor->getOutputGate();
+    auto& native = *farNative;
+    auto lockCount = gate.getLockCount();
+    KJ_IF_MAYBE(previous, native.outputLockCount) {
+      if (*previous == lockCount) {
+        // No output locks were taken since the previous message was queued, so its wait covers
+        // ours: pump() sends in order and can't reach our message before it's done waiting. This
+        // saves an extra promise and event loop turn for each message in a burst.
+        return nullptr;
+      }
+    }
+    native.outputLockCount = lockCount;
+    return gate.wait();
+  }
+  return nullptr;
+}
+
 namespace {
 size_t countBytesFromMessage(const kj::WebSocket::Message& message) {
   // This does not count the extra data of the RPC frame or the savings from any compression.
@@ -635,8 +654,109 @@ size_t countBytesFromMessage(const kj::WebSocket::Message& message) {
 
   KJ_UNREACHABLE;
 }
+
+class IncomingMessageQueue {
+  // Receives messages from a kj::WebSocket in the background while earlier ones are being
+  // delivered to JavaScript, so that everything which arrived in the meantime can be delivered
+  // under a single isolate lock. Receiving pauses once the queue reaches the batch budget, and
+  // stops for good after a Close message or an error.
+
+public:
+  IncomingMessageQueue(kj::WebSocket& ws, IoContext& context): ws(ws), context(context) {}
+
+  kj::Promise<kj::Vector<kj::WebSocket::Message>> next();
+  // Waits until at least one message is queued, then takes everything queued, in order. If
+  // receiving failed, throws the error once all messages received before it have been taken.
+
+private:
+  static constexpr size_t MAX_BATCH_MESSAGES = 64;
+  static constexpr size_t MAX_BATCH_BYTES = 256 * 1024;
+
+  kj::WebSocket& ws;
+  IoContext& context;
+
+  kj::Vector<kj::WebSocket::Message> queue;
+  size_t queuedBytes = 0;
+
+  bool receiving = false;
+  bool receivedClose = false;
+  kj::Maybe<kj::Exception> error;
+  kj::Promise<void> receiveTask = nullptr;
+
+  kj::Maybe<kj::Own<kj::PromiseFulfiller<void>>> waiter;
+  // Fulfilled when a message or error is queued while next() is waiting.
+
+  void startReceiving();
+  kj::Promise<void> receiveLoop();
+  void wake();
+};
+
+kj::Promise<kj::Vector<kj::WebSocket::Message>> IncomingMessageQueue::next() {
+  if (queue.empty() && error == nullptr) {
+    KJ_ASSERT(!receivedClose, "next() called after the Close message was taken");
+    auto paf = kj::newPromiseAndFulfiller<void>();
+    waiter = kj::mv(paf.fulfiller);
+    startReceiving();
+    co_await paf.promise;
+  }
+
+  if (queue.empty()) {
+    kj::throwFatalException(kj::cp(KJ_ASSERT_NONNULL(error)));
+  }
+
+  auto batch = kj::mv(queue);
+  queuedBytes = 0;
+
+  // If we paused because the queue was full, get going on the next batch while this one is
+  // delivered.
+  startReceiving();
+
+  co_return kj::mv(batch);
 }
 
+void IncomingMessageQueue::startReceiving() {
+  if (receiving || receivedClose || error != nullptr) return;
+
+  receiving = true;
+  receiveTask = receiveLoop().catch_([this](kj::Exception&& e) {
+    receiving = false;
+    error = kj::mv(e);
+    wake();
+  }).eagerlyEvaluate(nullptr);
+}
+
+kj::Promise<void> IncomingMessageQueue::receiveLoop() {
+  while (queue.size() < MAX_BATCH_MESSAGES && queuedBytes < MAX_BATCH_BYTES) {
+    auto message = co_await ws.receive();
+
+    auto size = countBytesFromMessage(message);
+    KJ_IF_MAYBE(a, context.getActor()) {
+      a->getMetrics().receivedWebSocketMessage(size);
+    }
+
+    bool isClose = message.is<kj::WebSocket::Close>();
+    queue.add(kj::mv(message));
+    queuedBytes += size;
+    wake();
+
+    if (isClose) {
+      receivedClose = true;
+      break;
+    }
+  }
+
+  receiving = false;
+}
+
+void IncomingMessageQueue::wake() {
+  KJ_IF_MAYBE(w, waiter) {
+    w->get()->fulfill();
+    waiter = nullptr;
+  }
+}
+
+}  // namespace
+
 kj::Promise<void> WebSocket::pump(
     IoContext& context, OutgoingMessagesMap& outgoingMessages, kj::WebSocket& ws, Native& native) {
   KJ_ASSERT(!native.isPumping);
@@ -682,49 +802,76 @@ kj::Promise<void> WebSocket::pump(
 }
 
 kj::Promise<void> WebSocket::readLoop(kj::WebSocket& ws) {
-  return ws.receive()
-      .then([this, &ws, &context = IoContext::current()](kj::WebSocket::Message&& message) {
-    // We can't top up the CPU and subrequest limits while the context is active, so we have to do
-    // it before run().
-    context.getLimitEnforcer().topUpActor();
+  auto& context = IoContext::current();
+  IncomingMessageQueue incoming(ws, context);
 
-    KJ_IF_MAYBE(a, context.getActor()) {
-      auto size = countBytesFromMessage(message);
-      a->getMetrics().receivedWebSocketMessage(size);
+  kj::Vector<kj::WebSocket::Message> batch;
+  size_t delivered = 0;
+
+  for (;;) {
+    if (delivered == batch.size()) {
+      batch = co_await incoming.next();
+      delivered = 0;
     }
 
+    // We can't top up the CPU and subrequest limits while the context is active, so we have to do
+    // it before run() for the first message. Later messages in the batch are topped up between
+    // dispatches, so each gets the limits it would have had if delivered on its own.
+    context.getLimitEnforcer().topUpActor();
+
     // Re-enter the context with context.run(). This is arguably a bit unusual compared to other
     // I/O which is delivered by return from context.awaitIo(), but the difference here is that we
-    // have a long stream of events over time. It makes sense to use context.run() each time a new
-    // event arrives.
-    return context.run([this,&ws,message=kj::mv(message)](Worker::Lock& wLock) mutable
-        -> kj::Promise<void> {
+    // have a long stream of events over time. It makes sense to use context.run() each time new
+    // events arrive. When messages arrive faster than JavaScript handles them, each run()
+    // delivers all of those that queued up in the meantime, so they share the cost of taking the
+    // isolate lock.
+    bool closed = co_await context.run([this, &context, &batch, &delivered](Worker::Lock& wLock) {
       jsg::Lock& lock = wLock;
       auto isolate = lock.v8Isolate;
       auto& native = *farNative;
-      KJ_SWITCH_ONEOF(message) {
-        KJ_CASE_ONEOF(text, kj::String) {
-          dispatchEventImpl(lock, jsg::alloc<MessageEvent>(isolate, lock.wrapString(text)));
-        }
-        KJ_CASE_ONEOF(data, kj::Array<byte>) {
-          dispatchEventImpl(lock,
-              jsg::alloc<MessageEvent>(isolate, lock.wrapBytes(kj::mv(data))));
+      for (auto i: kj::range(delivered, batch.size())) {
+        if (i > delivered) {
+          // Each message is a separate event, so finish the previous one's microtasks first, as
+          // run() would have done had it been delivered on its own.
+          isolate->PerformMicrotaskCheckpoint();
+
+          if (context.isInputGateContended()) {
+            // In an actor, the previous message's handler is awaiting storage or has called
+            // blockConcurrencyWhile(). A run() of its own would wait for the input gate before
+            // delivering the next message, so leave the rest of the batch for the next run().
+            return false;
+          }
+
+          context.topUpActorBetweenEvents();
         }
-        KJ_CASE_ONEOF(close, kj::WebSocket::Close) {
-          native.closedIncoming = true;
-          dispatchEventImpl(lock, jsg::alloc<CloseEvent>(close.code, kj::mv(close.reason), true));
-          if ((native.closedOutgoing || native.outgoingAborted) && !native.isPumping) {
-            // Native WebSocket no longer needed; release.
-            KJ_ASSERT(native.state.is<Accepted>());
-            native.state.init<Released>();
+
+        delivered = i + 1;
+        KJ_SWITCH_ONEOF(batch[i]) {
+          KJ_CASE_ONEOF(text, kj::String) {
+            dispatchEventImpl(lock, jsg::alloc<MessageEvent>(isolate, lock.wrapString(text)));
+          }
+          KJ_CASE_ONEOF(data, kj::Array<byte>) {
+            dispatchEventImpl(lock,
+                jsg::alloc<MessageEvent>(isolate, lock.wrapBytes(kj::mv(data))));
+          }
+          KJ_CASE_ONEOF(close, kj::WebSocket::Close) {
+            // IncomingMessageQueue stops receiving after a Close, so this is the last message.
+            native.closedIncoming = true;
+            dispatchEventImpl(lock, jsg::alloc<CloseEvent>(close.code, kj::mv(close.reason), true));
+            if ((native.closedOutgoing || native.outgoingAborted) && !native.isPumping) {
+              // Native WebSocket no longer needed; release.
+              KJ_ASSERT(native.state.is<Accepted>());
+              native.state.init<Released>();
+            }
+            return true;
           }
-          return kj::READY_NOW;
         }
       }
-
-      return readLoop(ws);
+      return false;
     });
-  });
+
+    if (closed) co_return;
+  }
 }
 
 jsg::Ref<WebSocketPair> WebSocketPair::constructor() {
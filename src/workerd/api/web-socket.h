@@ -307,6 +307,10 @@ private:
     bool outgoingAborted = false;
     // Have we detected that the peer has stopped accepting messages? We may want to clean up more
     // proactively in this case.
+
+    kj::Maybe<uint64_t> outputLockCount;
+    // The actor's OutputGate::getLockCount() when the last outgoing message to wait for the output
+    // gate was queued. See waitForOutputLocks().
   };
   IoOwn<Native> farNative;
   // The underlying native WebSocket (or a promise that will emplace one).
@@ -348,6 +352,11 @@ private:
 
   void ensurePumping(jsg::Lock& js);
 
+  kj::Maybe<kj::Promise<void>> waitForOutputLocks(IoContext& context);
+  // Returns what a newly queued outgoing message must wait for before it is sent. This is null if
+  // waiting for the messages already queued is enough, which is the case for every message in a
+  // burst of sends that didn't take any output locks in between.
+
   static kj::Promise<void> pump(
       IoContext& context, OutgoingMessagesMap& outgoingMessages, kj::WebSocket& ws, Native& native);
   // Write messages from `outgoingMessages` into `ws`.
@@ -198,6 +198,8 @@ struct ActorCacheTestOptions {
   size_t maxKeysPerRpc = 128;
   bool noCache = false;
   bool neverFlush = false;
+  size_t maxFlushBytesInFlight = 32u << 20;
+  size_t maxFlushKeysInFlight = 1024;
 };
 
 struct ActorCacheTest: public ActorCacheConvenienceWrappers {
@@ -222,7 +224,8 @@ struct ActorCacheTest: public ActorCacheConvenienceWrappers {
         ws(loop), mockStorage(kj::mv(mockPair.mock)),
         lru({options.softLimit, options.hardLimit,
              options.staleTimeout, options.dirtyListByteLimit, options.maxKeysPerRpc,
-             options.noCache, options.neverFlush}),
+             options.noCache, options.neverFlush, options.maxFlushBytesInFlight,
+             options.maxFlushKeysInFlight}),
         cache(kj::mv(mockPair.client), lru, gate),
         gateBrokenPromise(options.monitorOutputGate
             ? eagerlyReportExceptions(gate.onBroken())
@@ -701,6 +704,34 @@ KJ_TEST("ActorCache batching due to max storage RPC words") {
   mockTxn->expectDropped(ws);
 }
 
+KJ_TEST("ActorCache flush window bounds batches in flight") {
+  ActorCacheTest test({.maxKeysPerRpc = 2, .maxFlushKeysInFlight = 4});
+  auto& ws = test.ws;
+  auto& mockStorage = test.mockStorage;
+
+  test.put({{"a", "1"}, {"b", "2"}, {"c", "3"}, {"d", "4"}, {"e", "5"}});
+
+  auto mockTxn = mockStorage->expectCall("txn", ws).returnMock("transaction");
+  auto put1 = mockTxn->expectCall("put", ws)
+      .withParams(CAPNP(entries = [(key = "a", value = "1"), (key = "b", value = "2")]));
+  auto put2 = mockTxn->expectCall("put", ws)
+      .withParams(CAPNP(entries = [(key = "c", value = "3"), (key = "d", value = "4")]));
+
+  // The window is full, so the last batch (and the commit) must wait.
+  mockTxn->expectNoActivity(ws);
+
+  kj::mv(put1).thenReturn(CAPNP());
+  mockTxn->expectCall("put", ws)
+      .withParams(CAPNP(entries = [(key = "e", value = "5")]))
+      .thenReturn(CAPNP());
+
+  // Everything has been sent now, so the commit is pipelined behind the outstanding batch.
+  auto commit = mockTxn->expectCall("commit", ws);
+  kj::mv(put2).thenReturn(CAPNP());
+  kj::mv(commit).thenReturn(CAPNP());
+  mockTxn->expectDropped(ws);
+}
+
 KJ_TEST("ActorCache deleteAll()") {
   ActorCacheTest test;
   auto& ws = test.ws;
@@ -1681,6 +1712,44 @@ KJ_TEST("ActorCache list() all") {
       kvs({{"bar", "456"}, {"baz", "789"}}));
 }
 
+KJ_TEST("ActorCache GetResultList from key-value pairs") {
+  constexpr uint COUNT = 1000;
+  kj::Vector<ActorCache::KeyValuePair> pairs(COUNT);
+  for (auto i: kj::range(0u, COUNT)) {
+    pairs.add(ActorCache::KeyValuePair {
+      kj::str(i), kj::heapArray(kj::str(i).asBytes()) });
+  }
+
+  size_t baseline = ActorCache::GetResultList::getLiveEntryArenaCountForTest();
+
+  {
+    // All the entries go in a single block, however many pairs there are.
+    ActorCache::GetResultList original(kj::mv(pairs));
+    KJ_EXPECT(ActorCache::GetResultList::getLiveEntryArenaCountForTest() == baseline + 1);
+
+    // Moving the list keeps the block alive, without copying it.
+    auto results = kj::mv(original);
+    KJ_EXPECT(ActorCache::GetResultList::getLiveEntryArenaCountForTest() == baseline + 1);
+    KJ_ASSERT(results.size() == COUNT);
+
+    uint i = 0;
+    for (auto kv: results) {
+      KJ_EXPECT(kv.key == kj::str(i));
+      KJ_EXPECT(kj::str(kv.value.asChars()) == kj::str(i));
+      ++i;
+    }
+    KJ_EXPECT(i == COUNT);
+  }
+
+  // The block is freed once the last entry is dropped.
+  KJ_EXPECT(ActorCache::GetResultList::getLiveEntryArenaCountForTest() == baseline);
+
+  // An empty list doesn't allocate a block at all.
+  ActorCache::GetResultList empty(kj::Vector<ActorCache::KeyValuePair>{});
+  KJ_EXPECT(empty.size() == 0);
+  KJ_EXPECT(ActorCache::GetResultList::getLiveEntryArenaCountForTest() == baseline);
+}
+
 KJ_TEST("ActorCache list() with limit") {
   ActorCacheTest test;
   auto& ws = test.ws;
@@ -1459,7 +1459,9 @@ kj::Own<ActorCache::Entry> ActorCache::addReadResultToCache(
 
     // TODO(perf): It's a little sad that we are going to do a findOrCreate() below that is going
     //   to repeat the same lookup that produced `iter`. Maybe we could extend kj::Table with a
-    //   way to provide an existing iterator as a hint when inserting?
+    //   way to provide an existing iterator as a hint when inserting? The same hint would let
+    //   list() insert each sorted batch of results after the previous key, rather than searching
+    //   the tree from the root for every key.
   }
 
   // At this point, we know we definitely want there to exist an entry matching this key. So now
@@ -1669,12 +1671,53 @@ void ActorCache::markGapsEmpty(Lock& lock, KeyPtr beginKey, kj::Maybe<KeyPtr> en
   }
 }
 
+namespace {
+std::atomic<size_t> liveEntryArenaCount = 0;
+}
+
+class ActorCache::GetResultList::EntryArena final: public kj::Disposer {
+public:
+  explicit EntryArena(size_t size): entries(kj::heapArrayBuilder<Entry>(size)) {
+    liveEntryArenaCount.fetch_add(1, std::memory_order_relaxed);
+  }
+  ~EntryArena() noexcept(false) {
+    liveEntryArenaCount.fetch_sub(1, std::memory_order_relaxed);
+  }
+
+  kj::ArrayBuilder<Entry> entries;
+
+  template <typename T>
+  kj::Own<T> addRef(T& object) {
+    // Returns an owned pointer to `object`, which must live in this arena, keeping the arena
+    // alive until it is dropped.
+    ++refcount;
+    return kj::Own<T>(&object, *this);
+  }
+
+protected:
+  void disposeImpl(void* pointer) const override {
+    if (--refcount == 0) delete this;
+  }
+
+private:
+  mutable size_t refcount = 0;
+};
+
+size_t ActorCache::GetResultList::getLiveEntryArenaCountForTest() {
+  return liveEntryArenaCount.load(std::memory_order_relaxed);
+}
+
 ActorCache::GetResultList::GetResultList(kj::Vector<KeyValuePair> contents)
     : entries(contents.size()), cacheStatuses(contents.size()) {
-  // TODO(perf): Allocating an `Entry` object for every key/value pair is lame but to avoid it
-  //   we'd have to make the common case worse...
+  // Rather than allocating an `Entry` object for every key/value pair, construct them all in one
+  // arena. This keeps the common case -- where entries are shared with the cache -- unchanged.
+  if (contents.empty()) return;
+
+  auto& arena = *new EntryArena(contents.size());
+  auto arenaRef = arena.addRef(arena);  // frees the arena if we throw before any entry holds it
   for (auto& kv: contents) {
-    entries.add(kj::heap<Entry>(kj::Badge<GetResultList>(), kj::mv(kv.key), kj::mv(kv.value)));
+    auto& entry = arena.entries.add(kj::Badge<GetResultList>(), kj::mv(kv.key), kj::mv(kv.value));
+    entries.add(arena.addRef(entry));
     cacheStatuses.add(CacheStatus::UNCACHED);
   }
 }
@@ -1694,6 +1737,7 @@ ActorCache::GetResultList::GetResultList(
 
   uint limit = maybeLimit.orDefault(kj::maxValue);
   entries.reserve(kj::min(cachedEntries.size() + fetchedEntries.size(), limit));
+  cacheStatuses.reserve(entries.capacity());
 
   auto cachedIter = cachedEntries.begin();
   auto fetchedIter = fetchedEntries.begin();
@@ -2254,6 +2298,78 @@ using RpcPutRequest = capnp::Request<rpc::ActorStorage::Operations::PutParams,
 
 using RpcDeleteRequest = capnp::Request<rpc::ActorStorage::Operations::DeleteParams,
     rpc::ActorStorage::Operations::DeleteResults>;
+
+template <typename Request>
+struct SizedRpcRequest {
+  // A write request built for a flush, along with its size for the purpose of flow control.
+  Request request;
+  size_t pairCount;
+  size_t wordCount;
+};
+
+class FlushWindow {
+  // Bounds the total size and key count of the write RPCs a flush has outstanding at once. RPCs
+  // are admitted in order, one at a time: each waits until it fits alongside those already in
+  // flight, or until nothing else is in flight if it can't fit at all.
+public:
+  FlushWindow(size_t maxWords, size_t maxKeys): maxWords(maxWords), maxKeys(maxKeys) {}
+  KJ_DISALLOW_COPY_AND_MOVE(FlushWindow);
+
+  kj::Promise<void> waitForRoom(size_t words, size_t keys) {
+    KJ_REQUIRE(waiter == nullptr, "only one RPC can wait for room at a time");
+    if (fits(words, keys)) {
+      return kj::READY_NOW;
+    }
+    auto paf = kj::newPromiseAndFulfiller<void>();
+    waiter = Waiter { words, keys, kj::mv(paf.fulfiller) };
+    return kj::mv(paf.promise);
+  }
+
+  kj::Promise<void> track(size_t words, size_t keys, kj::Promise<void> promise) {
+    // Counts the RPC represented by `promise` against the window until it completes. The returned
+    // promise is eagerly evaluated so that the window opens up even though no one waits on it
+    // until the whole flush has been sent.
+
+    wordsInFlight += words;
+    keysInFlight += keys;
+    return promise.then([this, words, keys]() {
+      release(words, keys);
+    }, [this, words, keys](kj::Exception&& e) {
+      release(words, keys);
+      kj::throwFatalException(kj::mv(e));
+    }).eagerlyEvaluate(nullptr);
+  }
+
+private:
+  size_t maxWords;
+  size_t maxKeys;
+  size_t wordsInFlight = 0;
+  size_t keysInFlight = 0;
+
+  struct Waiter {
+    size_t words;
+    size_t keys;
+    kj::Own<kj::PromiseFulfiller<void>> fulfiller;
+  };
+  kj::Maybe<Waiter> waiter;
+
+  bool fits(size_t words, size_t keys) {
+    return (wordsInFlight == 0 && keysInFlight == 0) ||
+        (wordsInFlight + words <= maxWords && keysInFlight + keys <= maxKeys);
+  }
+
+  void release(size_t words, size_t keys) {
+    wordsInFlight -= words;
+    keysInFlight -= keys;
+    KJ_IF_MAYBE(w, waiter) {
+      if (fits(w->words, w->keys)) {
+        auto fulfiller = kj::mv(w->fulfiller);
+        waiter = nullptr;
+        fulfiller->fulfill();
+      }
+    }
+  }
+};
 }
 
 kj::Promise<void> ActorCache::flushImpl(uint retryCount) {
@@ -2720,15 +2836,16 @@ kj::Promise<void> ActorCache::flushImplUsingTxn(
 
   struct RpcCountedDelete {
     kj::Own<CountedDelete> countedDelete;
-    kj::Array<RpcDeleteRequest> rpcDeletes;
+    kj::Array<SizedRpcRequest<RpcDeleteRequest>> rpcDeletes;
   };
   auto rpcCountedDeletes = kj::heapArrayBuilder<RpcCountedDelete>(countedDeleteFlushes.size());
-  auto rpcMutedDeletes = kj::heapArrayBuilder<RpcDeleteRequest>(mutedDeleteFlush.batches.size());
-  auto rpcPuts = kj::heapArrayBuilder<RpcPutRequest>(putFlush.batches.size());
+  auto rpcMutedDeletes = kj::heapArrayBuilder<SizedRpcRequest<RpcDeleteRequest>>(
+      mutedDeleteFlush.batches.size());
+  auto rpcPuts = kj::heapArrayBuilder<SizedRpcRequest<RpcPutRequest>>(putFlush.batches.size());
 
   for (auto& flush: countedDeleteFlushes) {
     auto entryIt = flush.entries.begin();
-    kj::Vector<RpcDeleteRequest> rpcDeletes;
+    kj::Vector<SizedRpcRequest<RpcDeleteRequest>> rpcDeletes;
     for (auto& batch: flush.batches) {
       KJ_ASSERT(batch.wordCount < MAX_ACTOR_STORAGE_RPC_WORDS);
 
@@ -2740,7 +2857,8 @@ kj::Promise<void> ActorCache::flushImplUsingTxn(
         listBuilder.set(i, entry.key.asBytes());
       }
 
-      rpcDeletes.add(kj::mv(request));
+      rpcDeletes.add(SizedRpcRequest<RpcDeleteRequest> {
+        kj::mv(request), batch.pairCount, batch.wordCount });
     }
     rpcCountedDeletes.add(RpcCountedDelete{
       .countedDelete = kj::mv(flush.countedDelete),
@@ -2761,7 +2879,8 @@ kj::Promise<void> ActorCache::flushImplUsingTxn(
         auto& entry = **(entryIt++);
         listBuilder.set(i, entry.key.asBytes());
       }
-      rpcMutedDeletes.add(kj::mv(request));
+      rpcMutedDeletes.add(SizedRpcRequest<RpcDeleteRequest> {
+        kj::mv(request), batch.pairCount, batch.wordCount });
     }
     KJ_ASSERT(entryIt == mutedDeleteFlush.entries.end());
   }
@@ -2780,7 +2899,8 @@ kj::Promise<void> ActorCache::flushImplUsingTxn(
         kv.setKey(entry.key.asBytes());
         kv.setValue(v);
       }
-      rpcPuts.add(kj::mv(request));
+      rpcPuts.add(SizedRpcRequest<RpcPutRequest> {
+        kj::mv(request), batch.pairCount, batch.wordCount });
     }
     KJ_ASSERT(entryIt == putFlush.entries.end());
   }
@@ -2817,30 +2937,37 @@ kj::Promise<void> ActorCache::flushImplUsingTxn(
   // put() on the same key. These two writes may have been coalesced into a single flush.
   // Unfortunately, we can't just skip the delete because we still need to count it. So we issue
   // a delete, followed by a put, in the same transaction.
-  // The constant extra 2 promises are those added outside of the rpc batches, currently one
-  // to work around a bug in capnp::autoreconnect, and one to actually commit the flush txn
-  // A 3rd promise may be added to write the alarm time if necessary.
-  auto promises = kj::heapArrayBuilder<kj::Promise<void>>(
-      rpcPuts.size() + rpcMutedDeletes.size() + rpcCountedDeletes.size()
-      + 2 + !maybeAlarmChange.is<CleanAlarm>());
-
-  auto joinCountedDelete = [](RpcCountedDelete& rpcCountedDelete) -> kj::Promise<void> {
-    auto promises = KJ_MAP(request, rpcCountedDelete.rpcDeletes) {
-      return request.send().then(
-          [](capnp::Response<rpc::ActorStorage::Operations::DeleteResults>&& response) mutable
-          -> uint {
-        return response.getNumDeleted();
-      });
-    };
+  //
+  // The RPCs are pipelined on the transaction in that order, but only a bounded window of them is
+  // allowed to be in flight at once, so that flushing a huge dirty set doesn't saturate the
+  // connection. This doesn't affect consistency: everything was already copied into the requests
+  // above, and nothing is visible until the commit.
+  kj::Vector<kj::Promise<void>> promises;
+
+  // We have to wait on the transaction promise so we don't cancel the catch_ branch that triggers
+  // our autoReconnect logic on storage failures.
+  // TODO(cleanup): We should probably fix ReconnectHook so the catch_ doesn't get canceled
+  // if the promise is dropped but the pipeline stays alive.
+  promises.add(txnProm.ignoreResult());
+
+  FlushWindow window(lru.options.maxFlushBytesInFlight / sizeof(capnp::word),
+                     lru.options.maxFlushKeysInFlight);
 
-    for (auto& promise : promises) {
-      // Reuse `countDeleted` since it's already in a state object anyway.
-      rpcCountedDelete.countedDelete->countDeleted += co_await promise;
-    }
-  };
   for (auto& rpcCountedDelete: rpcCountedDeletes) {
-    promises.add(joinCountedDelete(rpcCountedDelete).then(
-        [&countedDelete = *rpcCountedDelete.countedDelete]() mutable {
+    auto& countedDelete = *rpcCountedDelete.countedDelete;
+    auto batchPromises = kj::heapArrayBuilder<kj::Promise<void>>(
+        rpcCountedDelete.rpcDeletes.size());
+    for (auto& rpcDelete: rpcCountedDelete.rpcDeletes) {
+      co_await window.waitForRoom(rpcDelete.wordCount, rpcDelete.pairCount);
+      batchPromises.add(window.track(rpcDelete.wordCount, rpcDelete.pairCount,
+          rpcDelete.request.send().then([&countedDelete](
+              capnp::Response<rpc::ActorStorage::Operations::DeleteResults>&& response) {
+        // Reuse `countDeleted` since it's already in a state object anyway.
+        countedDelete.countDeleted += response.getNumDeleted();
+      })));
+    }
+
+    promises.add(kj::joinPromises(batchPromises.finish()).then([&countedDelete]() mutable {
       // Note that it's OK to trust the delete count even if the transaction ultimately gets rolled
       // back, because:
       // - We know that nothing else could be concurrently modifying our storage in a way that
@@ -2850,7 +2977,7 @@ kj::Promise<void> ActorCache::flushImplUsingTxn(
       // HACK: This uses a `kj::mv()` because promise fulfillers require rvalues even for trivially
       // copyable types.
       countedDelete.resultFulfiller->fulfill(kj::mv(countedDelete.countDeleted));
-    }, [&countedDelete = *rpcCountedDelete.countedDelete](kj::Exception&& e) {
+    }, [&countedDelete](kj::Exception&& e) {
       if (e.getType() == kj::Exception::Type::DISCONNECTED) {
         // This deletion will be retried, so don't touch the fulfiller.
       } else {
@@ -2859,12 +2986,16 @@ kj::Promise<void> ActorCache::flushImplUsingTxn(
     }));
   }
 
-  for (auto& request: rpcMutedDeletes) {
-    promises.add(request.send().ignoreResult());
+  for (auto& rpcDelete: rpcMutedDeletes) {
+    co_await window.waitForRoom(rpcDelete.wordCount, rpcDelete.pairCount);
+    promises.add(window.track(rpcDelete.wordCount, rpcDelete.pairCount,
+        rpcDelete.request.send().ignoreResult()));
   }
 
-  for (auto& request: rpcPuts) {
-    promises.add(request.send().ignoreResult());
+  for (auto& rpcPut: rpcPuts) {
+    co_await window.waitForRoom(rpcPut.wordCount, rpcPut.pairCount);
+    promises.add(window.track(rpcPut.wordCount, rpcPut.pairCount,
+        rpcPut.request.send().ignoreResult()));
   }
 
   KJ_SWITCH_ONEOF(maybeAlarmChange) {
@@ -2905,15 +3036,9 @@ kj::Promise<void> ActorCache::flushImplUsingTxn(
     KJ_CASE_ONEOF(_, CleanAlarm) {}
   }
 
-  // We have to wait on the transaction promise so we don't cancel the catch_ branch that triggers
-  // our autoReconnect logic on storage failures.
-  // TODO(cleanup): We should probably fix ReconnectHook so the catch_ doesn't get canceled
-  // if the promise is dropped but the pipeline stays alive.
-  promises.add(txnProm.ignoreResult());
-
   promises.add(txn.commitRequest(capnp::MessageSize { 4, 0 }).send().ignoreResult());
 
-  co_await kj::joinPromises(promises.finish());
+  co_await kj::joinPromises(promises.releaseAsArray());
 }
 
 kj::Promise<void> ActorCache::flushImplDeleteAll(uint retryCount) {
@@ -42,6 +42,8 @@ struct ActorCacheWriteOptions {
   // key.  Hence, `noCache` does not affect consistency, only performance.
 };
 
+class ActorCacheInterface;
+
 class ActorCacheOps {
   // Common interface between ActorCache and ActorCache::Transaction.
 public:
@@ -154,6 +156,10 @@ public:
   // Returns a `bool` or `uint` if it can be immediately determined from cache how many keys were
   // present before the call. Otherwise, returns a promise which resolves after getting a response
   // from underlying storage. The promise also applies backpressure if needed, as with put().
+
+  virtual kj::Maybe<ActorCacheInterface&> getDirectReader() { return nullptr; }
+  // Returns this object if it may support the direct-read methods of ActorCacheInterface. (A
+  // transaction never does.)
 };
 
 class ActorCacheInterface: public ActorCacheOps {
@@ -216,6 +222,39 @@ public:
   virtual void cancelDeferredAlarmDeletion() = 0;
 
   virtual kj::Maybe<kj::Promise<void>> onNoPendingFlush() = 0;
+
+  kj::Maybe<ActorCacheInterface&> getDirectReader() override { return *this; }
+
+  // Direct reads.
+  //
+  // `get()` and `list()` copy every value out of storage into a `Value` before the caller sees
+  // it, which the caller then typically parses and drops. The methods below instead pass each
+  // value to a callback as a `ValuePtr` pointing straight into the storage engine's buffers, valid
+  // only until the callback returns, so that the caller can parse it in place.
+  //
+  // Only implementations which can answer reads synchronously support this. The default
+  // implementations return null without calling the callback, in which case the caller should fall
+  // back to `get()` or `list()`.
+
+  virtual kj::Maybe<bool> getDirect(KeyPtr key, ReadOptions options,
+      kj::FunctionParam<void(ValuePtr value)> callback) { return nullptr; }
+  // Calls `callback` with the value for `key`, if any. Returns whether there was a value.
+
+  virtual kj::Maybe<uint> getDirect(kj::ArrayPtr<const Key> keys, ReadOptions options,
+      kj::FunctionParam<void(KeyPtr key, ValuePtr value)> callback) { return nullptr; }
+  // Calls `callback` for each of `keys` which has a value, in key order. Duplicate keys are
+  // reported once. Returns the number of callbacks made.
+
+  virtual kj::Maybe<uint> listDirect(KeyPtr begin, kj::Maybe<KeyPtr> end, kj::Maybe<uint> limit,
+      ReadOptions options, kj::FunctionParam<void(KeyPtr key, ValuePtr value)> callback) {
+    return nullptr;
+  }
+  virtual kj::Maybe<uint> listReverseDirect(KeyPtr begin, kj::Maybe<KeyPtr> end,
+      kj::Maybe<uint> limit, ReadOptions options,
+      kj::FunctionParam<void(KeyPtr key, ValuePtr value)> callback) {
+    return nullptr;
+  }
+  // Like `list()` and `listReverse()`. Returns the number of callbacks made.
 };
 
 class ActorCache final: public ActorCacheInterface {
@@ -569,7 +608,9 @@ private:
   //
   // TODO(perf): If we could rely on e-order on the ActorStorage API, we could pipeline additional
   //   writes and not have to worry about this. However, at present, ActorStorage has automatic
-  //   reconnect behavior at the supervisor layer which violates e-order.
+  //   reconnect behavior at the supervisor layer which violates e-order. (Within a single flush,
+  //   batches are pipelined on the transaction, subject to `maxFlushBytesInFlight` and
+  //   `maxFlushKeysInFlight`.)
 
   kj::Maybe<kj::Exception> maybeTerminalException;
   // Did we hit a problem that makes the ActorCache unusable? If so this is the exception that
@@ -730,12 +771,22 @@ public:
   size_t size() const { return entries.size(); }
 
   explicit GetResultList(kj::Vector<KeyValuePair> contents);
-  // Construct a simple GetResultList from key-value pairs.
+  // Construct a simple GetResultList from key-value pairs. (In practice only ActorSqlite builds
+  // results this way, and the storage API mostly bypasses it via getDirectReader().)
+
+  static size_t getLiveEntryArenaCountForTest();
+  // Number of entry blocks allocated by the above constructor which haven't yet been freed.
 
 private:
   kj::Vector<kj::Own<Entry>> entries;
   kj::Vector<CacheStatus> cacheStatuses;
 
+  class EntryArena;
+  // When constructed from key-value pairs, the entries are never shared with a cache, so they're
+  // all allocated in one block. The block is the disposer for each `Own<Entry>` pointing into it
+  // and is freed once all of them are dropped, so the entries may safely be moved into another
+  // list that outlives this one.
+
   enum Order {
     FORWARD,
     REVERSE
@@ -789,6 +840,13 @@ struct ActorCacheSharedLruOptions {
   bool neverFlush = false;
   // If true, don't actually flush anything. This is used in preview sessions, since they keep
   // state strictly in memory.
+
+  size_t maxFlushBytesInFlight = 32u << 20;
+  size_t maxFlushKeysInFlight = 1024;
+  // Limits on the total size and key count of write RPCs outstanding at once while flushing a
+  // transaction. Further batches are sent as earlier ones complete, so that flushing a huge dirty
+  // set doesn't go out as a single burst. A batch that exceeds these limits by itself is still
+  // sent, once nothing else is in flight.
 };
 
 class ActorCache::SharedLru {
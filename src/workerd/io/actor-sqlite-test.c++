@@ -0,0 +1,215 @@
+// Copyright (c) 2023 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#include "actor-sqlite.h"
+#include "io-gate.h"
+#include <kj/test.h>
+
+namespace workerd {
+namespace {
+
+struct ActorSqliteTest {
+  kj::EventLoop loop;
+  kj::WaitScope ws;
+
+  OutputGate gate;
+  kj::Own<const kj::Directory> dir = kj::newInMemoryDirectory(kj::nullClock());
+  SqliteDatabase::Vfs vfs;
+  ActorSqlite actor;
+
+  ActorSqliteTest()
+      : ws(loop), vfs(*dir), actor(vfs, kj::Path({"foo.sqlite"}), gate) {}
+
+  kj::Maybe<kj::String> readCommitted(kj::StringPtr key) {
+    // Reads `key` through a separate connection, which can only see committed data.
+    SqliteDatabase db(vfs, kj::Path({"foo.sqlite"}), kj::WriteMode::MODIFY);
+    auto query = db.run("SELECT value FROM _cf_KV WHERE key = ?", key);
+    kj::Maybe<kj::String> result;
+    if (!query.isDone()) {
+      result = kj::str(query.getBlob(0).asChars());
+    }
+    return result;
+  }
+};
+
+KJ_TEST("ActorSqlite batches writes from one turn into one transaction") {
+  ActorSqliteTest test;
+  auto& actor = test.actor;
+
+  KJ_EXPECT(actor.put(kj::str("foo"), kj::heapArray("abc"_kj.asBytes()), {}) == nullptr);
+  KJ_EXPECT(actor.put(kj::str("bar"), kj::heapArray("def"_kj.asBytes()), {}) == nullptr);
+
+  // Writes are visible to this connection immediately...
+  KJ_EXPECT(kj::str(KJ_ASSERT_NONNULL(actor.get(kj::str("foo"), {})
+      .get<kj::Maybe<ActorCacheOps::Value>>()).asChars()) == "abc");
+
+  // ...but haven't been committed yet. The output gate is held until they are.
+  KJ_EXPECT(test.readCommitted("foo") == nullptr);
+  KJ_EXPECT(actor.onNoPendingFlush() != nullptr);
+  test.gate.wait().wait(test.ws);
+
+  KJ_EXPECT(KJ_ASSERT_NONNULL(test.readCommitted("foo")) == "abc");
+  KJ_EXPECT(KJ_ASSERT_NONNULL(test.readCommitted("bar")) == "def");
+  KJ_EXPECT(actor.onNoPendingFlush() == nullptr);
+
+  // A later write opens a new transaction.
+  KJ_EXPECT(actor.delete_(kj::str("foo"), {}).get<bool>());
+  KJ_EXPECT(test.readCommitted("foo") != nullptr);
+  test.gate.wait().wait(test.ws);
+  KJ_EXPECT(test.readCommitted("foo") == nullptr);
+}
+
+KJ_TEST("ActorSqlite commits unconfirmed writes too") {
+  ActorSqliteTest test;
+  auto& actor = test.actor;
+
+  KJ_EXPECT(actor.put(kj::str("foo"), kj::heapArray("abc"_kj.asBytes()),
+                      { .allowUnconfirmed = true }) == nullptr);
+  KJ_EXPECT(test.readCommitted("foo") == nullptr);
+
+  KJ_ASSERT_NONNULL(actor.onNoPendingFlush()).wait(test.ws);
+  KJ_EXPECT(KJ_ASSERT_NONNULL(test.readCommitted("foo")) == "abc");
+}
+
+KJ_TEST("ActorSqlite rolls back the implicit transaction if its commit fails") {
+  ActorSqliteTest test;
+  auto& actor = test.actor;
+  auto& db = actor.getSqliteDatabase();
+
+  db.run("PRAGMA foreign_keys = ON");
+  db.run("CREATE TABLE parent (id INTEGER PRIMARY KEY)");
+  db.run("CREATE TABLE child (parentId INTEGER REFERENCES parent(id) "
+         "DEFERRABLE INITIALLY DEFERRED)");
+
+  // A deferred foreign key violation makes COMMIT fail and leaves the transaction open.
+  actor.put(kj::str("foo"), kj::heapArray("abc"_kj.asBytes()), {});
+  db.run("INSERT INTO child VALUES (123)");
+  KJ_EXPECT_THROW_MESSAGE("FOREIGN KEY constraint failed", test.gate.wait().wait(test.ws));
+  KJ_EXPECT(test.readCommitted("foo") == nullptr);
+
+  // The failed transaction was rolled back, so the next write opens and commits a new one.
+  actor.put(kj::str("bar"), kj::heapArray("def"_kj.asBytes()), { .allowUnconfirmed = true });
+  KJ_ASSERT_NONNULL(actor.onNoPendingFlush()).wait(test.ws);
+  KJ_EXPECT(KJ_ASSERT_NONNULL(test.readCommitted("bar")) == "def");
+  KJ_EXPECT(test.readCommitted("foo") == nullptr);
+}
+
+KJ_TEST("ActorSqlite direct reads") {
+  ActorSqliteTest test;
+  auto& actor = test.actor;
+
+  actor.put(kj::str("foo"), kj::heapArray("abc"_kj.asBytes()), {});
+  actor.put(kj::str("bar"), kj::heapArray("def"_kj.asBytes()), {});
+  actor.put(kj::str("baz"), kj::heapArray("123"_kj.asBytes()), {});
+
+  kj::Vector<kj::String> seen;
+  auto callback = [&](kj::StringPtr key, kj::ArrayPtr<const byte> value) {
+    seen.add(kj::str(key, "=", value.asChars()));
+  };
+
+  KJ_EXPECT(KJ_ASSERT_NONNULL(actor.getDirect("foo", {}, [&](kj::ArrayPtr<const byte> value) {
+    seen.add(kj::str(value.asChars()));
+  })));
+  KJ_EXPECT(!KJ_ASSERT_NONNULL(actor.getDirect("qux", {}, [&](kj::ArrayPtr<const byte>) {
+    KJ_FAIL_EXPECT("should not call callback when no match");
+  })));
+  KJ_EXPECT(kj::strArray(seen, ", ") == "abc");
+  seen.clear();
+
+  // Results come back sorted and deduplicated, regardless of the order of the keys.
+  auto keys = kj::arr(kj::str("foo"), kj::str("qux"), kj::str("bar"), kj::str("foo"));
+  KJ_EXPECT(KJ_ASSERT_NONNULL(actor.getDirect(keys, {}, callback)) == 2);
+  KJ_EXPECT(kj::strArray(seen, ", ") == "bar=def, foo=abc");
+  seen.clear();
+
+  KJ_EXPECT(KJ_ASSERT_NONNULL(actor.listDirect("baz", nullptr, nullptr, {}, callback)) == 2);
+  KJ_EXPECT(kj::strArray(seen, ", ") == "baz=123, foo=abc");
+  seen.clear();
+
+  KJ_EXPECT(KJ_ASSERT_NONNULL(actor.listReverseDirect("", "foo"_kj, 1, {}, callback)) == 1);
+  KJ_EXPECT(kj::strArray(seen, ", ") == "baz=123");
+}
+
+KJ_TEST("ActorSqlite transactions") {
+  ActorSqliteTest test;
+  auto& actor = test.actor;
+
+  auto getValue = [&](ActorCacheOps& ops, kj::StringPtr key) -> kj::Maybe<kj::String> {
+    return ops.get(kj::str(key), {}).get<kj::Maybe<ActorCacheOps::Value>>()
+        .map([](auto&& value) { return kj::str(value.asChars()); });
+  };
+  auto listKeys = [&](ActorCacheOps& ops, bool reverse, kj::Maybe<uint> limit) {
+    auto read = reverse ? ops.listReverse(kj::str(), nullptr, limit, {})
+                        : ops.list(kj::str(), nullptr, limit, {});
+    kj::Vector<kj::String> seen;
+    for (auto entry: read.get<ActorCacheOps::GetResultList>()) {
+      seen.add(kj::str(entry.key, "=", entry.value.asChars()));
+    }
+    return kj::strArray(seen, ", ");
+  };
+
+  actor.put(kj::str("bar"), kj::heapArray("123"_kj.asBytes()), {});
+  actor.put(kj::str("foo"), kj::heapArray("abc"_kj.asBytes()), {});
+  test.gate.wait().wait(test.ws);
+
+  {
+    auto txn = actor.startTransaction();
+    txn->put(kj::str("foo"), kj::heapArray("def"_kj.asBytes()), {});
+    txn->put(kj::str("baz"), kj::heapArray("456"_kj.asBytes()), {});
+    KJ_EXPECT(txn->delete_(kj::str("bar"), {}).get<bool>());
+    KJ_EXPECT(!txn->delete_(kj::str("qux"), {}).get<bool>());
+
+    // Reads through the transaction see its writes; reads outside of it don't.
+    KJ_EXPECT(KJ_ASSERT_NONNULL(getValue(*txn, "foo")) == "def");
+    KJ_EXPECT(getValue(*txn, "bar") == nullptr);
+    KJ_EXPECT(KJ_ASSERT_NONNULL(getValue(actor, "foo")) == "abc");
+    KJ_EXPECT(listKeys(*txn, false, nullptr) == "baz=456, foo=def");
+    KJ_EXPECT(listKeys(*txn, false, 1) == "baz=456");
+    KJ_EXPECT(listKeys(*txn, true, 1) == "foo=def");
+    {
+      auto keys = kj::arr(kj::str("foo"), kj::str("bar"), kj::str("baz"), kj::str("foo"));
+      auto results = txn->get(kj::mv(keys), {});
+      KJ_EXPECT(results.get<ActorCacheOps::GetResultList>().size() == 2);
+    }
+
+    // An open transaction doesn't hold the output gate or a commit, so waiting on either -- as
+    // fetch() and sync() do -- doesn't deadlock.
+    KJ_EXPECT(test.gate.wait().poll(test.ws));
+    KJ_EXPECT(actor.onNoPendingFlush() == nullptr);
+
+    // Nor does it hold up writes made outside of it.
+    actor.put(kj::str("other"), kj::heapArray("xyz"_kj.asBytes()), {});
+    test.gate.wait().wait(test.ws);
+    KJ_EXPECT(KJ_ASSERT_NONNULL(test.readCommitted("other")) == "xyz");
+    KJ_EXPECT(KJ_ASSERT_NONNULL(test.readCommitted("foo")) == "abc");
+
+    // Committing applies all of the writes in one go, confirmed through the output gate.
+    KJ_EXPECT(txn->commit() == nullptr);
+    KJ_EXPECT(KJ_ASSERT_NONNULL(getValue(actor, "foo")) == "def");
+    KJ_EXPECT(KJ_ASSERT_NONNULL(test.readCommitted("foo")) == "abc");
+    KJ_EXPECT(!test.gate.wait().poll(test.ws));
+  }
+
+  test.gate.wait().wait(test.ws);
+  KJ_EXPECT(KJ_ASSERT_NONNULL(test.readCommitted("foo")) == "def");
+  KJ_EXPECT(KJ_ASSERT_NONNULL(test.readCommitted("baz")) == "456");
+  KJ_EXPECT(test.readCommitted("bar") == nullptr);
+
+  {
+    // Dropping or rolling back a transaction discards its writes, and not anyone else's.
+    auto txn = actor.startTransaction();
+    auto txn2 = actor.startTransaction();
+    txn->put(kj::str("foo"), kj::heapArray("ghi"_kj.asBytes()), {});
+    txn2->put(kj::str("bar"), kj::heapArray("789"_kj.asBytes()), {});
+    actor.put(kj::str("other"), kj::heapArray("uvw"_kj.asBytes()), {});
+    txn2->rollback().wait(test.ws);
+    KJ_EXPECT_THROW_MESSAGE("already finished", txn2->commit());
+  }
+  KJ_EXPECT(KJ_ASSERT_NONNULL(getValue(actor, "foo")) == "def");
+  KJ_EXPECT(getValue(actor, "bar") == nullptr);
+  KJ_EXPECT(KJ_ASSERT_NONNULL(getValue(actor, "other")) == "uvw");
+}
+
+}  // namespace
+}  // namespace workerd
@@ -3,6 +3,7 @@
 //     https://opensource.org/licenses/Apache-2.0
 
 #include "actor-sqlite.h"
+#include "io-gate.h"
 #include <algorithm>
 #include <workerd/jsg/jsg.h>
 
@@ -20,14 +21,12 @@ kj::OneOf<kj::Maybe<ActorCacheOps::Value>,
 
 kj::OneOf<ActorCacheOps::GetResultList, kj::Promise<ActorCacheOps::GetResultList>>
     ActorSqlite::get(kj::Array<Key> keys, ReadOptions options) {
-  kj::Vector<KeyValuePair> results;
-  for (auto& key: keys) {
-    kv.get(key, [&](ValuePtr value) {
-      results.add(KeyValuePair { kj::mv(key), kj::heapArray(value) });
-    });
-  }
-  std::sort(results.begin(), results.end(),
-      [](auto& a, auto& b) { return a.key < b.key; });
+  kj::Vector<KeyValuePair> results(keys.size());
+  getDirect(keys, options, [&](KeyPtr key, ValuePtr value) {
+    results.add(KeyValuePair { kj::str(key), kj::heapArray(value) });
+  });
+
+  // Already guaranteed sorted.
   return GetResultList(kj::mv(results));
 }
 
@@ -61,29 +60,27 @@ kj::OneOf<ActorCacheOps::GetResultList, kj::Promise<ActorCacheOps::GetResultList
 }
 
 kj::Maybe<kj::Promise<void>> ActorSqlite::put(Key key, Value value, WriteOptions options) {
+  onWrite(options);
   kv.put(key, value);
   return nullptr;
 }
 
 kj::Maybe<kj::Promise<void>> ActorSqlite::put(
     kj::Array<KeyValuePair> pairs, WriteOptions options) {
-  for (auto& pair: pairs) {
-    kv.put(pair.key, pair.value);
-  }
+  onWrite(options);
+  kv.putMultiple(pairs.asPtr());
   return nullptr;
 }
 
 kj::OneOf<bool, kj::Promise<bool>> ActorSqlite::delete_(Key key, WriteOptions options) {
+  onWrite(options);
   return kv.delete_(key);
 }
 
 kj::OneOf<uint, kj::Promise<uint>> ActorSqlite::delete_(
     kj::Array<Key> keys, WriteOptions options) {
-  uint count = 0;
-  for (auto& key: keys) {
-    count += kv.delete_(key);
-  }
-  return count;
+  onWrite(options);
+  return kv.deleteMultiple(keys.asPtr());
 }
 
 kj::Maybe<kj::Promise<void>> ActorSqlite::setAlarm(
@@ -93,11 +90,11 @@ kj::Maybe<kj::Promise<void>> ActorSqlite::setAlarm(
 }
 
 kj::Own<ActorCacheInterface::Transaction> ActorSqlite::startTransaction() {
-  // TODO(sqlite): Implement transactions.
-  JSG_FAIL_REQUIRE(Error, "transaction() not yet implemented for SQLite-backed storage");
+  return kj::heap<Transaction>(*this);
 }
 
 ActorCacheInterface::DeleteAllResults ActorSqlite::deleteAll(WriteOptions options) {
+  onWrite(options);
   uint count = kv.deleteAll();
   return {
     .backpressure = nullptr,
@@ -127,7 +124,313 @@ void ActorSqlite::cancelDeferredAlarmDeletion() {
 
 kj::Maybe<kj::Promise<void>> ActorSqlite::onNoPendingFlush() {
   // TODO(sqlite): onNoPendingFlush() should wait for replication if applicable.
+  if (commitScheduled) {
+    return lastCommit.addBranch();
+  }
   return nullptr;
 }
 
+kj::Maybe<bool> ActorSqlite::getDirect(KeyPtr key, ReadOptions options,
+    kj::FunctionParam<void(ValuePtr value)> callback) {
+  return kv.get(key, callback);
+}
+
+kj::Maybe<uint> ActorSqlite::getDirect(kj::ArrayPtr<const Key> keys, ReadOptions options,
+    kj::FunctionParam<void(KeyPtr key, ValuePtr value)> callback) {
+  // Each batch that SqliteKv executes returns its matches in key order, so sorting the keys up
+  // front makes the whole result sorted.
+  auto sorted = KJ_MAP(key, keys) -> KeyPtr { return key; };
+  std::sort(sorted.begin(), sorted.end());
+  auto end = std::unique(sorted.begin(), sorted.end());
+  return kv.getMultiple(sorted.slice(0, end - sorted.begin()), callback);
+}
+
+kj::Maybe<uint> ActorSqlite::listDirect(KeyPtr begin, kj::Maybe<KeyPtr> end,
+    kj::Maybe<uint> limit, ReadOptions options,
+    kj::FunctionParam<void(KeyPtr key, ValuePtr value)> callback) {
+  return kv.list(begin, end, limit, SqliteKv::FORWARD, callback);
+}
+
+kj::Maybe<uint> ActorSqlite::listReverseDirect(KeyPtr begin, kj::Maybe<KeyPtr> end,
+    kj::Maybe<uint> limit, ReadOptions options,
+    kj::FunctionParam<void(KeyPtr key, ValuePtr value)> callback) {
+  return kv.list(begin, end, limit, SqliteKv::REVERSE, callback);
+}
+
+void ActorSqlite::onWrite(const WriteOptions& options) {
+  if (!commitScheduled) {
+    beginTxn.run();
+    commitScheduled = true;
+
+    // Chain onto the previous commit so that it isn't canceled if it hasn't quite finished
+    // propagating through the output gate yet. Either way, the commit itself runs in a later turn
+    // of the event loop, so all writes made in this turn land in the same transaction. If the
+    // previous commit failed, that has already been reported through the output gate.
+    auto commitPromise = lastCommit.addBranch().catch_([](kj::Exception&&) {})
+        .attach(kj::defer([this]() {
+      commitScheduled = false;
+      commitScheduledWithOutputGate = false;
+    })).then([this]() {
+      commitImplicitTransaction();
+    });
+
+    if (options.allowUnconfirmed) {
+      // Don't apply output gate. But, if an exception is thrown, we still want to break the gate,
+      // so arrange for that.
+      commitPromise = commitPromise.catch_([this](kj::Exception&& e) {
+        return outputGate.lockWhile(kj::Promise<void>(kj::mv(e)));
+      });
+    } else {
+      commitPromise = outputGate.lockWhile(kj::mv(commitPromise));
+      commitScheduledWithOutputGate = true;
+    }
+
+    lastCommit = commitPromise.fork();
+  } else if (!commitScheduledWithOutputGate && !options.allowUnconfirmed) {
+    // The commit has already been scheduled without the output gate, but we want to upgrade it to
+    // use the output gate now.
+    lastCommit = outputGate.lockWhile(lastCommit.addBranch()).fork();
+    commitScheduledWithOutputGate = true;
+  }
+}
+
+void ActorSqlite::commitImplicitTransaction() {
+  KJ_IF_MAYBE(exception, kj::runCatchingExceptions([&]() { commitTxn.run(); })) {
+    // Some errors, such as a deferred constraint violation, leave the transaction open. Others
+    // roll it back automatically, in which case ROLLBACK fails and there's nothing to do.
+    kj::runCatchingExceptions([&]() { rollbackTxn.run(); });
+    kj::throwFatalException(kj::mv(*exception));
+  }
+}
+
+// =======================================================================================
+// ActorSqlite::Transaction
+
+void ActorSqlite::Transaction::requireOpen(kj::StringPtr op) {
+  JSG_REQUIRE(!done, Error, kj::str("Cannot ", op, " on a transaction that has already finished."));
+}
+
+bool ActorSqlite::Transaction::existsInParent(KeyPtr key) {
+  return parent.kv.get(key, [](ValuePtr) {});
+}
+
+void ActorSqlite::Transaction::putChange(
+    Key key, kj::Maybe<Value> value, const WriteOptions& options) {
+  changes.upsert(Change { kj::mv(key), kj::mv(value), options },
+      [](Change& existing, Change&& replacement) {
+    existing.value = kj::mv(replacement.value);
+    existing.options = replacement.options;
+  });
+}
+
+kj::OneOf<kj::Maybe<ActorCacheOps::Value>, kj::Promise<kj::Maybe<ActorCacheOps::Value>>>
+    ActorSqlite::Transaction::get(Key key, ReadOptions options) {
+  requireOpen("get()");
+  KJ_IF_MAYBE(change, changes.find(key)) {
+    return change->value.map([](const Value& value) { return kj::heapArray<byte>(value); });
+  }
+  return parent.get(kj::mv(key), options);
+}
+
+kj::OneOf<ActorCacheOps::GetResultList, kj::Promise<ActorCacheOps::GetResultList>>
+    ActorSqlite::Transaction::get(kj::Array<Key> keys, ReadOptions options) {
+  requireOpen("get()");
+
+  kj::Vector<const Change*> changed;
+  kj::Vector<Key> keysToFetch;
+  for (auto& key: keys) {
+    KJ_IF_MAYBE(change, changes.find(key)) {
+      changed.add(change);
+    } else {
+      keysToFetch.add(kj::mv(key));
+    }
+  }
+
+  std::sort(changed.begin(), changed.end(),
+      [](const Change* a, const Change* b) { return a->key < b->key; });
+  auto end = std::unique(changed.begin(), changed.end());
+  changed.truncate(end - changed.begin());
+
+  auto storedRead = parent.get(keysToFetch.releaseAsArray(), options);
+  auto stored = kj::mv(storedRead.get<GetResultList>());
+  return merge(changed.asPtr(), kj::mv(stored), nullptr, false);
+}
+
+kj::OneOf<kj::Maybe<kj::Date>, kj::Promise<kj::Maybe<kj::Date>>>
+    ActorSqlite::Transaction::getAlarm(ReadOptions options) {
+  requireOpen("getAlarm()");
+  return parent.getAlarm(options);
+}
+
+kj::OneOf<ActorCacheOps::GetResultList, kj::Promise<ActorCacheOps::GetResultList>>
+    ActorSqlite::Transaction::list(
+      Key begin, kj::Maybe<Key> end, kj::Maybe<uint> limit, ReadOptions options) {
+  requireOpen("list()");
+  KJ_IF_MAYBE(e, end) {
+    if (begin >= *e) return GetResultList(kj::Vector<KeyValuePair>());
+  }
+
+  kj::Vector<const Change*> changed;
+  auto endIter = end == nullptr ? changes.ordered().end() : changes.seek(KJ_ASSERT_NONNULL(end));
+  for (auto iter = changes.seek(begin); iter != endIter; ++iter) {
+    changed.add(&*iter);
+  }
+
+  // Each change can knock at most one row out of the stored results, so ask for that many more.
+  auto storedLimit = limit.map([&](uint n) -> uint { return n + changed.size(); });
+  auto storedRead = parent.list(kj::mv(begin), kj::mv(end), storedLimit, options);
+  auto stored = kj::mv(storedRead.get<GetResultList>());
+  return merge(changed.asPtr(), kj::mv(stored), limit, false);
+}
+
+kj::OneOf<ActorCacheOps::GetResultList, kj::Promise<ActorCacheOps::GetResultList>>
+    ActorSqlite::Transaction::listReverse(
+      Key begin, kj::Maybe<Key> end, kj::Maybe<uint> limit, ReadOptions options) {
+  requireOpen("list()");
+  KJ_IF_MAYBE(e, end) {
+    if (begin >= *e) return GetResultList(kj::Vector<KeyValuePair>());
+  }
+
+  kj::Vector<const Change*> changed;
+  auto beginIter = changes.seek(begin);
+  auto iter = end == nullptr ? changes.ordered().end() : changes.seek(KJ_ASSERT_NONNULL(end));
+  while (iter != beginIter) {
+    --iter;
+    changed.add(&*iter);
+  }
+
+  auto storedLimit = limit.map([&](uint n) -> uint { return n + changed.size(); });
+  auto storedRead = parent.listReverse(kj::mv(begin), kj::mv(end), storedLimit, options);
+  auto stored = kj::mv(storedRead.get<GetResultList>());
+  return merge(changed.asPtr(), kj::mv(stored), limit, true);
+}
+
+ActorCacheOps::GetResultList ActorSqlite::Transaction::merge(
+    kj::ArrayPtr<const Change*> changed, GetResultList stored,
+    kj::Maybe<uint> limit, bool reverse) {
+  auto inOrder = [&](KeyPtr a, KeyPtr b) { return reverse ? b < a : a < b; };
+  uint max = limit.orDefault(kj::maxValue);
+
+  kj::Vector<KeyValuePair> results;
+  auto storedIter = stored.begin();
+  auto changeIter = changed.begin();
+  while (results.size() < max) {
+    kj::Maybe<KeyPtr> storedKey;
+    if (storedIter != stored.end()) storedKey = (*storedIter).key;
+
+    if (changeIter != changed.end()) {
+      auto& change = **changeIter;
+      KJ_IF_MAYBE(k, storedKey) {
+        if (inOrder(*k, change.key)) {
+          auto row = *storedIter++;
+          results.add(KeyValuePair { kj::str(row.key), kj::heapArray(row.value) });
+          continue;
+        } else if (*k == change.key) {
+          // Overwritten or deleted by the transaction.
+          ++storedIter;
+        }
+      }
+      ++changeIter;
+      KJ_IF_MAYBE(value, change.value) {
+        results.add(KeyValuePair { kj::str(change.key), kj::heapArray<byte>(*value) });
+      }
+    } else if (storedKey != nullptr) {
+      auto row = *storedIter++;
+      results.add(KeyValuePair { kj::str(row.key), kj::heapArray(row.value) });
+    } else {
+      break;
+    }
+  }
+
+  return GetResultList(kj::mv(results));
+}
+
+kj::Maybe<kj::Promise<void>> ActorSqlite::Transaction::put(
+    Key key, Value value, WriteOptions options) {
+  requireOpen("put()");
+  putChange(kj::mv(key), kj::mv(value), options);
+  return nullptr;
+}
+
+kj::Maybe<kj::Promise<void>> ActorSqlite::Transaction::put(
+    kj::Array<KeyValuePair> pairs, WriteOptions options) {
+  requireOpen("put()");
+  for (auto& pair: pairs) {
+    putChange(kj::mv(pair.key), kj::mv(pair.value), options);
+  }
+  return nullptr;
+}
+
+kj::OneOf<bool, kj::Promise<bool>> ActorSqlite::Transaction::delete_(
+    Key key, WriteOptions options) {
+  requireOpen("delete()");
+  bool existed;
+  KJ_IF_MAYBE(change, changes.find(key)) {
+    existed = change->value != nullptr;
+  } else {
+    existed = existsInParent(key);
+  }
+  putChange(kj::mv(key), nullptr, options);
+  return existed;
+}
+
+kj::OneOf<uint, kj::Promise<uint>> ActorSqlite::Transaction::delete_(
+    kj::Array<Key> keys, WriteOptions options) {
+  requireOpen("delete()");
+  uint count = 0;
+  for (auto& key: keys) {
+    KJ_IF_MAYBE(change, changes.find(key)) {
+      if (change->value != nullptr) ++count;
+    } else {
+      if (existsInParent(key)) ++count;
+    }
+    putChange(kj::mv(key), nullptr, options);
+  }
+  return count;
+}
+
+kj::Maybe<kj::Promise<void>> ActorSqlite::Transaction::setAlarm(
+    kj::Maybe<kj::Date> newAlarmTime, WriteOptions options) {
+  requireOpen("setAlarm()");
+  return parent.setAlarm(newAlarmTime, options);
+}
+
+kj::Maybe<kj::Promise<void>> ActorSqlite::Transaction::commit() {
+  requireOpen("commit()");
+  done = true;
+  if (changes.size() == 0) return nullptr;
+
+  // The commit is confirmed through the output gate unless every write in the transaction opted
+  // out of that.
+  WriteOptions options { .allowUnconfirmed = true };
+  for (auto& change: changes) {
+    options.allowUnconfirmed = options.allowUnconfirmed && change.options.allowUnconfirmed;
+  }
+  parent.onWrite(options);
+
+  // Apply the writes in a savepoint within the implicit transaction, so that if one of them fails,
+  // none of them take effect.
+  parent.db.run("SAVEPOINT _cf_transaction");
+  KJ_ON_SCOPE_FAILURE({
+    parent.db.run("ROLLBACK TO _cf_transaction; RELEASE _cf_transaction");
+  });
+  for (auto& change: changes) {
+    KJ_IF_MAYBE(value, change.value) {
+      parent.kv.put(change.key, *value);
+    } else {
+      parent.kv.delete_(change.key);
+    }
+  }
+  parent.db.run("RELEASE _cf_transaction");
+
+  changes.clear();
+  return nullptr;
+}
+
+kj::Promise<void> ActorSqlite::Transaction::rollback() {
+  done = true;
+  changes.clear();
+  return kj::READY_NOW;
+}
+
 }  // namespace workerd
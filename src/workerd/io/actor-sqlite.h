@@ -12,16 +12,19 @@ namespace workerd {
 class ActorSqlite final: public ActorCacheInterface {
   // An implementation of ActorCacheOps that is backed by SqliteKv.
   //
-  // TODO(perf): This interface is not designed ideally for wrapping SqliteKv. In particular, we
-  //   end up allocating extra copies of all the results. It would be nicer if we could actually
-  //   parse the V8-serialized values directly from the blob pointers that SQLite spits out.
-  //   However, that probably requires rewriting `DurableObjectStorageOperations`. For now, hooking
-  //   here is easier and not too costly.
+  // The ActorCacheOps interface allocates a copy of every result. ActorSqlite also implements the
+  // direct-read methods of ActorCacheInterface, which pass callers the blob pointers that SQLite
+  // returns, so that `DurableObjectStorage` can deserialize values without the extra copy.
+  //
+  // Writes are not committed individually. The first write in a turn opens an implicit
+  // transaction, which is committed in a later turn of the event loop, with the output gate held
+  // until then. So, all writes made while the gate is held share a single commit (and a single
+  // journal sync), much like ActorCache batches writes into one flush.
 
 public:
-  ActorSqlite(SqliteDatabase::Vfs& vfs, kj::PathPtr path)
+  ActorSqlite(SqliteDatabase::Vfs& vfs, kj::PathPtr path, OutputGate& outputGate)
       : db(vfs, path, kj::WriteMode::CREATE | kj::WriteMode::MODIFY | kj::WriteMode::CREATE_PARENT),
-        kv(db) {}
+        kv(db), outputGate(outputGate) {}
 
   SqliteDatabase& getSqliteDatabase() { return db; }
 
@@ -49,11 +52,112 @@ public:
   kj::Maybe<kj::Own<void>> armAlarmHandler(kj::Date scheduledTime, bool noCache = false) override;
   void cancelDeferredAlarmDeletion() override;
   kj::Maybe<kj::Promise<void>> onNoPendingFlush() override;
+  kj::Maybe<bool> getDirect(KeyPtr key, ReadOptions options,
+      kj::FunctionParam<void(ValuePtr value)> callback) override;
+  kj::Maybe<uint> getDirect(kj::ArrayPtr<const Key> keys, ReadOptions options,
+      kj::FunctionParam<void(KeyPtr key, ValuePtr value)> callback) override;
+  kj::Maybe<uint> listDirect(KeyPtr begin, kj::Maybe<KeyPtr> end, kj::Maybe<uint> limit,
+      ReadOptions options, kj::FunctionParam<void(KeyPtr key, ValuePtr value)> callback) override;
+  kj::Maybe<uint> listReverseDirect(KeyPtr begin, kj::Maybe<KeyPtr> end, kj::Maybe<uint> limit,
+      ReadOptions options, kj::FunctionParam<void(KeyPtr key, ValuePtr value)> callback) override;
   // See ActorCacheInterface
 
+  class Transaction;
+
 private:
   SqliteDatabase db;
   SqliteKv kv;
+  OutputGate& outputGate;
+
+  SqliteDatabase::Statement beginTxn = db.prepare("BEGIN TRANSACTION");
+  SqliteDatabase::Statement commitTxn = db.prepare("COMMIT TRANSACTION");
+  SqliteDatabase::Statement rollbackTxn = db.prepare("ROLLBACK TRANSACTION");
+
+  bool commitScheduled = false;
+  // True if the implicit transaction is open, i.e. there are uncommitted writes.
+
+  bool commitScheduledWithOutputGate = false;
+  // When commitScheduled is true, indicates whether the output gate is waiting on the commit.
+  // This is false only if all writes so far in the transaction set `allowUnconfirmed`.
+
+  kj::ForkedPromise<void> lastCommit = kj::Promise<void>(kj::READY_NOW).fork();
+  // Resolves when the most recently scheduled commit has completed.
+
+  void onWrite(const WriteOptions& options);
+  // Called before each write. Opens the implicit transaction and schedules its commit, if this
+  // hasn't been done already.
+
+  void commitImplicitTransaction();
+  // Commits the implicit transaction. If that fails, rolls it back, if SQLite hasn't already, so
+  // that the next write can open a new one, then rethrows.
+};
+
+class ActorSqlite::Transaction final: public ActorCacheInterface::Transaction {
+  // A transaction's writes are buffered in memory, and reads through the transaction see them
+  // merged over the database. commit() applies them all at once, within a savepoint so that they
+  // land together or not at all. Until then the transaction touches neither the database nor the
+  // output gate, so it doesn't hold up anything else the actor does -- such as a fetch() made
+  // inside the transaction, which has to wait for the output gate.
+  //
+  // Like ActorCache::Transaction, this doesn't detect conflicts with concurrent transactions.
+
+public:
+  Transaction(ActorSqlite& parent): parent(parent) {}
+
+  kj::OneOf<kj::Maybe<Value>, kj::Promise<kj::Maybe<Value>>> get(
+      Key key, ReadOptions options) override;
+  kj::OneOf<GetResultList, kj::Promise<GetResultList>> get(
+      kj::Array<Key> keys, ReadOptions options) override;
+  kj::OneOf<kj::Maybe<kj::Date>, kj::Promise<kj::Maybe<kj::Date>>> getAlarm(
+      ReadOptions options) override;
+  kj::OneOf<GetResultList, kj::Promise<GetResultList>> list(
+      Key begin, kj::Maybe<Key> end, kj::Maybe<uint> limit, ReadOptions options) override;
+  kj::OneOf<GetResultList, kj::Promise<GetResultList>> listReverse(
+      Key begin, kj::Maybe<Key> end, kj::Maybe<uint> limit, ReadOptions options) override;
+  kj::Maybe<kj::Promise<void>> put(Key key, Value value, WriteOptions options) override;
+  kj::Maybe<kj::Promise<void>> put(kj::Array<KeyValuePair> pairs, WriteOptions options) override;
+  kj::OneOf<bool, kj::Promise<bool>> delete_(Key key, WriteOptions options) override;
+  kj::OneOf<uint, kj::Promise<uint>> delete_(kj::Array<Key> keys, WriteOptions options) override;
+  kj::Maybe<kj::Promise<void>> setAlarm(kj::Maybe<kj::Date> newAlarmTime, WriteOptions options) override;
+  // Same interface as ActorSqlite.
+
+  kj::Maybe<kj::Promise<void>> commit() override;
+  kj::Promise<void> rollback() override;
+  // Implements ActorCacheInterface::Transaction.
+
+private:
+  ActorSqlite& parent;
+  bool done = false;
+
+  struct Change {
+    Key key;
+    kj::Maybe<Value> value;
+    // Null for a delete.
+
+    WriteOptions options;
+  };
+
+  class ChangeTableCallbacks {
+    // Callbacks for a kj::TreeIndex for a kj::Table<Change>.
+  public:
+    inline KeyPtr keyForRow(const Change& row) const { return row.key; }
+
+    inline bool isBefore(const Change& row, KeyPtr key) const { return row.key < key; }
+    inline bool matches(const Change& row, KeyPtr key) const { return row.key == key; }
+  };
+
+  kj::Table<Change, kj::TreeIndex<ChangeTableCallbacks>> changes;
+
+  void requireOpen(kj::StringPtr op);
+
+  bool existsInParent(KeyPtr key);
+
+  void putChange(Key key, kj::Maybe<Value> value, const WriteOptions& options);
+
+  GetResultList merge(kj::ArrayPtr<const Change*> changed, GetResultList stored,
+                      kj::Maybe<uint> limit, bool reverse);
+  // Merges the changes affecting a read, given in the order of the read, into the results of the
+  // same read from the database. Changes replace stored values, and deletes remove them.
 };
 
 }  // namespace workerd
@@ -299,6 +299,14 @@ InputGate::Lock IoContext::getInputLock() {
       "no input lock available in this context").addRef();
 }
 
+bool IoContext::isInputGateContended() {
+  KJ_IF_MAYBE(l, currentInputLock) {
+    return l->isContended();
+  } else {
+    return false;
+  }
+}
+
 kj::Maybe<kj::Own<InputGate::CriticalSection>> IoContext::getCriticalSection() {
   KJ_IF_MAYBE(l, currentInputLock) {
     return l->getCriticalSection()
@@ -1140,6 +1148,9 @@ void IoContext::runImpl(Runnable& runnable, bool takePendingEvent,
   }
 
   auto limiterScope = limitEnforcer->enterJs(workerLock);
+  auto prevLimiterScope = currentLimiterScope;
+  currentLimiterScope = limiterScope;
+  KJ_DEFER(currentLimiterScope = prevLimiterScope);
 
   bool gotTermination = false;
 
@@ -1203,6 +1214,13 @@ void IoContext::runImpl(Runnable& runnable, bool takePendingEvent,
   }
 }
 
+void IoContext::topUpActorBetweenEvents() {
+  auto& limiterScope = KJ_REQUIRE_NONNULL(currentLimiterScope, "not inside IoContext::run()");
+  limiterScope = nullptr;
+  limitEnforcer->topUpActor();
+  limiterScope = limitEnforcer->enterJs(getCurrentLock());
+}
+
 IoContext& IoContext::current() {
   if (threadLocalRequest == nullptr) {
     v8::Isolate* isolate = v8::Isolate::TryGetCurrent();
@@ -321,10 +321,21 @@ public:
 
   LimitEnforcer& getLimitEnforcer() { return *limitEnforcer; }
 
+  void topUpActorBetweenEvents();
+  // Calls `LimitEnforcer::topUpActor()` from inside run(), for callers that deliver several events
+  // in one run() and want each to get the limits it would have had if delivered on its own. The
+  // JS scope entered by run() is exited around the top-up, so this must be called directly from
+  // the run() callback, between events, with no JavaScript on the stack.
+
   InputGate::Lock getInputLock();
   // Get the current input lock. Throws an exception if no input lock is held (e.g. because this is
   // not an actor request).
 
+  bool isInputGateContended();
+  // True if an input lock is held and something else holds or is waiting for the input gate, e.g.
+  // a storage operation or blockConcurrencyWhile() started by an event delivered in this run(). An
+  // event arriving now would not be delivered until that's done.
+
   kj::Maybe<kj::Own<InputGate::CriticalSection>> getCriticalSection();
   // Get the current CriticalSection, if there is one, or returns null if not.
 
@@ -851,6 +862,9 @@ private:
   kj::Maybe<Worker::Actor&> actor;
   kj::Own<LimitEnforcer> limitEnforcer;
 
+  kj::Maybe<kj::Own<void>&> currentLimiterScope;
+  // The `LimitEnforcer::enterJs()` scope held by the innermost runImpl() on the stack, if any.
+
   kj::List<IncomingRequest, &IncomingRequest::link> incomingRequests;
   // List of active IncomingRequests, ordered from most-recently-started to least-recently-started.
 
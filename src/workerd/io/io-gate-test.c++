@@ -41,6 +41,37 @@ KJ_TEST("InputGate basics") {
   KJ_EXPECT(!gate.onBroken().poll(ws));
 }
 
+KJ_TEST("InputGate lock contention") {
+  kj::EventLoop loop;
+  kj::WaitScope ws(loop);
+
+  InputGate gate;
+
+  auto lock = gate.wait().wait(ws);
+  KJ_EXPECT(!lock.isContended());
+
+  {
+    auto lock2 = lock.addRef();
+    KJ_EXPECT(lock.isContended());
+  }
+  KJ_EXPECT(!lock.isContended());
+
+  {
+    auto waiter = gate.wait();
+    KJ_EXPECT(!waiter.poll(ws));
+    KJ_EXPECT(lock.isContended());
+  }
+  KJ_EXPECT(!lock.isContended());
+
+  {
+    auto cs = lock.startCriticalSection();
+    KJ_EXPECT(!lock.isContended());
+    auto csLock = cs->wait();
+    KJ_EXPECT(!csLock.poll(ws));
+    KJ_EXPECT(lock.isContended());
+  }
+}
+
 KJ_TEST("InputGate critical section") {
   kj::EventLoop loop;
   kj::WaitScope ws(loop);
@@ -366,15 +397,18 @@ KJ_TEST("OutputGate basics") {
   OutputGate gate;
 
   KJ_EXPECT(gate.wait().poll(ws));
+  KJ_EXPECT(gate.getLockCount() == 0);
 
   auto paf1 = kj::newPromiseAndFulfiller<void>();
   auto blocker1 = gate.lockWhile(kj::mv(paf1.promise));
+  KJ_EXPECT(gate.getLockCount() == 1);
 
   auto promise1 = gate.wait();
   auto promise2 = gate.wait();
 
   auto paf2 = kj::newPromiseAndFulfiller<void>();
   auto blocker2 = gate.lockWhile(kj::mv(paf2.promise));
+  KJ_EXPECT(gate.getLockCount() == 2);
 
   auto promise3 = gate.wait();
 
@@ -411,15 +445,18 @@ KJ_TEST("OutputGate out-of-order") {
   OutputGate gate;
 
   KJ_EXPECT(gate.wait().poll(ws));
+  KJ_EXPECT(gate.getLockCount() == 0);
 
   auto paf1 = kj::newPromiseAndFulfiller<void>();
   auto blocker1 = gate.lockWhile(kj::mv(paf1.promise));
+  KJ_EXPECT(gate.getLockCount() == 1);
 
   auto promise1 = gate.wait();
   auto promise2 = gate.wait();
 
   auto paf2 = kj::newPromiseAndFulfiller<void>();
   auto blocker2 = gate.lockWhile(kj::mv(paf2.promise));
+  KJ_EXPECT(gate.getLockCount() == 2);
 
   auto promise3 = gate.wait();
 
@@ -463,15 +500,18 @@ KJ_TEST("OutputGate exception") {
   auto onBroken = gate.onBroken();
 
   KJ_EXPECT(gate.wait().poll(ws));
+  KJ_EXPECT(gate.getLockCount() == 0);
 
   auto paf1 = kj::newPromiseAndFulfiller<void>();
   auto blocker1 = gate.lockWhile(kj::mv(paf1.promise));
+  KJ_EXPECT(gate.getLockCount() == 1);
 
   auto promise1 = gate.wait();
   auto promise2 = gate.wait();
 
   auto paf2 = kj::newPromiseAndFulfiller<void>();
   auto blocker2 = gate.lockWhile(kj::mv(paf2.promise));
+  KJ_EXPECT(gate.getLockCount() == 2);
 
   auto promise3 = gate.wait();
 
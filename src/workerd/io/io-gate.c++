@@ -136,6 +136,10 @@ bool InputGate::Lock::isFor(const InputGate& otherGate) const {
   return ptr == &otherGate;
 }
 
+bool InputGate::Lock::isContended() const {
+  return gate->lockCount > 1 || !gate->waiters.empty() || !gate->waitingChildren.empty();
+}
+
 InputGate::CriticalSection::CriticalSection(InputGate& parent) {
   isCriticalSection = true;
   if (parent.isCriticalSection) {
@@ -309,6 +313,7 @@ kj::Own<kj::PromiseFulfiller<void>> OutputGate::lock() {
   auto paf = kj::newPromiseAndFulfiller<void>();
   auto joined = kj::joinPromises(kj::arr(pastLocksPromise.addBranch(), kj::mv(paf.promise)));
   pastLocksPromise = joined.fork();
+  ++lockCount;
   return kj::mv(paf.fulfiller);
 }
 
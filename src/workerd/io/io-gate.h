@@ -86,6 +86,11 @@ public:
 
     bool isFor(const InputGate& gate) const;
 
+    bool isContended() const;
+    // True if anything other than this Lock holds the gate or is waiting for it -- including
+    // duplicates made with addRef() and critical sections started from it -- so that a new
+    // `InputGate::wait()` would not complete until they're done.
+
     inline bool operator==(const Lock& other) const { return gate == other.gate; }
 
   private:
@@ -263,10 +268,16 @@ public:
 
   bool isBroken();
 
+  uint64_t getLockCount() { return lockCount; }
+  // Number of locks taken so far. Calls to `wait()` made while this doesn't change all resolve
+  // together, so something that sends messages strictly in order only needs to wait before the
+  // first of them.
+
 private:
   Hooks& hooks;
 
   kj::ForkedPromise<void> pastLocksPromise;
+  uint64_t lockCount = 0;
 
   kj::OneOf<kj::Own<kj::PromiseFulfiller<void>>, kj::Exception> brokenState;
   // A fulfiller for onBroken(), or an exception if already broken.
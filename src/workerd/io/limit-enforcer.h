@@ -6,6 +6,7 @@
 
 #include <workerd/jsg/jsg.h>
 #include <workerd/io/observer.h>
+#include <kj/filesystem.h>
 
 namespace workerd {
 
@@ -72,9 +73,10 @@ public:
   // Called on each new event delivered that should cause an actor's resource limits to be
   // "topped up". This method does nothing if the IoContext is not an actor. Note that this must
   // not be called while in a JS scope, i.e. when `enterJs()` has been called and the returned
-  // object not yet dropped.
+  // object not yet dropped. Callers delivering several events in one `IoContext::run()` use
+  // `IoContext::topUpActorBetweenEvents()`, which drops the JS scope around this call.
   //
-  // TODO(cleanup): This is called in WebSocket when receiving a message, but should we do
+  // TODO(cleanup): This is called in WebSocket when receiving each message, but should we do
   //   something more generic like use a membrane to detect any incoming RPC call?
 
   virtual void newSubrequest(bool isInHouse) = 0;
@@ -109,6 +111,15 @@ public:
   // Gets a byte size limit to apply to operations that will buffer a possibly large amount of
   // data in C++ memory, such as reading an entire HTTP response into an `ArrayBuffer`.
 
+  virtual kj::Maybe<const kj::Directory&> getSpillDirectory() = 0;
+  // Gets a directory in which operations that would otherwise have to buffer an unbounded amount
+  // of data in memory -- currently, `ReadableStream.tee()` when one branch falls behind the
+  // other -- may create anonymous temporary files to hold the excess. Null if spilling to disk is
+  // not enabled.
+
+  virtual size_t getSpillThreshold() = 0;
+  // How much such an operation may buffer in memory before spilling to getSpillDirectory().
+
   virtual kj::Maybe<EventOutcome> getLimitsExceeded() = 0;
   // If a limit has been exceeded which prevents further JavaScript execution, such as the CPU or
   // memory limit, returns a request status code indicating which one. Returns null if no limits
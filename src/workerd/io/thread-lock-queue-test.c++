@@ -0,0 +1,158 @@
+// Copyright (c) 2017-2022 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#include "thread-lock-queue.h"
+#include <kj/test.h>
+
+namespace workerd {
+namespace {
+
+int keyA, keyB, keyC, keyD;
+
+KJ_TEST("ThreadLockQueue grants attempts in order, coalescing same-key attempts") {
+  kj::EventLoop loop;
+  kj::WaitScope ws(loop);
+
+  ThreadLockQueue queue;
+  KJ_EXPECT(!queue.isBusy());
+
+  queue.acquire();
+  auto promiseA1 = queue.wait(&keyA);
+  auto promiseB = queue.wait(&keyB);
+  auto promiseA2 = queue.wait(&keyA);
+  auto promiseC = queue.wait(&keyC);
+
+  KJ_EXPECT(!promiseA1.poll(ws));
+  KJ_EXPECT(!promiseB.poll(ws));
+  KJ_EXPECT(!promiseA2.poll(ws));
+  KJ_EXPECT(!promiseC.poll(ws));
+
+  // Releasing wakes the oldest attempt along with the other attempt for the same key, but not the
+  // ones queued in between.
+  queue.release();
+  KJ_ASSERT(promiseA1.poll(ws));
+  KJ_ASSERT(promiseA2.poll(ws));
+  KJ_EXPECT(!promiseB.poll(ws));
+  KJ_EXPECT(!promiseC.poll(ws));
+
+  {
+    auto grantA1 = promiseA1.wait(ws);
+    auto grantA2 = promiseA2.wait(ws);
+    queue.acquire();
+  }
+
+  // A new attempt for the held key queues behind the others.
+  auto promiseA3 = queue.wait(&keyA);
+  KJ_EXPECT(!promiseB.poll(ws));
+
+  queue.release();
+  KJ_ASSERT(promiseB.poll(ws));
+  KJ_EXPECT(!promiseC.poll(ws));
+  KJ_EXPECT(!promiseA3.poll(ws));
+
+  {
+    auto grantB = promiseB.wait(ws);
+    queue.acquire();
+  }
+  queue.release();
+  KJ_ASSERT(promiseC.poll(ws));
+  KJ_EXPECT(!promiseA3.poll(ws));
+
+  {
+    auto grantC = promiseC.wait(ws);
+    queue.acquire();
+  }
+  queue.release();
+  KJ_ASSERT(promiseA3.poll(ws));
+
+  {
+    auto grantA3 = promiseA3.wait(ws);
+    queue.acquire();
+  }
+  queue.release();
+  KJ_EXPECT(!queue.isBusy());
+}
+
+KJ_TEST("ThreadLockQueue keeps the thread spoken for until the grant is dropped") {
+  kj::EventLoop loop;
+  kj::WaitScope ws(loop);
+
+  ThreadLockQueue queue;
+
+  queue.acquire();
+  auto promiseA = queue.wait(&keyA);
+  queue.release();
+
+  // The thread is neither held nor has anything queued, but attempt A has been granted it, so it's
+  // still busy and new attempts can't jump ahead.
+  KJ_ASSERT(promiseA.poll(ws));
+  KJ_EXPECT(queue.isBusy());
+  KJ_EXPECT(!queue.hasQueuedAttempts());
+
+  auto promiseB = queue.wait(&keyB);
+  auto grantA = promiseA.wait(ws);
+  KJ_EXPECT(!promiseB.poll(ws));
+
+  queue.acquire();
+  { auto drop = kj::mv(grantA); }
+  KJ_EXPECT(!promiseB.poll(ws));
+
+  queue.release();
+  KJ_EXPECT(promiseB.poll(ws));
+}
+
+KJ_TEST("ThreadLockQueue canceling a granted attempt passes its turn on") {
+  kj::EventLoop loop;
+  kj::WaitScope ws(loop);
+
+  ThreadLockQueue queue;
+
+  // Cancel an attempt after it's been woken, before it has run.
+  queue.acquire();
+  auto promiseA = queue.wait(&keyA);
+  auto promiseB = queue.wait(&keyB);
+  auto promiseC = queue.wait(&keyC);
+  auto promiseD = queue.wait(&keyD);
+  queue.release();
+  { auto drop = kj::mv(promiseA); }
+  KJ_ASSERT(promiseB.poll(ws));
+  KJ_EXPECT(!promiseC.poll(ws));
+
+  // Cancel an attempt that has received its grant, before its caller has taken it.
+  { auto drop = kj::mv(promiseB); }
+  KJ_ASSERT(promiseC.poll(ws));
+  KJ_EXPECT(!promiseD.poll(ws));
+
+  // Drop a grant without ever acquiring the thread.
+  { auto grantC = promiseC.wait(ws); }
+  KJ_ASSERT(promiseD.poll(ws));
+
+  // Once everything is gone, idle waiters are told.
+  auto idle = queue.onIdle();
+  KJ_EXPECT(!idle.poll(ws));
+  { auto grantD = promiseD.wait(ws); }
+  KJ_EXPECT(idle.poll(ws));
+  KJ_EXPECT(!queue.isBusy());
+}
+
+KJ_TEST("ThreadLockQueue canceling a queued attempt") {
+  kj::EventLoop loop;
+  kj::WaitScope ws(loop);
+
+  ThreadLockQueue queue;
+
+  queue.acquire();
+  auto promiseA = queue.wait(&keyA);
+  auto promiseB = queue.wait(&keyB);
+  { auto drop = kj::mv(promiseA); }
+  KJ_EXPECT(queue.hasQueuedAttempts());
+
+  queue.release();
+  KJ_ASSERT(promiseB.poll(ws));
+  { auto grantB = promiseB.wait(ws); }
+  KJ_EXPECT(!queue.isBusy());
+}
+
+}  // namespace
+}  // namespace workerd
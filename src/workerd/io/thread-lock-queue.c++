@@ -0,0 +1,79 @@
+// Copyright (c) 2017-2022 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#include "thread-lock-queue.h"
+#include <kj/debug.h>
+
+namespace workerd {
+
+ThreadLockQueue::Grant::~Grant() noexcept(false) {
+  KJ_IF_MAYBE(q, queue) {
+    --q->grantedCount;
+    q->grantNext();
+  }
+}
+
+kj::Promise<ThreadLockQueue::Grant> ThreadLockQueue::wait(const void* key) {
+  auto paf = kj::newPromiseAndFulfiller<void>();
+  Attempt attempt { key, kj::mv(paf.fulfiller) };
+  attempts.add(attempt);
+  KJ_DEFER({
+    if (attempt.link.isLinked()) {
+      attempts.remove(attempt);
+    } else if (attempt.granted) {
+      // We were canceled after being woken but before we could take our Grant. Pass our turn on.
+      --grantedCount;
+      grantNext();
+    }
+  });
+
+  co_await paf.promise;
+
+  // From here on the Grant accounts for our turn, including if the caller is canceled before it
+  // gets to run.
+  attempt.granted = false;
+  co_return Grant(*this);
+}
+
+void ThreadLockQueue::acquire() {
+  KJ_REQUIRE(!held, "thread is already held");
+  held = true;
+}
+
+void ThreadLockQueue::release() {
+  KJ_REQUIRE(held, "thread isn't held");
+  held = false;
+  grantNext();
+}
+
+kj::Promise<void> ThreadLockQueue::onIdle() {
+  KJ_REQUIRE(isBusy());
+  auto paf = kj::newPromiseAndFulfiller<void>();
+  idleFulfillers.add(kj::mv(paf.fulfiller));
+  return kj::mv(paf.promise);
+}
+
+void ThreadLockQueue::grantNext() {
+  if (held || grantedCount > 0) return;
+
+  if (attempts.empty()) {
+    for (auto& fulfiller: idleFulfillers) {
+      fulfiller->fulfill();
+    }
+    idleFulfillers.clear();
+    return;
+  }
+
+  const void* key = attempts.front().key;
+  for (auto& attempt: attempts) {
+    if (attempt.key == key) {
+      attempts.remove(attempt);
+      attempt.granted = true;
+      ++grantedCount;
+      attempt.fulfiller->fulfill();
+    }
+  }
+}
+
+} // namespace workerd
@@ -0,0 +1,86 @@
+// Copyright (c) 2017-2022 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#pragma once
+
+#include <kj/async.h>
+#include <kj/list.h>
+#include <kj/vector.h>
+
+namespace workerd {
+
+class ThreadLockQueue {
+  // Orders the lock attempts made on one thread, which may only hold (or wait for) one isolate
+  // lock at a time. Attempts are keyed by the lock they are for; the queue doesn't care what that
+  // is. `Worker::AsyncWaiter` keeps one of these per thread.
+  //
+  // Attempts are granted the thread in arrival order. When the thread is released, only the
+  // oldest attempt is woken, together with any others queued for the same key, since those can
+  // all share one lock. While anything is queued, new attempts for the key currently held should
+  // queue up too rather than joining the lock already held, so a busy lock can't keep the thread
+  // to itself: an attempt waits for at most one lock per key queued ahead of it.
+  //
+  // This class is not thread-safe; it is only ever used from the thread that owns it.
+
+public:
+  class Grant {
+    // It's an attempt's turn to take the thread. As long as a Grant exists the thread stays
+    // spoken for, so the attempt must either `acquire()` the thread before dropping its Grant, or
+    // drop it to pass its turn on (which is what happens if the attempt is canceled).
+
+  public:
+    Grant(Grant&& other): queue(other.queue) { other.queue = nullptr; }
+    ~Grant() noexcept(false);
+    KJ_DISALLOW_COPY(Grant);
+
+  private:
+    kj::Maybe<ThreadLockQueue&> queue;
+
+    explicit Grant(ThreadLockQueue& queue): queue(queue) {}
+    friend class ThreadLockQueue;
+  };
+
+  bool isBusy() const { return held || !attempts.empty() || grantedCount > 0; }
+  // True if the thread is held, or an attempt is queued or has been granted it.
+
+  bool hasQueuedAttempts() const { return !attempts.empty(); }
+
+  kj::Promise<Grant> wait(const void* key);
+  // Queues an attempt for the lock identified by `key` and resolves when it's the attempt's turn.
+  // Canceling the returned promise at any point, including after it has resolved but before the
+  // caller has resumed, gives up the attempt's place.
+
+  void acquire();
+  // Marks the thread as held. Call this before dropping the `Grant` that allowed it, or, when the
+  // thread wasn't busy, instead of waiting at all.
+
+  void release();
+  // Marks the thread as no longer held and wakes the next attempt.
+
+  kj::Promise<void> onIdle();
+  // Resolves the next time the thread becomes idle. Only call this when `isBusy()`.
+
+private:
+  struct Attempt {
+    const void* key;
+    kj::Own<kj::PromiseFulfiller<void>> fulfiller;
+    bool granted = false;
+    kj::ListLink<Attempt> link;
+  };
+
+  kj::List<Attempt, &Attempt::link> attempts;
+
+  bool held = false;
+
+  uint grantedCount = 0;
+  // Grants that exist. Until each has been dropped, the thread is spoken for even though it may
+  // not be held.
+
+  kj::Vector<kj::Own<kj::PromiseFulfiller<void>>> idleFulfillers;
+
+  void grantNext();
+  // Called whenever the thread may have been freed up.
+};
+
+} // namespace workerd
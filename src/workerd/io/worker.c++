@@ -20,6 +20,7 @@
 #include <kj/compat/gzip.h>
 #include <kj/encoding.h>
 #include <kj/filesystem.h>
+#include <kj/list.h>
 #include <kj/map.h>
 #include <v8-inspector.h>
 #include <v8-profiler.h>
@@ -1756,6 +1757,8 @@ void Worker::Lock::validateHandlers(ValidationErrorReporter& errorReporter) {
 
 thread_local Worker::AsyncWaiter* Worker::AsyncWaiter::threadCurrentWaiter = nullptr;
 
+thread_local ThreadLockQueue Worker::AsyncWaiter::threadQueue;
+
 Worker::Isolate::AsyncWaiterList::~AsyncWaiterList() noexcept {
   // It should be impossible for this list to be non-empty since each member of the list holds a
   // strong reference back to us. But if the list is non-empty, we'd better crash here, to avoid
@@ -1783,10 +1786,15 @@ kj::Promise<Worker::AsyncLock> Worker::Isolate::takeAsyncLockImpl(
     currentLoad = getCurrentLoad();
   }
 
+  auto& queue = AsyncWaiter::threadQueue;
+  kj::Maybe<ThreadLockQueue::Grant> grant;
+  // Set once our attempt has been through `queue` and it's our turn. We hold on to it until we
+  // have a waiter, so that the thread stays spoken for even if we're canceled in between.
+
   for (uint threadWaitingDifferentLockCount = 0; ; ++threadWaitingDifferentLockCount) {
     AsyncWaiter* waiter = AsyncWaiter::threadCurrentWaiter;
 
-    if (waiter == nullptr) {
+    if (waiter == nullptr && (grant != nullptr || !queue.isBusy())) {
       // Thread is not currently waiting on a lock.
       KJ_IF_MAYBE(lt, lockTiming) {
         lt->get()->reportAsyncInfo(
@@ -1794,9 +1802,11 @@ kj::Promise<Worker::AsyncLock> Worker::Isolate::takeAsyncLockImpl(
             threadWaitingDifferentLockCount);
       }
       auto newWaiter = kj::refcounted<AsyncWaiter>(kj::atomicAddRef(*this));
+      grant = nullptr;
       co_await newWaiter->readyPromise.addBranch();
       co_return AsyncLock(kj::mv(newWaiter), kj::mv(lockTiming));
-    } else if (waiter->isolate == this) {
+    } else if (waiter != nullptr && waiter->isolate == this &&
+               (grant != nullptr || !queue.hasQueuedAttempts())) {
       // Thread is waiting on a lock already, and it's for the same isolate. We can coalesce the
       // locks.
       KJ_IF_MAYBE(lt, lockTiming) {
@@ -1805,17 +1815,19 @@ kj::Promise<Worker::AsyncLock> Worker::Isolate::takeAsyncLockImpl(
             threadWaitingDifferentLockCount);
       }
       auto newWaiterRef = kj::addRef(*waiter);
+      grant = nullptr;
       co_await newWaiterRef->readyPromise.addBranch();
       co_return AsyncLock(kj::mv(newWaiterRef), kj::mv(lockTiming));
     } else {
-      // Thread is already waiting for or holding a different isolate lock. Wait for that one to
-      // be released before we try to lock a different isolate.
-      // TODO(perf): Use of ForkedPromise leads to thundering herd here. Should be minor in practice,
-      //   but we could consider creating another linked list instead...
-      KJ_IF_MAYBE(lt, lockTiming) {
-        lt->get()->waitingForOtherIsolate(waiter->isolate->getId());
+      // Thread is already waiting for or holding a different isolate lock, or other attempts are
+      // already queued for it. Wait our turn before we try to lock this isolate.
+      if (waiter != nullptr && waiter->isolate != this) {
+        KJ_IF_MAYBE(lt, lockTiming) {
+          lt->get()->waitingForOtherIsolate(waiter->isolate->getId());
+        }
       }
-      co_await waiter->releasePromise.addBranch();
+      grant = nullptr;
+      grant = co_await queue.wait(this);
     }
   }
 }
@@ -1831,13 +1843,6 @@ kj::Promise<Worker::AsyncLock> Worker::takeAsyncLock(RequestObserver& request) c
 Worker::AsyncWaiter::AsyncWaiter(kj::Own<const Isolate> isolateParam)
     : executor(kj::getCurrentThreadExecutor()),
       isolate(kj::mv(isolateParam)) {
-  // Init `releasePromise` / `releaseFulfiller`.
-  {
-    auto paf = kj::newPromiseAndFulfiller<void>();
-    releasePromise = paf.promise.fork();
-    releaseFulfiller = kj::mv(paf.fulfiller);
-  }
-
   // Add ourselves to the wait queue for this isolate.
   auto lock = isolate->asyncWaiters.lockExclusive();
   if (lock->tail == &lock->head) {
@@ -1857,6 +1862,7 @@ Worker::AsyncWaiter::AsyncWaiter(kj::Own<const Isolate> isolateParam)
   lock->tail = &next;
 
   threadCurrentWaiter = this;
+  threadQueue.acquire();
 
   __atomic_add_fetch(&isolate->impl->lockAttemptGauge, 1, __ATOMIC_RELAXED);
 }
@@ -1867,38 +1873,41 @@ Worker::AsyncWaiter::~AsyncWaiter() noexcept {
 
   __atomic_sub_fetch(&isolate->impl->lockAttemptGauge, 1, __ATOMIC_RELAXED);
 
-  auto lock = isolate->asyncWaiters.lockExclusive();
-
-  releaseFulfiller->fulfill();
-
-  // Remove ourselves from the list.
-  *prev = next;
-  KJ_IF_MAYBE(n, next) {
-    n->prev = prev;
-  } else {
-    lock->tail = prev;
-  }
+  {
+    auto lock = isolate->asyncWaiters.lockExclusive();
 
-  if (prev == &lock->head) {
-    // We held the lock before now. Alert the next waiter that they are now at the front of the
-    // line.
+    // Remove ourselves from the list.
+    *prev = next;
     KJ_IF_MAYBE(n, next) {
-      n->readyFulfiller->fulfill();
+      n->prev = prev;
+    } else {
+      lock->tail = prev;
+    }
+
+    if (prev == &lock->head) {
+      // We held the lock before now. Alert the next waiter that they are now at the front of the
+      // line.
+      KJ_IF_MAYBE(n, next) {
+        n->readyFulfiller->fulfill();
+      }
     }
   }
 
   KJ_ASSERT(threadCurrentWaiter == this);
   threadCurrentWaiter = nullptr;
+
+  // Let the next lock attempt on this thread go ahead.
+  threadQueue.release();
 }
 
 kj::Promise<void> Worker::AsyncLock::whenThreadIdle() {
-  auto waiter = AsyncWaiter::threadCurrentWaiter;
-  if (waiter != nullptr) {
-    return waiter->releasePromise.addBranch().then([]() { return whenThreadIdle(); });
+  auto& queue = AsyncWaiter::threadQueue;
+  if (queue.isBusy()) {
+    return queue.onIdle().then([]() { return whenThreadIdle(); });
   }
 
   return kj::evalLast([]() -> kj::Promise<void> {
-    if (AsyncWaiter::threadCurrentWaiter != nullptr) {
+    if (AsyncWaiter::threadQueue.isBusy()) {
       // Whoops, a new lock attempt appeared, loop.
       return whenThreadIdle();
     } else {
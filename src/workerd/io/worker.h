@@ -16,6 +16,7 @@
 #include <workerd/io/io-channels.h>
 #include <workerd/io/actor-storage.capnp.h>
 #include <workerd/io/request-tracker.h>
+#include <workerd/io/thread-lock-queue.h>
 #include <workerd/io/actor-cache.h>  // because we can't forward-declare ActorCache::SharedLru.
 
 namespace v8 { class Isolate; }
@@ -400,8 +401,11 @@ private:
   // protects the `AsyncWaiterList` as well as the next/prev pointers in each `AsyncWaiter` that
   // is currently in the list.
   //
-  // TODO(perf): Use a lock-free list? Tricky to get right. `asyncWaiters` should only be locked
-  //   briefly so there's probably not that much to gain.
+  // Each thread has at most one `AsyncWaiter` in the list, and its own lock attempts queue up on
+  // that thread rather than here (see `ThreadLockQueue`), so the list is only as long as
+  // the number of threads using the isolate. The lock is held just to link or unlink a waiter and
+  // is almost always uncontended, which costs about what a lock-free push would; a lock-free list
+  // would also have to support unlinking canceled waiters from the middle.
 
   friend class Worker::AsyncLock;
 
@@ -769,13 +773,6 @@ private:
   // Promise/fulfiller to fire when the waiter reaches the front of the list for the corresponding
   // isolate.
 
-  kj::ForkedPromise<void> releasePromise = nullptr;
-  kj::Own<kj::PromiseFulfiller<void>> releaseFulfiller;
-  // Promise/fulfiller to fire when the AsyncLock is finally released. This is used when a thread
-  // tries to take locks on multiple different isolates concurrently, in order to serialize the
-  // locks so only one is taken at a time. This is NOT a cross-thread fulfiller; it can only be
-  // fulfilled by the thread that owns the waiter.
-
   kj::Maybe<AsyncWaiter&> next;
   kj::Maybe<AsyncWaiter&>* prev;
   // Protected by the lock on `Isolate::asyncWaiters` for the isolate identified by
@@ -784,6 +781,11 @@ private:
 
   static thread_local AsyncWaiter* threadCurrentWaiter;
 
+  static thread_local ThreadLockQueue threadQueue;
+  // Lock attempts on this thread that are waiting for `threadCurrentWaiter` to be released. This
+  // is how a thread that tries to take locks on multiple different isolates concurrently
+  // serializes them, so only one is taken at a time.
+
   friend class Worker::Isolate;
   friend class Worker::AsyncLock;
 };
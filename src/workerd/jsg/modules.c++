@@ -302,12 +302,22 @@ void instantiateModule(jsg::Lock& js, v8::Local<v8::Module>& module) {
 // ===================================================================================
 
 namespace {
+void saveCodeCache(const ModuleCodeCache& codeCache, kj::ArrayPtr<const char> content,
+                   v8::Local<v8::Module> module) {
+  auto cachedData = std::unique_ptr<v8::ScriptCompiler::CachedData>(
+      v8::ScriptCompiler::CreateCodeCache(module->GetUnboundModuleScript()));
+  if (cachedData != nullptr) {
+    codeCache.put(content, kj::arrayPtr(cachedData->data, cachedData->length));
+  }
+}
+
 v8::Local<v8::Module> compileEsmModule(
     jsg::Lock& js,
     kj::StringPtr name,
     kj::ArrayPtr<const char> content,
     ModuleInfoCompileOption option,
-    const CompilationObserver& observer) {
+    const CompilationObserver& observer,
+    kj::Maybe<const ModuleCodeCache&> codeCache) {
   // destroy the observer after compilation finished to indicate the end of the process.
   auto compilationObserver = observer.onEsmCompilationStart(js.v8Isolate, name, option);
 
@@ -357,9 +367,32 @@ v8::Local<v8::Module> compileEsmModule(
 
   contentStr = jsg::v8Str(js.v8Isolate, content);
 
+  KJ_IF_MAYBE(cache, codeCache) {
+    KJ_IF_MAYBE(data, cache->get(content)) {
+      // `source` takes ownership of the CachedData object, but not of the buffer it points to.
+      v8::ScriptCompiler::Source source(contentStr, origin,
+          new v8::ScriptCompiler::CachedData(data->begin(), data->size()));
+      auto module = jsg::check(v8::ScriptCompiler::CompileModule(
+          js.v8Isolate, &source, v8::ScriptCompiler::kConsumeCodeCache));
+      if (!source.GetCachedData()->rejected) {
+        return module;
+      }
+
+      // V8 couldn't use the data, so it compiled the module from source instead. Replace the
+      // stale data so we don't hit this again next time.
+      cache->reportRejected(content);
+      saveCodeCache(*cache, content, module);
+      return module;
+    }
+  }
+
   v8::ScriptCompiler::Source source(contentStr, origin);
   auto module = jsg::check(v8::ScriptCompiler::CompileModule(js.v8Isolate, &source));
 
+  KJ_IF_MAYBE(cache, codeCache) {
+    saveCodeCache(*cache, content, module);
+  }
+
   return module;
 }
 
@@ -394,8 +427,9 @@ ModuleRegistry::ModuleInfo::ModuleInfo(
     kj::StringPtr name,
     kj::ArrayPtr<const char> content,
     ModuleInfoCompileOption flags,
-    const CompilationObserver& observer)
-    : ModuleInfo(js, compileEsmModule(js, name, content, flags, observer)) {}
+    const CompilationObserver& observer,
+    kj::Maybe<const ModuleCodeCache&> codeCache)
+    : ModuleInfo(js, compileEsmModule(js, name, content, flags, observer, codeCache)) {}
 
 ModuleRegistry::ModuleInfo::ModuleInfo(
     jsg::Lock& js,
@@ -99,6 +99,25 @@ struct CompilationObserver: public kj::Refcounted {
   // It is guaranteed that isolate lock is held during both invocations.
 };
 
+class ModuleCodeCache {
+  // Embedder-provided store for V8 code cache data produced by compiling worker bundle modules,
+  // so that a module whose source hasn't changed can skip most of the work of being compiled from
+  // source again, even in a new process. Implementations must be thread-safe, since isolates on
+  // different threads may compile modules concurrently.
+
+public:
+  virtual kj::Maybe<kj::Array<const kj::byte>> get(kj::ArrayPtr<const char> source) const = 0;
+  // Returns data previously stored for a module with exactly this source, if any.
+
+  virtual void put(kj::ArrayPtr<const char> source, kj::ArrayPtr<const kj::byte> data) const = 0;
+  // Stores data produced by compiling a module with this source, replacing any existing data.
+
+  virtual void reportRejected(kj::ArrayPtr<const char> source) const {}
+  // Called when V8 rejected the data returned by get() for this source, e.g. because it was
+  // produced by a different V8 version or with different flags. The module is compiled from
+  // source instead, and put() is then called with fresh data.
+};
+
 v8::Local<v8::WasmModuleObject> compileWasmModule(jsg::Lock& js,
     kj::ArrayPtr<const uint8_t> code,
     const CompilationObserver& observer);
@@ -204,7 +223,9 @@ public:
                kj::StringPtr name,
                kj::ArrayPtr<const char> content,
                ModuleInfoCompileOption flags,
-               const CompilationObserver& observer);
+               const CompilationObserver& observer,
+               kj::Maybe<const ModuleCodeCache&> codeCache = nullptr);
+    // `codeCache`, if provided, is consulted and populated when compiling BUNDLE modules.
 
     ModuleInfo(jsg::Lock& js, kj::StringPtr name,
                kj::Maybe<kj::ArrayPtr<kj::StringPtr>> maybeExports,
@@ -666,6 +666,23 @@ kj::Array<kj::byte> asBytes(v8::Local<v8::ArrayBufferView> arrayBufferView) {
   }
 }
 
+kj::ArrayPtr<kj::byte> asBytesBorrowed(v8::Local<v8::ArrayBufferView> arrayBufferView) {
+  auto data = static_cast<kj::byte*>(arrayBufferView->Buffer()->Data());
+  if (data == nullptr) {
+    // See getEmptyArray().
+    return kj::arrayPtr(&DUMMY, 0);
+  }
+  return kj::arrayPtr(data + arrayBufferView->ByteOffset(), arrayBufferView->ByteLength());
+}
+
+kj::ArrayPtr<const kj::byte> asBytesBorrowed(
+    v8::Local<v8::ArrayBufferView> arrayBufferView, kj::ArrayPtr<kj::byte> scratch) {
+  if (!arrayBufferView->HasBuffer() && arrayBufferView->ByteLength() <= scratch.size()) {
+    return scratch.first(arrayBufferView->CopyContents(scratch.begin(), scratch.size()));
+  }
+  return asBytesBorrowed(arrayBufferView);
+}
+
 void recursivelyFreeze(v8::Local<v8::Context> context, v8::Local<v8::Value> value) {
   if (value->IsArray()) {
     // Optimize array freezing (Array is a subclass of Object, but we can iterate it faster).
@@ -173,6 +173,24 @@ kj::Array<kj::byte> asBytes(v8::Local<v8::ArrayBuffer> arrayBuffer);
 kj::Array<kj::byte> asBytes(v8::Local<v8::ArrayBufferView> arrayBufferView);
 // View the contents of the given v8::ArrayBuffer/ArrayBufferView as an ArrayPtr<byte>.
 
+kj::ArrayPtr<kj::byte> asBytesBorrowed(v8::Local<v8::ArrayBufferView> arrayBufferView);
+// Like asBytes(), but doesn't take a reference to the backing store. The result is only valid for
+// as long as `arrayBufferView` is, and only until JavaScript next runs, since JavaScript could
+// detach or resize the buffer. Good for synchronous methods that just process their argument.
+//
+// Note that this calls Buffer(), which moves the contents of a small typed array that V8 is still
+// keeping on its heap into a new off-heap backing store. Callers that only read the bytes should
+// use the overload below.
+
+kj::ArrayPtr<const kj::byte> asBytesBorrowed(
+    v8::Local<v8::ArrayBufferView> arrayBufferView, kj::ArrayPtr<kj::byte> scratch);
+// Read-only version of the above. If the view's contents are still on V8's heap, they are copied
+// into `scratch` instead, so that reading them doesn't move them off the heap. `scratch` should
+// be at least `ON_HEAP_BYTES_MAX` bytes, and must outlive the result.
+
+constexpr size_t ON_HEAP_BYTES_MAX = V8_TYPED_ARRAY_MAX_SIZE_IN_HEAP;
+// The largest typed array whose contents V8 keeps on its heap.
+
 void recursivelyFreeze(v8::Local<v8::Context> context, v8::Local<v8::Value> value);
 // Freeze the given object and all its members, making it recursively immutable.
 //
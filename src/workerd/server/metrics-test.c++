@@ -0,0 +1,124 @@
+// Copyright (c) 2017-2023 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#include "metrics.h"
+#include <kj/test.h>
+#include <string.h>
+
+namespace workerd::server {
+namespace {
+
+uint64_t totalCount(const MetricsHistogram& histogram) {
+  uint64_t result = 0;
+  for (size_t i = 0; i <= MetricsHistogram::BUCKET_COUNT; i++) {
+    result += histogram.getCount(i);
+  }
+  return result;
+}
+
+void expectLine(kj::StringPtr text, kj::StringPtr line, kj::SourceLocation loc = {}) {
+  KJ_EXPECT_AT(strstr(text.cStr(), kj::str("\n", line, "\n").cStr()) != nullptr, loc, line, text);
+}
+
+KJ_TEST("MetricsHistogram buckets") {
+  MetricsHistogram histogram;
+  histogram.record(0 * kj::NANOSECONDS);
+  histogram.record(100 * kj::MICROSECONDS);   // bounds are inclusive
+  histogram.record(101 * kj::MICROSECONDS);
+  histogram.record(1 * kj::SECONDS);
+  histogram.record(11 * kj::SECONDS);
+
+  KJ_EXPECT(histogram.getCount(0) == 2);
+  KJ_EXPECT(histogram.getCount(1) == 1);
+  KJ_EXPECT(histogram.getCount(12) == 1);
+  KJ_EXPECT(histogram.getCount(MetricsHistogram::BUCKET_COUNT) == 1);
+  KJ_EXPECT(totalCount(histogram) == 5);
+  KJ_EXPECT(histogram.getSumNanos() == 12'000'201'000);
+}
+
+KJ_TEST("MetricsRegistry sums shards") {
+  MetricsRegistry registry;
+  auto& shard1 = registry.addShard();
+  auto& shard2 = registry.addShard();
+
+  auto& worker1 = shard1.addWorker("hello");
+  auto& worker2 = shard2.addWorker("hello");
+  worker1.heapUsedBytes.set(100);
+  worker2.heapUsedBytes.set(50);
+
+  auto& default1 = worker1.addEntrypoint("default");
+  auto& default2 = worker2.addEntrypoint("default");
+  auto& foo = worker2.addEntrypoint("foo");
+  default1.requests.add(2);
+  default2.requests.add(3);
+  foo.requests.add();
+  default2.requestDuration.record(2 * kj::MILLISECONDS);
+
+  shard2.addWorker("we\"ird\\").addEntrypoint("default").failures.add();
+
+  auto text = registry.render();
+  expectLine(text, "# TYPE workerd_requests_total counter");
+  expectLine(text, "workerd_requests_total{worker=\"hello\",entrypoint=\"default\"} 5");
+  expectLine(text, "workerd_requests_total{worker=\"hello\",entrypoint=\"foo\"} 1");
+  expectLine(text, "workerd_isolate_heap_used_bytes{worker=\"hello\"} 150");
+  expectLine(text,
+      "workerd_request_failures_total{worker=\"we\\\"ird\\\\\",entrypoint=\"default\"} 1");
+
+  expectLine(text, "workerd_request_duration_seconds_bucket"
+      "{worker=\"hello\",entrypoint=\"default\",le=\"0.001\"} 0");
+  expectLine(text, "workerd_request_duration_seconds_bucket"
+      "{worker=\"hello\",entrypoint=\"default\",le=\"0.0025\"} 1");
+  expectLine(text, "workerd_request_duration_seconds_bucket"
+      "{worker=\"hello\",entrypoint=\"default\",le=\"+Inf\"} 1");
+  expectLine(text, "workerd_request_duration_seconds_sum"
+      "{worker=\"hello\",entrypoint=\"default\"} 0.002");
+  expectLine(text, "workerd_request_duration_seconds_count"
+      "{worker=\"hello\",entrypoint=\"default\"} 1");
+}
+
+KJ_TEST("IsolateMetrics lock timing") {
+  MetricsRegistry registry;
+  auto& shard = registry.addShard();
+  auto& a = shard.addWorker("a");
+  auto& b = shard.addWorker("b");
+  auto observer = kj::atomicRefcounted<IsolateMetrics>(shard, a);
+
+  {
+    // An async lock attempt that first waits for other isolates' locks, one of them twice, then
+    // finds the thread already waiting for our isolate.
+    auto maybeTiming = observer->tryCreateLockTiming(kj::Maybe<RequestObserver&>(nullptr));
+    auto timing = kj::mv(KJ_ASSERT_NONNULL(maybeTiming));
+    timing->waitingForOtherIsolate("b");
+    timing->waitingForOtherIsolate("not-a-worker");
+    timing->waitingForOtherIsolate("b");
+    timing->reportAsyncInfo(1, true, 2);
+
+    IsolateObserver::LockRecord record(kj::mv(timing));
+    record.locked();
+  }
+
+  {
+    // A synchronous lock.
+    auto maybeTiming = observer->tryCreateLockTiming(kj::Maybe<RequestObserver&>(nullptr));
+    IsolateObserver::LockRecord record(kj::mv(maybeTiming));
+    record.locked();
+  }
+
+  KJ_EXPECT(totalCount(a.lockWait) == 2);
+  KJ_EXPECT(totalCount(a.lockHold) == 2);
+  KJ_EXPECT(totalCount(a.lockCrossIsolateWait) == 3);
+  KJ_EXPECT(a.lockCoalesced.get() == 1);
+  KJ_EXPECT(a.lockBlockedOthers.get() == 0);
+  KJ_EXPECT(b.lockBlockedOthers.get() == 2);
+  KJ_EXPECT(totalCount(b.lockWait) == 0);
+
+  auto text = registry.render();
+  expectLine(text, "workerd_isolate_lock_hold_seconds_count{worker=\"a\"} 2");
+  expectLine(text, "workerd_isolate_lock_cross_isolate_wait_seconds_count{worker=\"a\"} 3");
+  expectLine(text, "workerd_isolate_lock_coalesced_total{worker=\"a\"} 1");
+  expectLine(text, "workerd_isolate_lock_blocked_others_total{worker=\"b\"} 2");
+}
+
+}  // namespace
+}  // namespace workerd::server
@@ -0,0 +1,456 @@
+// Copyright (c) 2017-2023 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#include "metrics.h"
+#include <kj/debug.h>
+
+namespace workerd::server {
+
+const MetricsHistogram::Bucket MetricsHistogram::BUCKETS[BUCKET_COUNT] = {
+  {        100'000, "0.0001"_kj },
+  {        250'000, "0.00025"_kj },
+  {        500'000, "0.0005"_kj },
+  {      1'000'000, "0.001"_kj },
+  {      2'500'000, "0.0025"_kj },
+  {      5'000'000, "0.005"_kj },
+  {     10'000'000, "0.01"_kj },
+  {     25'000'000, "0.025"_kj },
+  {     50'000'000, "0.05"_kj },
+  {    100'000'000, "0.1"_kj },
+  {    250'000'000, "0.25"_kj },
+  {    500'000'000, "0.5"_kj },
+  {  1'000'000'000, "1"_kj },
+  {  2'500'000'000, "2.5"_kj },
+  {  5'000'000'000, "5"_kj },
+  { 10'000'000'000, "10"_kj },
+};
+
+void MetricsHistogram::record(kj::Duration duration) {
+  uint64_t nanos = duration / kj::NANOSECONDS;
+  size_t bucket = 0;
+  while (bucket < BUCKET_COUNT && nanos > BUCKETS[bucket].maxNanos) ++bucket;
+  counts[bucket].add();
+  sumNanos.add(nanos);
+}
+
+EntrypointMetrics& WorkerMetrics::addEntrypoint(kj::StringPtr name) {
+  auto metrics = kj::heap<EntrypointMetrics>(name);
+  auto& result = *metrics;
+  entrypoints.lockExclusive()->add(kj::mv(metrics));
+  return result;
+}
+
+WorkerMetrics& MetricsShard::addWorker(kj::StringPtr name) {
+  auto metrics = kj::heap<WorkerMetrics>(name);
+  auto& result = *metrics;
+  workers.lockExclusive()->add(kj::mv(metrics));
+  return result;
+}
+
+kj::Maybe<WorkerMetrics&> MetricsShard::findWorker(kj::StringPtr name) const {
+  auto lock = workers.lockShared();
+  for (auto& worker: *lock) {
+    if (worker->getName() == name) return *worker;
+  }
+  return nullptr;
+}
+
+MetricsShard& MetricsRegistry::addShard() {
+  auto shard = kj::heap<MetricsShard>();
+  auto& result = *shard;
+  shards.lockExclusive()->add(kj::mv(shard));
+  return result;
+}
+
+// ---------------------------------------------------------------------------
+// Prometheus text format
+
+namespace {
+
+struct HistogramTotals {
+  uint64_t counts[MetricsHistogram::BUCKET_COUNT + 1] = {};
+  uint64_t sumNanos = 0;
+
+  void add(const MetricsHistogram& histogram) {
+    for (size_t i = 0; i < kj::size(counts); i++) {
+      counts[i] += histogram.getCount(i);
+    }
+    sumNanos += histogram.getSumNanos();
+  }
+};
+
+struct EntrypointTotals {
+  kj::String labels;
+  uint64_t requests = 0;
+  uint64_t failures = 0;
+  uint64_t subrequests = 0;
+  HistogramTotals requestDuration;
+  HistogramTotals jsTime;
+};
+
+struct WorkerTotals {
+  kj::String labels;
+  uint64_t heapUsedBytes = 0;
+  HistogramTotals lockWait;
+  HistogramTotals lockHold;
+  HistogramTotals lockCrossIsolateWait;
+  uint64_t lockCoalesced = 0;
+  uint64_t lockBlockedOthers = 0;
+  uint64_t liveActors = 0;
+  uint64_t evictedActors = 0;
+
+  kj::Vector<EntrypointTotals> entrypoints;
+  kj::HashMap<kj::String, size_t> entrypointIndex;
+};
+
+kj::String escapeLabel(kj::StringPtr value) {
+  // Label values are double-quoted, with backslashes, quotes, and line feeds escaped.
+  kj::Vector<char> result(value.size() + 1);
+  for (char c: value) {
+    switch (c) {
+      case '\\': result.addAll("\\\\"_kj); break;
+      case '"':  result.addAll("\\\""_kj); break;
+      case '\n': result.addAll("\\n"_kj); break;
+      default:   result.add(c); break;
+    }
+  }
+  result.add('\0');
+  return kj::String(result.releaseAsArray());
+}
+
+class Writer {
+public:
+  void family(kj::StringPtr name, kj::StringPtr type, kj::StringPtr help) {
+    parts.add(kj::str("# HELP ", name, ' ', help, "\n# TYPE ", name, ' ', type, '\n'));
+  }
+
+  void sample(kj::StringPtr name, kj::StringPtr labels, uint64_t value) {
+    parts.add(kj::str(name, '{', labels, "} ", value, '\n'));
+  }
+
+  void histogram(kj::StringPtr name, kj::StringPtr labels, const HistogramTotals& totals) {
+    // Prometheus buckets are cumulative.
+    uint64_t count = 0;
+    for (size_t i = 0; i < MetricsHistogram::BUCKET_COUNT; i++) {
+      count += totals.counts[i];
+      parts.add(kj::str(name, "_bucket{", labels, ",le=\"", MetricsHistogram::BUCKETS[i].label,
+                        "\"} ", count, '\n'));
+    }
+    count += totals.counts[MetricsHistogram::BUCKET_COUNT];
+    parts.add(kj::str(name, "_bucket{", labels, ",le=\"+Inf\"} ", count, '\n'));
+    parts.add(kj::str(name, "_sum{", labels, "} ", totals.sumNanos / 1e9, '\n'));
+    parts.add(kj::str(name, "_count{", labels, "} ", count, '\n'));
+  }
+
+  kj::String finish() { return kj::strArray(parts, ""); }
+
+private:
+  kj::Vector<kj::String> parts;
+};
+
+}  // namespace
+
+kj::String MetricsRegistry::render() const {
+  // Sum up the shards, keeping workers and entrypoints in the order they were first registered.
+  kj::Vector<WorkerTotals> workers;
+  kj::HashMap<kj::String, size_t> workerIndex;
+
+  auto lock = shards.lockShared();
+  for (auto& shard: *lock) {
+    shard->forEachWorker([&](const WorkerMetrics& worker) {
+      size_t index = workerIndex.findOrCreate(worker.getName(), [&]() {
+        workers.add(WorkerTotals {
+          .labels = kj::str("worker=\"", escapeLabel(worker.getName()), '"')
+        });
+        return decltype(workerIndex)::Entry { kj::str(worker.getName()), workers.size() - 1 };
+      });
+      auto& totals = workers[index];
+      totals.heapUsedBytes += worker.heapUsedBytes.get();
+      totals.lockWait.add(worker.lockWait);
+      totals.lockHold.add(worker.lockHold);
+      totals.lockCrossIsolateWait.add(worker.lockCrossIsolateWait);
+      totals.lockCoalesced += worker.lockCoalesced.get();
+      totals.lockBlockedOthers += worker.lockBlockedOthers.get();
+      totals.liveActors += worker.liveActors.get();
+      totals.evictedActors += worker.evictedActors.get();
+
+      worker.forEachEntrypoint([&](const EntrypointMetrics& entrypoint) {
+        size_t epIndex = totals.entrypointIndex.findOrCreate(entrypoint.getName(), [&]() {
+          totals.entrypoints.add(EntrypointTotals {
+            .labels = kj::str(totals.labels, ",entrypoint=\"", escapeLabel(entrypoint.getName()),
+                              '"')
+          });
+          return decltype(totals.entrypointIndex)::Entry {
+            kj::str(entrypoint.getName()), totals.entrypoints.size() - 1
+          };
+        });
+        auto& epTotals = totals.entrypoints[epIndex];
+        epTotals.requests += entrypoint.requests.get();
+        epTotals.failures += entrypoint.failures.get();
+        epTotals.subrequests += entrypoint.subrequests.get();
+        epTotals.requestDuration.add(entrypoint.requestDuration);
+        epTotals.jsTime.add(entrypoint.jsTime);
+      });
+    });
+  }
+
+  Writer writer;
+
+  writer.family("workerd_requests_total", "counter",
+      "Requests delivered to a Worker entrypoint.");
+  for (auto& w: workers) for (auto& e: w.entrypoints) {
+    writer.sample("workerd_requests_total", e.labels, e.requests);
+  }
+
+  writer.family("workerd_request_failures_total", "counter",
+      "Requests that ended in an uncaught exception.");
+  for (auto& w: workers) for (auto& e: w.entrypoints) {
+    writer.sample("workerd_request_failures_total", e.labels, e.failures);
+  }
+
+  writer.family("workerd_subrequests_total", "counter",
+      "Outgoing subrequests, including to Durable Objects, made while handling requests.");
+  for (auto& w: workers) for (auto& e: w.entrypoints) {
+    writer.sample("workerd_subrequests_total", e.labels, e.subrequests);
+  }
+
+  writer.family("workerd_request_duration_seconds", "histogram",
+      "Time from the delivery of a request until its response was complete.");
+  for (auto& w: workers) for (auto& e: w.entrypoints) {
+    writer.histogram("workerd_request_duration_seconds", e.labels, e.requestDuration);
+  }
+
+  writer.family("workerd_request_js_seconds", "histogram",
+      "Wall time spent running JavaScript on behalf of each request.");
+  for (auto& w: workers) for (auto& e: w.entrypoints) {
+    writer.histogram("workerd_request_js_seconds", e.labels, e.jsTime);
+  }
+
+  writer.family("workerd_isolate_heap_used_bytes", "gauge",
+      "V8 heap in use by a Worker's isolates, summed over threads.");
+  for (auto& w: workers) {
+    writer.sample("workerd_isolate_heap_used_bytes", w.labels, w.heapUsedBytes);
+  }
+
+  writer.family("workerd_isolate_lock_wait_seconds", "histogram",
+      "Time spent waiting to take a Worker's isolate lock.");
+  for (auto& w: workers) {
+    writer.histogram("workerd_isolate_lock_wait_seconds", w.labels, w.lockWait);
+  }
+
+  writer.family("workerd_isolate_lock_hold_seconds", "histogram",
+      "Time a Worker's isolate lock was held for, each time it was taken.");
+  for (auto& w: workers) {
+    writer.histogram("workerd_isolate_lock_hold_seconds", w.labels, w.lockHold);
+  }
+
+  writer.family("workerd_isolate_lock_cross_isolate_wait_seconds", "histogram",
+      "Time attempts to take a Worker's isolate lock spent queued behind another isolate's lock "
+      "on the same thread.");
+  for (auto& w: workers) {
+    writer.histogram("workerd_isolate_lock_cross_isolate_wait_seconds", w.labels,
+                     w.lockCrossIsolateWait);
+  }
+
+  writer.family("workerd_isolate_lock_coalesced_total", "counter",
+      "Attempts to take a Worker's isolate lock that joined one already waiting on the thread.");
+  for (auto& w: workers) {
+    writer.sample("workerd_isolate_lock_coalesced_total", w.labels, w.lockCoalesced);
+  }
+
+  writer.family("workerd_isolate_lock_blocked_others_total", "counter",
+      "Times another Worker's attempt to take its isolate lock had to wait for this Worker's.");
+  for (auto& w: workers) {
+    writer.sample("workerd_isolate_lock_blocked_others_total", w.labels, w.lockBlockedOthers);
+  }
+
+  writer.family("workerd_actors_live", "gauge",
+      "Durable Objects of a Worker currently in memory, summed over threads.");
+  for (auto& w: workers) {
+    writer.sample("workerd_actors_live", w.labels, w.liveActors);
+  }
+
+  writer.family("workerd_actors_evicted_total", "counter",
+      "Durable Objects of a Worker removed from memory after being idle.");
+  for (auto& w: workers) {
+    writer.sample("workerd_actors_evicted_total", w.labels, w.evictedActors);
+  }
+
+  return writer.finish();
+}
+
+// =======================================================================================
+
+RequestMetrics::~RequestMetrics() noexcept(false) {
+  if (wasDelivered) {
+    metrics.jsTime.record(jsTime);
+  }
+}
+
+void RequestMetrics::delivered() {
+  wasDelivered = true;
+  metrics.requests.add();
+}
+
+void RequestMetrics::reportFailure(const kj::Exception& e) {
+  fail();
+}
+
+void RequestMetrics::fail() {
+  // A request may fail in more than one way, e.g. reportFailure() and then an exception from the
+  // wrapped WorkerInterface, but only counts once.
+  if (!failed) {
+    failed = true;
+    metrics.failures.add();
+  }
+}
+
+WorkerInterface& RequestMetrics::wrapWorkerInterface(WorkerInterface& worker) {
+  return wrapper.emplace(*this, worker);
+}
+
+kj::Own<WorkerInterface> RequestMetrics::wrapSubrequestClient(kj::Own<WorkerInterface> client) {
+  metrics.subrequests.add();
+  return kj::mv(client);
+}
+
+kj::Own<WorkerInterface> RequestMetrics::wrapActorSubrequestClient(
+    kj::Own<WorkerInterface> client) {
+  metrics.subrequests.add();
+  return kj::mv(client);
+}
+
+template <typename Func>
+kj::PromiseForResult<Func, void> RequestMetrics::TimedWorkerInterface::timed(Func&& func) {
+  auto start = kj::systemPreciseMonotonicClock().now();
+  return func()
+      .catch_([this](kj::Exception&& e) -> kj::PromiseForResult<Func, void> {
+    observer.fail();
+    return kj::mv(e);
+  }).attach(kj::defer([this, start]() {
+    observer.metrics.requestDuration.record(kj::systemPreciseMonotonicClock().now() - start);
+  }));
+}
+
+kj::Promise<void> RequestMetrics::TimedWorkerInterface::request(
+    kj::HttpMethod method, kj::StringPtr url, const kj::HttpHeaders& headers,
+    kj::AsyncInputStream& requestBody, kj::HttpService::Response& response) {
+  return timed([&]() { return inner.request(method, url, headers, requestBody, response); });
+}
+
+kj::Promise<void> RequestMetrics::TimedWorkerInterface::connect(
+    kj::StringPtr host, const kj::HttpHeaders& headers, kj::AsyncIoStream& connection,
+    ConnectResponse& response, kj::HttpConnectSettings settings) {
+  return timed([&]() { return inner.connect(host, headers, connection, response, settings); });
+}
+
+void RequestMetrics::TimedWorkerInterface::prewarm(kj::StringPtr url) {
+  inner.prewarm(url);
+}
+
+kj::Promise<WorkerInterface::ScheduledResult> RequestMetrics::TimedWorkerInterface::runScheduled(
+    kj::Date scheduledTime, kj::StringPtr cron) {
+  return timed([&]() { return inner.runScheduled(scheduledTime, cron); });
+}
+
+kj::Promise<WorkerInterface::AlarmResult> RequestMetrics::TimedWorkerInterface::runAlarm(
+    kj::Date scheduledTime) {
+  return timed([&]() { return inner.runAlarm(scheduledTime); });
+}
+
+kj::Promise<bool> RequestMetrics::TimedWorkerInterface::test() {
+  return timed([&]() { return inner.test(); });
+}
+
+kj::Promise<WorkerInterface::CustomEvent::Result>
+    RequestMetrics::TimedWorkerInterface::customEvent(kj::Own<CustomEvent> event) {
+  return timed([&]() { return inner.customEvent(kj::mv(event)); });
+}
+
+// =======================================================================================
+
+namespace {
+
+class IsolateLockTiming final: public IsolateObserver::LockTiming {
+  // Follows one attempt to take an isolate lock.
+  //
+  // An async attempt creates its LockTiming before it starts waiting for the isolate to become
+  // free, reports whether it coalesced with another waiter or had to wait for other isolates
+  // first, and only constructs the LockRecord, which calls start(), once it is at the front of the
+  // queue. So, we time the wait from construction, to count both the asynchronous wait and the
+  // final v8::Locker.
+
+public:
+  explicit IsolateLockTiming(const IsolateMetrics& observer)
+      : observer(observer), metrics(observer.getMetrics()), created(now()) {}
+
+  void waitingForOtherIsolate(kj::StringPtr id) override {
+    // The thread is waiting for, or holding, the lock of the isolate named `id`, and won't try to
+    // take ours until that's released. takeAsyncLock() loops until it gets past this point, so
+    // this may be called several times, possibly naming different isolates.
+    auto time = now();
+    endCrossIsolateWait(time);
+    blockedSince = time;
+
+    KJ_IF_MAYBE(other, observer.findOtherWorker(id)) {
+      other->lockBlockedOthers.add();
+    }
+  }
+
+  void reportAsyncInfo(uint currentLoad, bool threadWaitingSameLock,
+                       uint threadWaitingDifferentLockCount) override {
+    endCrossIsolateWait(now());
+    if (threadWaitingSameLock) {
+      metrics.lockCoalesced.add();
+    }
+  }
+
+  void locked() override {
+    auto time = now();
+    metrics.lockWait.record(time - created);
+    lockedAt = time;
+  }
+
+  void stop() override {
+    KJ_IF_MAYBE(l, lockedAt) {
+      metrics.lockHold.record(now() - *l);
+    }
+  }
+
+private:
+  const IsolateMetrics& observer;
+  WorkerMetrics& metrics;
+  kj::TimePoint created;
+  kj::Maybe<kj::TimePoint> blockedSince;
+  kj::Maybe<kj::TimePoint> lockedAt;
+
+  static kj::TimePoint now() { return kj::systemPreciseMonotonicClock().now(); }
+
+  void endCrossIsolateWait(kj::TimePoint time) {
+    KJ_IF_MAYBE(b, blockedSince) {
+      metrics.lockCrossIsolateWait.record(time - *b);
+      blockedSince = nullptr;
+    }
+  }
+};
+
+}  // namespace
+
+kj::Maybe<kj::Own<IsolateObserver::LockTiming>> IsolateMetrics::tryCreateLockTiming(
+    kj::OneOf<SpanParent, kj::Maybe<RequestObserver&>> parentOrRequest) const {
+  return kj::Own<LockTiming>(kj::heap<IsolateLockTiming>(*this));
+}
+
+kj::Maybe<WorkerMetrics&> IsolateMetrics::findOtherWorker(kj::StringPtr id) const {
+  KJ_IF_MAYBE(cached, otherWorkers.find(id)) {
+    return **cached;
+  }
+  KJ_IF_MAYBE(worker, shard.findWorker(id)) {
+    otherWorkers.insert(kj::str(id), worker);
+    return *worker;
+  }
+  return nullptr;
+}
+
+}  // namespace workerd::server
@@ -0,0 +1,252 @@
+// Copyright (c) 2017-2023 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#pragma once
+// Implements the observers from io/observer.h in terms of in-process counters and histograms,
+// which a `metrics` service then serves in the Prometheus text exposition format.
+//
+// Every Server -- one per serving thread -- records into its own MetricsShard, and only that
+// thread ever updates the shard's counters, so an update is a plain relaxed load and store with
+// no locking and no read-modify-write. The endpoint sums all the shards in the registry when
+// scraped, reading the counters concurrently with their owners.
+
+#include <kj/map.h>
+#include <kj/mutex.h>
+#include <kj/string.h>
+#include <kj/vector.h>
+#include <kj/time.h>
+#include <workerd/io/observer.h>
+#include <workerd/io/worker-interface.h>
+#include <atomic>
+
+namespace workerd::server {
+
+class MetricsCounter {
+  // A 64-bit value that only one thread writes but any thread may read.
+
+public:
+  void add(uint64_t n = 1) {
+    value.store(value.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+  }
+  void sub(uint64_t n = 1) {
+    value.store(value.load(std::memory_order_relaxed) - n, std::memory_order_relaxed);
+  }
+  void set(uint64_t n) { value.store(n, std::memory_order_relaxed); }
+  uint64_t get() const { return value.load(std::memory_order_relaxed); }
+
+private:
+  std::atomic<uint64_t> value { 0 };
+};
+
+class MetricsHistogram {
+  // A histogram of durations, with fixed buckets ranging from 100us to 10s. Like MetricsCounter,
+  // it must only be written by one thread.
+
+public:
+  struct Bucket {
+    uint64_t maxNanos;
+    kj::StringPtr label;
+    // Upper bound of the bucket, inclusive, and the same in seconds as Prometheus writes it.
+  };
+  static constexpr size_t BUCKET_COUNT = 16;
+  static const Bucket BUCKETS[BUCKET_COUNT];
+  // Observations greater than the last bound go in an extra, unbounded bucket.
+
+  void record(kj::Duration duration);
+
+  uint64_t getCount(size_t bucket) const { return counts[bucket].get(); }
+  uint64_t getSumNanos() const { return sumNanos.get(); }
+  // `bucket` may be BUCKET_COUNT, for the unbounded bucket. Counts are per bucket, not
+  // cumulative.
+
+private:
+  MetricsCounter counts[BUCKET_COUNT + 1];
+  MetricsCounter sumNanos;
+};
+
+class EntrypointMetrics {
+  // Metrics for the requests one thread delivers to one entrypoint of a Worker.
+
+public:
+  explicit EntrypointMetrics(kj::StringPtr name): name(kj::str(name)) {}
+
+  kj::StringPtr getName() const { return name; }
+
+  MetricsCounter requests;
+  MetricsCounter failures;
+  MetricsCounter subrequests;
+  MetricsHistogram requestDuration;
+  MetricsHistogram jsTime;
+
+private:
+  kj::String name;
+};
+
+class WorkerMetrics {
+  // Metrics for one Worker, and its isolate, on one thread.
+
+public:
+  explicit WorkerMetrics(kj::StringPtr name): name(kj::str(name)) {}
+
+  kj::StringPtr getName() const { return name; }
+
+  EntrypointMetrics& addEntrypoint(kj::StringPtr name);
+  // `name` is "default" for the default export. Returns a reference that remains valid as long as
+  // the registry does.
+
+  template <typename Func>
+  void forEachEntrypoint(Func&& func) const {
+    auto lock = entrypoints.lockShared();
+    for (auto& entrypoint: *lock) func(*entrypoint);
+  }
+
+  MetricsCounter heapUsedBytes;
+  // A gauge, sampled from time to time while JavaScript runs.
+
+  MetricsHistogram lockWait;
+  MetricsHistogram lockHold;
+  // How long each attempt to take the isolate lock waited for it, and then held it.
+
+  MetricsHistogram lockCrossIsolateWait;
+  // How long attempts to take the lock waited for the thread to finish with other isolates'
+  // locks first. This is part of `lockWait`.
+
+  MetricsCounter lockCoalesced;
+  // Async attempts that found the thread already waiting for this isolate's lock, and so shared
+  // that wait rather than queueing separately.
+
+  MetricsCounter lockBlockedOthers;
+  // Times an attempt to take another isolate's lock had to wait for the thread to finish with
+  // this one's. Together with `lockHold`, shows which Worker is monopolizing the thread.
+
+  MetricsCounter liveActors;
+  // A gauge of the Worker's Durable Objects currently in memory.
+
+  MetricsCounter evictedActors;
+  // Durable Objects removed from memory for having been idle for their namespace's idle timeout.
+
+private:
+  kj::String name;
+  kj::MutexGuarded<kj::Vector<kj::Own<EntrypointMetrics>>> entrypoints;
+  // Only locked to add an entrypoint, which happens at startup, or to scrape.
+};
+
+class MetricsShard {
+  // The metrics of one Server, and so of one thread.
+
+public:
+  WorkerMetrics& addWorker(kj::StringPtr name);
+  // Returns a reference that remains valid as long as the registry does.
+
+  kj::Maybe<WorkerMetrics&> findWorker(kj::StringPtr name) const;
+
+  template <typename Func>
+  void forEachWorker(Func&& func) const {
+    auto lock = workers.lockShared();
+    for (auto& worker: *lock) func(*worker);
+  }
+
+private:
+  kj::MutexGuarded<kj::Vector<kj::Own<WorkerMetrics>>> workers;
+};
+
+class MetricsRegistry {
+  // All the metrics of a process. Metrics with the same worker and entrypoint name in different
+  // shards are reported as one, their sum.
+
+public:
+  MetricsShard& addShard();
+  // Returns a reference that remains valid as long as the registry does.
+
+  kj::String render() const;
+  // Formats the current totals in the Prometheus text exposition format, version 0.0.4.
+
+private:
+  kj::MutexGuarded<kj::Vector<kj::Own<MetricsShard>>> shards;
+};
+
+// =======================================================================================
+
+class RequestMetrics final: public RequestObserver {
+  // Records a request into the metrics of the entrypoint it was delivered to.
+
+public:
+  explicit RequestMetrics(EntrypointMetrics& metrics): metrics(metrics) {}
+  ~RequestMetrics() noexcept(false);
+
+  void addJsTime(kj::Duration time) { jsTime += time; }
+  // Called by the request's LimitEnforcer from reportMetrics(). The total is recorded as a single
+  // observation once the request is done.
+
+  void delivered() override;
+  void reportFailure(const kj::Exception& e) override;
+  WorkerInterface& wrapWorkerInterface(WorkerInterface& worker) override;
+  kj::Own<WorkerInterface> wrapSubrequestClient(kj::Own<WorkerInterface> client) override;
+  kj::Own<WorkerInterface> wrapActorSubrequestClient(kj::Own<WorkerInterface> client) override;
+
+private:
+  class TimedWorkerInterface final: public WorkerInterface {
+    // Measures how long the single call made on the wrapped interface takes to complete, e.g.
+    // until the whole HTTP response has been sent.
+
+  public:
+    TimedWorkerInterface(RequestMetrics& observer, WorkerInterface& inner)
+        : observer(observer), inner(inner) {}
+
+    kj::Promise<void> request(
+        kj::HttpMethod method, kj::StringPtr url, const kj::HttpHeaders& headers,
+        kj::AsyncInputStream& requestBody, kj::HttpService::Response& response) override;
+    kj::Promise<void> connect(kj::StringPtr host, const kj::HttpHeaders& headers,
+        kj::AsyncIoStream& connection, ConnectResponse& response,
+        kj::HttpConnectSettings settings) override;
+    void prewarm(kj::StringPtr url) override;
+    kj::Promise<ScheduledResult> runScheduled(kj::Date scheduledTime, kj::StringPtr cron) override;
+    kj::Promise<AlarmResult> runAlarm(kj::Date scheduledTime) override;
+    kj::Promise<bool> test() override;
+    kj::Promise<CustomEvent::Result> customEvent(kj::Own<CustomEvent> event) override;
+
+  private:
+    RequestMetrics& observer;
+    WorkerInterface& inner;
+
+    template <typename Func>
+    kj::PromiseForResult<Func, void> timed(Func&& func);
+  };
+
+  EntrypointMetrics& metrics;
+  kj::Maybe<TimedWorkerInterface> wrapper;
+  bool wasDelivered = false;
+  bool failed = false;
+  kj::Duration jsTime = 0 * kj::NANOSECONDS;
+
+  void fail();
+};
+
+class IsolateMetrics final: public IsolateObserver {
+  // Records the isolate lock activity of a Worker's isolate: how long each lock is waited for and
+  // held, and how often attempts coalesce or queue behind other isolates on the same thread.
+  // Isolate IDs are Worker names, which are used to find the Worker in `shard` that is to blame
+  // for a cross-isolate wait.
+
+public:
+  IsolateMetrics(MetricsShard& shard, WorkerMetrics& metrics): shard(shard), metrics(metrics) {}
+
+  kj::Maybe<kj::Own<LockTiming>> tryCreateLockTiming(
+      kj::OneOf<SpanParent, kj::Maybe<RequestObserver&>> parentOrRequest) const override;
+
+  WorkerMetrics& getMetrics() const { return metrics; }
+
+  kj::Maybe<WorkerMetrics&> findOtherWorker(kj::StringPtr id) const;
+  // Finds the Worker whose isolate is named `id`. Each Worker is looked up in `shard` only the
+  // first time, so the shard's lock and search stay off the lock contention path.
+
+private:
+  MetricsShard& shard;
+  WorkerMetrics& metrics;
+
+  mutable kj::HashMap<kj::String, WorkerMetrics*> otherWorkers;
+  // Only used by the shard's thread, which is the only one that takes this isolate's lock.
+};
+
+}  // namespace workerd::server
@@ -119,6 +119,12 @@ public:
     recvHttp200(expectedResponse, loc);
   }
 
+  kj::String recvAll() {
+    // Returns whatever has been received, with `\r`s stripped, for a test that can't predict the
+    // whole message.
+    return readAllAvailable();
+  }
+
   bool isEof() {
     // Return true if the stream is at EOF.
 
@@ -1196,6 +1202,85 @@ KJ_TEST("Server: named entrypoints") {
   }
 }
 
+KJ_TEST("Server: metrics service") {
+  TestServer test(R"((
+    services = [
+      ( name = "hello",
+        worker = (
+          compatibilityDate = "2022-08-17",
+          modules = [
+            ( name = "main.js",
+              esModule =
+                `export default {
+                `  async fetch(request, env) {
+                `    return new Response("hello from default entrypoint");
+                `  }
+                `}
+                `export let foo = {
+                `  async fetch(request, env) {
+                `    return new Response("hello from foo entrypoint");
+                `  }
+                `}
+            )
+          ]
+        )
+      ),
+      ( name = "metrics", metrics = void ),
+    ],
+    sockets = [
+      ( name = "main", address = "test-addr", service = "hello" ),
+      ( name = "alt1", address = "foo-addr", service = (name = "hello", entrypoint = "foo")),
+      ( name = "metrics", address = "metrics-addr", service = "metrics" )
+    ]
+  ))"_kj);
+
+  test.start();
+
+  {
+    auto conn = test.connect("test-addr");
+    conn.httpGet200("/", "hello from default entrypoint");
+    conn.httpGet200("/", "hello from default entrypoint");
+  }
+
+  {
+    auto conn = test.connect("foo-addr");
+    conn.httpGet200("/", "hello from foo entrypoint");
+  }
+
+  auto conn = test.connect("metrics-addr");
+  conn.sendHttpGet("/metrics");
+  auto response = conn.recvAll();
+
+  KJ_EXPECT(response.startsWith(
+      "HTTP/1.1 200 OK\n"
+      "Content-Length: "), response);
+  auto contains = [&](kj::StringPtr text) {
+    return strstr(response.cStr(), text.cStr()) != nullptr;
+  };
+  auto expectLine = [&](kj::StringPtr line) {
+    KJ_EXPECT(contains(kj::str("\n", line, "\n")), line, response);
+  };
+
+  expectLine("Content-Type: text/plain; version=0.0.4");
+  expectLine("# TYPE workerd_requests_total counter");
+  expectLine("workerd_requests_total{worker=\"hello\",entrypoint=\"default\"} 2");
+  expectLine("workerd_requests_total{worker=\"hello\",entrypoint=\"foo\"} 1");
+  expectLine("workerd_request_failures_total{worker=\"hello\",entrypoint=\"default\"} 0");
+  expectLine("workerd_subrequests_total{worker=\"hello\",entrypoint=\"foo\"} 0");
+  expectLine("# TYPE workerd_request_duration_seconds histogram");
+  expectLine("workerd_request_duration_seconds_bucket"
+      "{worker=\"hello\",entrypoint=\"default\",le=\"+Inf\"} 2");
+  expectLine("workerd_request_duration_seconds_count{worker=\"hello\",entrypoint=\"foo\"} 1");
+  expectLine("# TYPE workerd_request_js_seconds histogram");
+  expectLine("# TYPE workerd_isolate_heap_used_bytes gauge");
+  expectLine("# TYPE workerd_isolate_lock_wait_seconds histogram");
+  expectLine("# TYPE workerd_isolate_lock_hold_seconds histogram");
+  expectLine("# TYPE workerd_isolate_lock_coalesced_total counter");
+
+  // The metrics service itself is not a Worker, and has no metrics.
+  KJ_EXPECT(!contains("worker=\"metrics\""), response);
+}
+
 KJ_TEST("Server: invalid entrypoint") {
   TestServer test(R"((
     services = [
@@ -1482,6 +1567,122 @@ KJ_TEST("Server: Ephemeral Objects") {
       "http://foo/bar: http://foo/bar 2");
 }
 
+KJ_TEST("Server: Ephemeral Objects are evicted when idle") {
+  TestServer test(R"((
+    services = [
+      ( name = "hello",
+        worker = (
+          compatibilityDate = "2022-08-17",
+          modules = [
+            ( name = "main.js",
+              esModule =
+                `export default {
+                `  async fetch(request, env) {
+                `    let actor = env.ns.get(request.url)
+                `    return await actor.fetch(request)
+                `  }
+                `}
+                `export class MyActorClass {
+                `  constructor(state, env) {
+                `    this.id = state.id;
+                `    this.count = 0;
+                `  }
+                `  async fetch(request) {
+                `    return new Response(this.id + ": " + request.url + " " + this.count++);
+                `  }
+                `}
+            )
+          ],
+          bindings = [(name = "ns", durableObjectNamespace = "MyActorClass")],
+          durableObjectNamespaces = [
+            ( className = "MyActorClass",
+              ephemeralLocal = void,
+              idleTimeoutMs = 10000,
+            )
+          ],
+          durableObjectStorage = (inMemory = void)
+        )
+      ),
+      ( name = "metrics", metrics = void ),
+    ],
+    sockets = [
+      ( name = "main",
+        address = "test-addr",
+        service = "hello"
+      ),
+      ( name = "metrics", address = "metrics-addr", service = "metrics" )
+    ]
+  ))"_kj);
+
+  test.server.allowExperimental();
+  test.start();
+  auto conn = test.connect("test-addr");
+  conn.httpGet200("/",
+      "http://foo/: http://foo/ 0");
+  conn.httpGet200("/",
+      "http://foo/: http://foo/ 1");
+
+  // Not idle for long enough yet, so the object keeps its state.
+  test.ws.poll();
+  test.timer.advanceTo(test.timer.now() + 5 * kj::SECONDS);
+  test.ws.poll();
+  conn.httpGet200("/",
+      "http://foo/: http://foo/ 2");
+
+  auto expectActorMetrics = [&](uint live, uint evicted) {
+    auto metricsConn = test.connect("metrics-addr");
+    metricsConn.sendHttpGet("/metrics");
+    auto response = metricsConn.recvAll();
+    auto expectLine = [&](kj::StringPtr line) {
+      KJ_EXPECT(strstr(response.cStr(), kj::str("\n", line, "\n").cStr()) != nullptr,
+                line, response);
+    };
+    expectLine("# TYPE workerd_actors_live gauge");
+    expectLine(kj::str("workerd_actors_live{worker=\"hello\"} ", live));
+    expectLine("# TYPE workerd_actors_evicted_total counter");
+    expectLine(kj::str("workerd_actors_evicted_total{worker=\"hello\"} ", evicted));
+  };
+  expectActorMetrics(1, 0);
+
+  // After the idle timeout, the object is evicted and reconstructed on the next request.
+  test.ws.poll();
+  test.timer.advanceTo(test.timer.now() + 20 * kj::SECONDS);
+  test.ws.poll();
+  expectActorMetrics(0, 1);
+  conn.httpGet200("/",
+      "http://foo/: http://foo/ 0");
+  expectActorMetrics(1, 1);
+}
+
+KJ_TEST("Server: Durable Object idle timeout requires on-disk storage") {
+  TestServer test(R"((
+    services = [
+      ( name = "hello",
+        worker = (
+          compatibilityDate = "2022-08-17",
+          modules = [
+            ( name = "main.js",
+              esModule = `export class MyActorClass {}
+            )
+          ],
+          durableObjectNamespaces = [
+            ( className = "MyActorClass",
+              uniqueKey = "mykey",
+              idleTimeoutMs = 10000,
+            )
+          ],
+          durableObjectStorage = (inMemory = void)
+        )
+      ),
+    ]
+  ))"_kj);
+
+  test.expectErrors(
+      "Worker service \"hello\" sets `idleTimeoutMs` on a durable object namespace but has "
+          "`durableObjectStorage` set to `inMemory`. Evicting an object would lose its storage, "
+          "so `idleTimeoutMs` requires `localDisk` storage.\n");
+}
+
 // =======================================================================================
 // Test HttpOptions on receive
 
@@ -23,6 +23,7 @@
 #include <workerd/io/actor-sqlite.h>
 #include <workerd/api/actor-state.h>
 #include "workerd-api.h"
+#include "metrics.h"
 
 namespace workerd::server {
 
@@ -965,6 +966,85 @@ kj::Own<Server::Service> Server::makeDiskDirectoryService(
 
 // =======================================================================================
 
+class Server::MetricsService final: public Service, private WorkerInterface {
+  // Service used when the service is configured as a metrics service. Answers GET requests for
+  // any path with the process's metrics, in the Prometheus text exposition format.
+
+public:
+  MetricsService(MetricsRegistry& registry, kj::HttpHeaderTable::Builder& headerTableBuilder)
+      : registry(registry), headerTable(headerTableBuilder.getFutureTable()) {}
+
+  kj::Own<WorkerInterface> startRequest(IoChannelFactory::SubrequestMetadata metadata) override {
+    return { this, kj::NullDisposer::instance };
+  }
+
+  bool hasHandler(kj::StringPtr handlerName) override {
+    return handlerName == "fetch"_kj;
+  }
+
+private:
+  MetricsRegistry& registry;
+  kj::HttpHeaderTable& headerTable;
+
+  kj::Promise<void> request(
+      kj::HttpMethod method, kj::StringPtr urlStr, const kj::HttpHeaders& headers,
+      kj::AsyncInputStream& requestBody, kj::HttpService::Response& response) override {
+    if (method != kj::HttpMethod::GET && method != kj::HttpMethod::HEAD) {
+      return response.sendError(405, "Method Not Allowed", headerTable);
+    }
+
+    auto content = registry.render();
+
+    kj::HttpHeaders responseHeaders(headerTable);
+    responseHeaders.set(kj::HttpHeaderId::CONTENT_TYPE, "text/plain; version=0.0.4");
+    auto out = response.send(200, "OK", responseHeaders, content.size());
+
+    if (method == kj::HttpMethod::HEAD) {
+      return kj::READY_NOW;
+    } else {
+      return out->write(content.begin(), content.size())
+          .attach(kj::mv(content), kj::mv(out));
+    }
+  }
+
+  kj::Promise<void> connect(kj::StringPtr host, const kj::HttpHeaders& headers,
+      kj::AsyncIoStream& connection, kj::HttpService::ConnectResponse& response,
+      kj::HttpConnectSettings settings) override {
+    throwUnsupported();
+  }
+  void prewarm(kj::StringPtr url) override {}
+  kj::Promise<ScheduledResult> runScheduled(kj::Date scheduledTime, kj::StringPtr cron) override {
+    throwUnsupported();
+  }
+  kj::Promise<AlarmResult> runAlarm(kj::Date scheduledTime) override {
+    throwUnsupported();
+  }
+  kj::Promise<CustomEvent::Result> customEvent(kj::Own<CustomEvent> event) override {
+    throwUnsupported();
+  }
+
+  [[noreturn]] void throwUnsupported() {
+    JSG_FAIL_REQUIRE(Error, "Metrics services don't support this event type.");
+  }
+};
+
+MetricsRegistry& Server::getMetricsRegistry() {
+  KJ_IF_MAYBE(r, sharedMetrics) {
+    return *r;
+  } else KJ_IF_MAYBE(r, ownMetrics) {
+    return **r;
+  } else {
+    return *ownMetrics.emplace(kj::heap<MetricsRegistry>());
+  }
+}
+
+kj::Own<Server::Service> Server::makeMetricsService(
+    kj::HttpHeaderTable::Builder& headerTableBuilder) {
+  return kj::heap<MetricsService>(getMetricsRegistry(), headerTableBuilder);
+}
+
+// =======================================================================================
+
 class Server::InspectorService final: public kj::HttpService, public kj::HttpServerErrorHandler {
   // Implements the interface for the devtools inspector protocol.
   //
@@ -1168,12 +1248,17 @@ public:
                 kj::Maybe<kj::HashSet<kj::String>> defaultEntrypointHandlers,
                 kj::HashMap<kj::String, kj::HashSet<kj::String>> namedEntrypointsParam,
                 const kj::HashMap<kj::String, ActorConfig>& actorClasses,
-                LinkCallback linkCallback)
+                LinkCallback linkCallback,
+                kj::Maybe<const kj::Directory&> spillDirectory, size_t spillThreshold,
+                kj::Maybe<WorkerMetrics&> metrics)
       : threadContext(threadContext),
+        spillDirectory(spillDirectory),
+        spillThreshold(spillThreshold),
         ioChannels(kj::mv(linkCallback)),
         worker(kj::mv(worker)),
         defaultEntrypointHandlers(kj::mv(defaultEntrypointHandlers)),
-        waitUntilTasks(*this) {
+        waitUntilTasks(*this),
+        metrics(metrics) {
     namedEntrypoints.reserve(namedEntrypointsParam.size());
     for (auto& ep: namedEntrypointsParam) {
       kj::StringPtr epPtr = ep.key;
@@ -1182,8 +1267,22 @@ public:
 
     actorNamespaces.reserve(actorClasses.size());
     for (auto& entry: actorClasses) {
-      ActorNamespace ns(*this, entry.key, entry.value);
-      actorNamespaces.insert(entry.key, kj::mv(ns));
+      actorNamespaces.insert(entry.key, kj::heap<ActorNamespace>(*this, entry.key, entry.value));
+    }
+
+    KJ_IF_MAYBE(m, metrics) {
+      // Requests to actors name their class as the entrypoint.
+      defaultEntrypointMetrics = m->addEntrypoint("default"_kj);
+      for (auto& ep: namedEntrypoints) {
+        auto& epMetrics = m->addEntrypoint(ep.key);
+        entrypointMetrics.insert(epMetrics.getName(), &epMetrics);
+      }
+      for (auto& entry: actorClasses) {
+        entrypointMetrics.findOrCreate(entry.key, [&]() {
+          auto& epMetrics = m->addEntrypoint(entry.key);
+          return decltype(entrypointMetrics)::Entry { epMetrics.getName(), &epMetrics };
+        });
+      }
     }
   }
 
@@ -1202,7 +1301,9 @@ public:
   }
 
   kj::Maybe<ActorNamespace&> getActorNamespace(kj::StringPtr name) {
-    return actorNamespaces.find(name);
+    return actorNamespaces.find(name).map([](kj::Own<ActorNamespace>& ns) -> ActorNamespace& {
+      return *ns;
+    });
   }
 
   kj::Own<WorkerInterface> startRequest(
@@ -1221,25 +1322,36 @@ public:
   kj::Own<WorkerInterface> startRequest(
       IoChannelFactory::SubrequestMetadata metadata, kj::Maybe<kj::StringPtr> entrypointName,
       kj::Maybe<kj::Own<Worker::Actor>> actor = nullptr) {
+    kj::Own<LimitEnforcer> limitEnforcer;
+    kj::Own<RequestObserver> observer;
+    KJ_IF_MAYBE(m, getEntrypointMetrics(entrypointName)) {
+      limitEnforcer = kj::heap<MeteredLimitEnforcer>(*this);
+      observer = kj::refcounted<RequestMetrics>(*m);
+    } else {
+      limitEnforcer = kj::Own<LimitEnforcer>(this, kj::NullDisposer::instance);
+      observer = kj::refcounted<RequestObserver>();  // default observer makes no observations
+    }
+
     return WorkerEntrypoint::construct(
         threadContext,
         kj::atomicAddRef(*worker),
         entrypointName,
         kj::mv(actor),
-        kj::Own<LimitEnforcer>(this, kj::NullDisposer::instance),
+        kj::mv(limitEnforcer),
         {},                        // ioContextDependency
         kj::Own<IoChannelFactory>(this, kj::NullDisposer::instance),
-        kj::refcounted<RequestObserver>(),  // default observer makes no observations
+        kj::mv(observer),
         waitUntilTasks,
         true,                      // tunnelExceptions
         nullptr,                   // workerTracer
         kj::mv(metadata.cfBlobJson));
   }
 
-  class ActorNamespace {
+  class ActorNamespace final: private kj::TaskSet::ErrorHandler {
   public:
     ActorNamespace(WorkerService& service, kj::StringPtr className, const ActorConfig& config)
-        : service(service), className(className), config(config) {}
+        : service(service), className(className), config(config),
+          idleTimeout(getIdleTimeout(config)), evictionTasks(*this) {}
 
     const ActorConfig& getConfig() { return config; }
 
@@ -1262,7 +1374,10 @@ public:
           }
         }
 
-        auto actor = kj::addRef(*actors.findOrCreate(idStr, [&]() {
+        auto& container = *actors.findOrCreate(idStr, [&]() {
+          auto container = kj::heap<ActorContainer>(*this, kj::mv(idStr));
+          kj::StringPtr key = container->getKey();
+
           auto& channels = KJ_ASSERT_NONNULL(service.ioChannels.tryGet<LinkedIoChannels>());
 
           auto makeActorCache =
@@ -1271,7 +1386,7 @@ public:
                 .map([&](const Durable& d) -> kj::Own<ActorCacheInterface> {
               KJ_IF_MAYBE(as, channels.actorStorage) {
                 return kj::heap<ActorSqlite>(**as,
-                    kj::Path({d.uniqueKey, kj::str(idStr, ".sqlite")}));
+                    kj::Path({d.uniqueKey, kj::str(key, ".sqlite")}), outputGate);
               } else {
                 // Create an ActorCache backed by a fake, empty storage. Elsewhere, we configure
                 // ActorCache never to flush, so this effectively creates in-memory storage.
@@ -1291,29 +1406,122 @@ public:
           TimerChannel& timerChannel = service;
 
           Worker::Lock lock(*service.worker, asyncLock);
-          auto newActor = kj::refcounted<Worker::Actor>(
-              *service.worker, nullptr, kj::mv(id), true, kj::mv(makeActorCache),
-              className, kj::mv(makeStorage), lock,
+          container->actor = kj::refcounted<Worker::Actor>(
+              *service.worker, container->getTracker(), kj::mv(id), true,
+              kj::mv(makeActorCache), className, kj::mv(makeStorage), lock,
               timerChannel, kj::refcounted<ActorObserver>());
 
-          // TODO(sqlite): Now that actors are backed by real disk, we should shut them down after
-          //   a minute of inactivity...
-          return kj::HashMap<kj::String, kj::Own<Worker::Actor>>::Entry {
-            kj::mv(idStr), kj::mv(newActor)
+          KJ_IF_MAYBE(m, service.metrics) {
+            m->liveActors.add();
+          }
+
+          return kj::HashMap<kj::StringPtr, kj::Own<ActorContainer>>::Entry {
+            key, kj::mv(container)
           };
-        }));
+        });
 
-        return kj::heap<ActorChannelImpl>(service, className, kj::mv(actor));
+        // Actor::addRef() registers the reference with the container's RequestTracker, so the
+        // actor is considered active for as long as the channel (i.e. the stub) exists.
+        return kj::heap<ActorChannelImpl>(service, className, container.getActor().addRef());
       });
 
       return kj::heap<PromisedActorChannel>(service.waitUntilTasks, kj::mv(promise));
     }
 
   private:
+    class ActorContainer final: public RequestTracker::Hooks {
+      // Holds one in-memory actor. Tracks whether the actor has any outstanding requests or stubs,
+      // and evicts it from the namespace once it has been idle for the namespace's idle timeout.
+
+    public:
+      ActorContainer(ActorNamespace& ns, kj::String key)
+          : ns(ns), key(kj::mv(key)), tracker(*this) {}
+
+      kj::StringPtr getKey() { return key; }
+      RequestTracker& getTracker() { return tracker; }
+      Worker::Actor& getActor() { return *KJ_ASSERT_NONNULL(actor); }
+
+      kj::Maybe<kj::Own<Worker::Actor>> actor;
+      // Set immediately after construction. This reference is not counted by `tracker`.
+
+      void active() override {
+        ++generation;
+        idleTimer = nullptr;
+      }
+
+      void inactive() override {
+        uint64_t currentGeneration = ++generation;
+        KJ_IF_MAYBE(timeout, ns.idleTimeout) {
+          idleTimer = ns.service.threadContext.getUnsafeTimer().afterDelay(*timeout)
+              .then([this, currentGeneration]() {
+            // Evicting destroys this container, and with it this promise, so we can't do it from
+            // inside the callback. Defer it to a separate task instead.
+            ns.evictionTasks.add(kj::evalLater(
+                [&ns = ns, key = kj::str(key), currentGeneration]() {
+              ns.evictIfIdle(key, currentGeneration);
+            }));
+          }).eagerlyEvaluate(nullptr);
+        }
+      }
+
+      uint64_t getGeneration() { return generation; }
+
+    private:
+      ActorNamespace& ns;
+      kj::String key;
+      RequestTracker tracker;
+
+      uint64_t generation = 0;
+      // Incremented on every transition between active and inactive, so that a pending eviction
+      // can tell whether the actor has been used since the idle timer started.
+
+      kj::Maybe<kj::Promise<void>> idleTimer;
+    };
+
     WorkerService& service;
     kj::StringPtr className;
     const ActorConfig& config;
-    kj::HashMap<kj::String, kj::Own<Worker::Actor>> actors;
+    kj::Maybe<kj::Duration> idleTimeout;
+    kj::HashMap<kj::StringPtr, kj::Own<ActorContainer>> actors;
+    // Keys point into the `ActorContainer`s.
+
+    kj::TaskSet evictionTasks;
+
+    static kj::Maybe<kj::Duration> getIdleTimeout(const ActorConfig& config) {
+      KJ_SWITCH_ONEOF(config) {
+        KJ_CASE_ONEOF(durable, Durable) {
+          return durable.idleTimeout;
+        }
+        KJ_CASE_ONEOF(ephemeral, Ephemeral) {
+          return ephemeral.idleTimeout;
+        }
+      }
+      KJ_UNREACHABLE;
+    }
+
+    void evictIfIdle(kj::StringPtr key, uint64_t generation) {
+      auto& entry = KJ_UNWRAP_OR(actors.findEntry(key), return);
+      if (entry.value->getGeneration() != generation) {
+        // The actor was used again since the idle timer was started.
+        return;
+      }
+
+      auto actor = kj::mv(KJ_ASSERT_NONNULL(entry.value->actor));
+      actors.erase(entry);
+      KJ_IF_MAYBE(m, service.metrics) {
+        m->liveActors.sub();
+        m->evictedActors.add();
+      }
+
+      // Cancels any background work and shuts down the actor's storage. The actor itself is
+      // destroyed when `actor` goes out of scope, unless something still holds a reference to it,
+      // in which case a subsequent getActor() will construct a fresh instance regardless.
+      actor->shutdown(0);
+    }
+
+    void taskFailed(kj::Exception&& exception) override {
+      KJ_LOG(ERROR, exception);
+    }
   };
 
 private:
@@ -1339,6 +1547,8 @@ private:
   };
 
   ThreadContext& threadContext;
+  kj::Maybe<const kj::Directory&> spillDirectory;
+  size_t spillThreshold;
 
   kj::OneOf<LinkCallback, LinkedIoChannels> ioChannels;
   // LinkedIoChannels owns the SqliteDatabase::Vfs, so make sure it is destroyed last.
@@ -1346,9 +1556,37 @@ private:
   kj::Own<const Worker> worker;
   kj::Maybe<kj::HashSet<kj::String>> defaultEntrypointHandlers;
   kj::HashMap<kj::String, EntrypointService> namedEntrypoints;
-  kj::HashMap<kj::StringPtr, ActorNamespace> actorNamespaces;
+  kj::HashMap<kj::StringPtr, kj::Own<ActorNamespace>> actorNamespaces;
   kj::TaskSet waitUntilTasks;
 
+  kj::Maybe<WorkerMetrics&> metrics;
+  kj::Maybe<EntrypointMetrics&> defaultEntrypointMetrics;
+  kj::HashMap<kj::StringPtr, EntrypointMetrics*> entrypointMetrics;
+  // Null and empty unless the config has a `metrics` service.
+
+  kj::TimePoint nextHeapSample = kj::origin<kj::TimePoint>();
+
+  kj::Maybe<EntrypointMetrics&> getEntrypointMetrics(kj::Maybe<kj::StringPtr> entrypointName) {
+    KJ_IF_MAYBE(name, entrypointName) {
+      KJ_IF_MAYBE(epMetrics, entrypointMetrics.find(*name)) {
+        return **epMetrics;
+      }
+    }
+    // (An unknown entrypoint name will fail the request anyway. Count it against the default.)
+    return defaultEntrypointMetrics;
+  }
+
+  void sampleHeap(jsg::Lock& lock, kj::TimePoint now) {
+    // Records the isolate's heap size, at most once a second, since gathering heap statistics
+    // takes a little while.
+    if (now < nextHeapSample) return;
+    nextHeapSample = now + 1 * kj::SECONDS;
+
+    v8::HeapStatistics stats;
+    lock.v8Isolate->GetHeapStatistics(&stats);
+    KJ_ASSERT_NONNULL(metrics).heapUsedBytes.set(stats.used_heap_size());
+  }
+
   class ActorChannelImpl final: public IoChannelFactory::ActorChannel {
   public:
     ActorChannelImpl(WorkerService& service, kj::StringPtr className, kj::Own<Worker::Actor> actor)
@@ -1356,7 +1594,7 @@ private:
 
     kj::Own<WorkerInterface> startRequest(
         IoChannelFactory::SubrequestMetadata metadata) override {
-      return service.startRequest(kj::mv(metadata), className, kj::addRef(*actor));
+      return service.startRequest(kj::mv(metadata), className, actor->addRef());
     }
 
   private:
@@ -1545,10 +1783,71 @@ private:
   kj::Promise<void> limitDrain() override { return kj::NEVER_DONE; }
   kj::Promise<void> limitScheduled() override { return kj::NEVER_DONE; }
   size_t getBufferingLimit() override { return kj::maxValue; }
+  kj::Maybe<const kj::Directory&> getSpillDirectory() override { return spillDirectory; }
+  size_t getSpillThreshold() override { return spillThreshold; }
   kj::Maybe<EventOutcome> getLimitsExceeded() override { return nullptr; }
   kj::Promise<void> onLimitsExceeded() override { return kj::NEVER_DONE; }
   void requireLimitsNotExceeded() override {}
   void reportMetrics(RequestObserver& requestMetrics) override {}
+
+  class MeteredLimitEnforcer final: public LimitEnforcer {
+    // The LimitEnforcer of each request when metrics are enabled, in place of the WorkerService
+    // itself. Enforces no limits either, but measures how long JavaScript runs for and attributes
+    // the time to the request in reportMetrics().
+    //
+    // TODO(someday): Measure thread CPU time rather than wall time, like production does.
+
+  public:
+    explicit MeteredLimitEnforcer(WorkerService& service): service(service) {}
+
+    kj::Own<void> enterJs(jsg::Lock& lock) override {
+      auto now = kj::systemPreciseMonotonicClock().now();
+      service.sampleHeap(lock, now);
+      jsStart = now;
+
+      // Point the returned Own at ourselves, with a disposer that stops the clock, so as not to
+      // allocate every time JavaScript is entered.
+      static const JsExitDisposer disposer;
+      return kj::Own<void>(this, disposer);
+    }
+
+    void topUpActor() override { inner().topUpActor(); }
+    void newSubrequest(bool isInHouse) override { inner().newSubrequest(isInHouse); }
+    void newKvRequest(KvOpType op) override { inner().newKvRequest(op); }
+    void newAnalyticsEngineRequest() override { inner().newAnalyticsEngineRequest(); }
+    kj::Promise<void> limitDrain() override { return inner().limitDrain(); }
+    kj::Promise<void> limitScheduled() override { return inner().limitScheduled(); }
+    size_t getBufferingLimit() override { return inner().getBufferingLimit(); }
+    kj::Maybe<const kj::Directory&> getSpillDirectory() override {
+      return inner().getSpillDirectory();
+    }
+    size_t getSpillThreshold() override { return inner().getSpillThreshold(); }
+    kj::Maybe<EventOutcome> getLimitsExceeded() override { return inner().getLimitsExceeded(); }
+    kj::Promise<void> onLimitsExceeded() override { return inner().onLimitsExceeded(); }
+    void requireLimitsNotExceeded() override { inner().requireLimitsNotExceeded(); }
+
+    void reportMetrics(RequestObserver& requestMetrics) override {
+      // Every request to a WorkerService with metrics enabled is observed by a RequestMetrics.
+      kj::downcast<RequestMetrics>(requestMetrics).addJsTime(jsTime);
+      jsTime = 0 * kj::NANOSECONDS;
+    }
+
+  private:
+    WorkerService& service;
+    kj::TimePoint jsStart = kj::origin<kj::TimePoint>();
+    kj::Duration jsTime = 0 * kj::NANOSECONDS;
+    // Time spent in JavaScript since the last reportMetrics().
+
+    LimitEnforcer& inner() { return service; }
+
+    class JsExitDisposer final: public kj::Disposer {
+    public:
+      void disposeImpl(void* pointer) const override {
+        auto& self = *reinterpret_cast<MeteredLimitEnforcer*>(pointer);
+        self.jsTime += kj::systemPreciseMonotonicClock().now() - self.jsStart;
+      }
+    };
+  };
 };
 
 struct FutureSubrequestChannel {
@@ -1857,23 +2156,15 @@ kj::Own<Server::Service> Server::makeWorker(kj::StringPtr name, config::Worker::
   }
 
   class NullIsolateLimitEnforcer final: public IsolateLimitEnforcer {
-    // IsolateLimitEnforcer that enforces no limits.
+    // IsolateLimitEnforcer that enforces no limits, other than the configured actor cache limit.
   public:
+    NullIsolateLimitEnforcer(ActorCacheSharedLruOptions actorCacheLruOptions)
+        : actorCacheLruOptions(actorCacheLruOptions) {}
+
     v8::Isolate::CreateParams getCreateParams() override { return {}; }
     void customizeIsolate(v8::Isolate* isolate) override {}
     ActorCacheSharedLruOptions getActorCacheLruOptions() override {
-      // TODO(someday): Make this configurable?
-      return {
-        .softLimit = 16 * (1ull << 20), // 16 MiB
-        .hardLimit = 128 * (1ull << 20), // 128 MiB
-        .staleTimeout = 30 * kj::SECONDS,
-        .dirtyListByteLimit = 8 * (1ull << 20), // 8 MiB
-        .maxKeysPerRpc = 128,
-
-        // For now, we use `neverFlush` to implement in-memory-only actors.
-        // See WorkerService::getActor().
-        .neverFlush = true
-      };
+      return actorCacheLruOptions;
     }
     kj::Own<void> enterStartupJs(
         jsg::Lock& lock, kj::Maybe<kj::Exception>& error) const override {
@@ -1894,14 +2185,43 @@ kj::Own<Server::Service> Server::makeWorker(kj::StringPtr name, config::Worker::
     void completedRequest(kj::StringPtr id) const override {}
     bool exitJs(jsg::Lock& lock) const override { return false; }
     void reportMetrics(IsolateObserver& isolateMetrics) const override {}
+
+  private:
+    ActorCacheSharedLruOptions actorCacheLruOptions;
   };
 
-  auto limitEnforcer = kj::heap<NullIsolateLimitEnforcer>();
+  auto limitEnforcer = kj::heap<NullIsolateLimitEnforcer>(ActorCacheSharedLruOptions {
+    // With `neverFlush`, nothing in the cache ever becomes clean, so nothing can be evicted and
+    // the soft limit and stale timeout have no effect. Only the hard limit is configurable.
+    .softLimit = 16 * (1ull << 20), // 16 MiB
+    .hardLimit = conf.getDurableObjectCacheLimits().getHardLimitBytes(),
+    .staleTimeout = 30 * kj::SECONDS,
+    .dirtyListByteLimit = 8 * (1ull << 20), // 8 MiB
+    .maxKeysPerRpc = 128,
+
+    // For now, we use `neverFlush` to implement in-memory-only actors.
+    // See WorkerService::getActor().
+    .neverFlush = true
+  });
+  kj::Maybe<const jsg::ModuleCodeCache&> maybeCodeCache = precompiledCodeCache;
+  KJ_IF_MAYBE(c, codeCache) {
+    maybeCodeCache = **c;
+  }
   auto api = kj::heap<WorkerdApiIsolate>(globalContext->v8System,
-      featureFlags.asReader(), *limitEnforcer);
+      featureFlags.asReader(), *limitEnforcer, maybeCodeCache);
+  kj::Maybe<WorkerMetrics&> workerMetrics;
+  kj::Own<IsolateObserver> isolateObserver;
+  KJ_IF_MAYBE(shard, metricsShard) {
+    auto& metrics = shard->addWorker(name);
+    workerMetrics = metrics;
+    isolateObserver = kj::atomicRefcounted<IsolateMetrics>(*shard, metrics);
+  } else {
+    isolateObserver = kj::atomicRefcounted<IsolateObserver>();
+  }
+
   auto isolate = kj::atomicRefcounted<Worker::Isolate>(
       kj::mv(api),
-      kj::atomicRefcounted<IsolateObserver>(),
+      kj::mv(isolateObserver),
       name,
       kj::mv(limitEnforcer),
       // For workerd, if the inspector is enabled, it is always fully trusted.
@@ -2021,7 +2341,10 @@ kj::Own<Server::Service> Server::makeWorker(kj::StringPtr name, config::Worker::
   return kj::heap<WorkerService>(globalContext->threadContext, kj::mv(worker),
                                  kj::mv(errorReporter.defaultEntrypoint),
                                  kj::mv(errorReporter.namedEntrypoints), localActorConfigs,
-                                 kj::mv(linkCallback));
+                                 kj::mv(linkCallback),
+                                 spillDirectory.map([](kj::Own<const kj::Directory>& dir)
+                                     -> const kj::Directory& { return *dir; }),
+                                 spillThreshold, workerMetrics);
 }
 
 // =======================================================================================
@@ -2049,6 +2372,9 @@ kj::Own<Server::Service> Server::makeService(
 
     case config::Service::DISK:
       return makeDiskDirectoryService(name, conf.getDisk(), headerTableBuilder);
+
+    case config::Service::METRICS:
+      return makeMetricsService(headerTableBuilder);
   }
 
   reportConfigError(kj::str(
@@ -2323,6 +2649,32 @@ void Server::startServices(jsg::V8System& v8System, config::Config::Reader confi
     }).exclusiveJoin(forkedDrainWhen.addBranch()));
   }
 
+  // ---------------------------------------------------------------------------
+  // Configure code cache.
+
+  KJ_IF_MAYBE(path, codeCachePath) {
+    KJ_IF_MAYBE(dir, fs.getRoot().tryOpenSubdir(fs.getCurrentPath().evalNative(*path),
+        kj::WriteMode::CREATE | kj::WriteMode::MODIFY | kj::WriteMode::CREATE_PARENT)) {
+      codeCache = kj::heap<DiskModuleCodeCache>(kj::mv(*dir));
+    } else {
+      reportConfigError(kj::str("Couldn't open code cache directory: ", *path));
+    }
+  }
+
+  // ---------------------------------------------------------------------------
+  // Configure spill directory.
+
+  if (config.hasSpillDirectory()) {
+    auto path = config.getSpillDirectory();
+    KJ_IF_MAYBE(dir, fs.getRoot().tryOpenSubdir(fs.getCurrentPath().evalNative(path),
+        kj::WriteMode::CREATE | kj::WriteMode::MODIFY | kj::WriteMode::CREATE_PARENT)) {
+      spillDirectory = kj::mv(*dir);
+      spillThreshold = config.getSpillThresholdBytes();
+    } else {
+      reportConfigError(kj::str("Couldn't open spill directory: ", path));
+    }
+  }
+
   // ---------------------------------------------------------------------------
   // Configure services
 
@@ -2334,12 +2686,19 @@ void Server::startServices(jsg::V8System& v8System, config::Config::Reader confi
     if (serviceConf.isWorker()) {
       auto workerConf = serviceConf.getWorker();
       bool hadDurable = false;
+      bool hadDurableIdleTimeout = false;
       for (auto ns: workerConf.getDurableObjectNamespaces()) {
+        kj::Maybe<kj::Duration> idleTimeout;
+        if (ns.getIdleTimeoutMs() > 0) {
+          idleTimeout = ns.getIdleTimeoutMs() * kj::MILLISECONDS;
+        }
+
         switch (ns.which()) {
           case config::Worker::DurableObjectNamespace::UNIQUE_KEY:
             hadDurable = true;
+            hadDurableIdleTimeout = hadDurableIdleTimeout || idleTimeout != nullptr;
             serviceActorConfigs.insert(kj::str(ns.getClassName()),
-                Durable { kj::str(ns.getUniqueKey()) });
+                Durable { kj::str(ns.getUniqueKey()), idleTimeout });
             continue;
           case config::Worker::DurableObjectNamespace::EPHEMERAL_LOCAL:
             if (!experimental) {
@@ -2348,7 +2707,7 @@ void Server::startServices(jsg::V8System& v8System, config::Config::Reader confi
                   "experimental feature which may change or go away in the future. You must run "
                   "workerd with `--experimental` to use this feature."));
             }
-            serviceActorConfigs.insert(kj::str(ns.getClassName()), Ephemeral {});
+            serviceActorConfigs.insert(kj::str(ns.getClassName()), Ephemeral { idleTimeout });
             continue;
         }
         reportConfigError(kj::str(
@@ -2366,6 +2725,13 @@ void Server::startServices(jsg::V8System& v8System, config::Config::Reader confi
           }
           goto validDurableObjectStorage;
         case config::Worker::DurableObjectStorage::IN_MEMORY:
+          if (hadDurableIdleTimeout) {
+            reportConfigError(kj::str(
+                "Worker service \"", name, "\" sets `idleTimeoutMs` on a durable object "
+                "namespace but has `durableObjectStorage` set to `inMemory`. Evicting an object "
+                "would lose its storage, so `idleTimeoutMs` requires `localDisk` storage."));
+          }
+          goto validDurableObjectStorage;
         case config::Worker::DurableObjectStorage::LOCAL_DISK:
           goto validDurableObjectStorage;
       }
@@ -2386,6 +2752,14 @@ void Server::startServices(jsg::V8System& v8System, config::Config::Reader confi
     });
   }
 
+  // Workers only record metrics if something will serve them.
+  for (auto serviceConf: config.getServices()) {
+    if (serviceConf.isMetrics()) {
+      metricsShard = getMetricsRegistry().addShard();
+      break;
+    }
+  }
+
   // Second pass: Build services.
   for (auto serviceConf: config.getServices()) {
     kj::StringPtr name = serviceConf.getName();
@@ -2420,6 +2794,11 @@ void Server::startServices(jsg::V8System& v8System, config::Config::Reader confi
   for (auto& service: services) {
     service.value->link();
   }
+
+  // All Workers' modules have been compiled by now.
+  KJ_IF_MAYBE(c, codeCache) {
+    c->get()->logStats();
+  }
 }
 
 kj::Promise<void> Server::listenOnSockets(config::Config::Reader config,
@@ -17,12 +17,17 @@ namespace kj {
 
 namespace workerd::jsg {
   class V8System;
+  class ModuleCodeCache;
 }
 
 namespace workerd::server {
 
 using kj::uint;
 
+class MetricsRegistry;
+class MetricsShard;
+class DiskModuleCodeCache;
+
 class Server: private kj::TaskSet::ErrorHandler {
   // Implements the single-tenant Workers Runtime server / CLI.
   //
@@ -53,6 +58,23 @@ public:
   void enableInspector(kj::String addr) {
     inspectorOverride = kj::mv(addr);
   }
+  void enableCodeCache(kj::String path) {
+    codeCachePath = kj::mv(path);
+  }
+  // Store V8 code cache data for worker modules in the directory at `path`, creating it if
+  // needed, so that later runs can skip compiling unchanged modules from source.
+  void usePrecompiledCodeCache(const jsg::ModuleCodeCache& cache) {
+    precompiledCodeCache = cache;
+  }
+  // Use `cache`, which must outlive the Server, for worker modules. Ignored if enableCodeCache()
+  // was also called, since the directory will be kept up-to-date with whatever V8 produces.
+
+  void shareMetrics(MetricsRegistry& registry) {
+    sharedMetrics = registry;
+  }
+  // Record metrics into `registry`, which must outlive the Server, rather than into a registry
+  // private to this Server. When serving on several threads, every thread's Server shares one
+  // registry, so that a `metrics` service on any of them reports the totals for the process.
 
   kj::Promise<void> run(jsg::V8System& v8System, config::Config::Reader conf,
                         kj::Promise<void> drainWhen = kj::NEVER_DONE);
@@ -67,9 +89,16 @@ public:
   //
   // The returned promise resolves true if at least one test ran and no tests failed.
 
-  struct Durable { kj::String uniqueKey; };
-  struct Ephemeral {};
+  struct Durable {
+    kj::String uniqueKey;
+    kj::Maybe<kj::Duration> idleTimeout;
+  };
+  struct Ephemeral {
+    kj::Maybe<kj::Duration> idleTimeout;
+  };
   using ActorConfig = kj::OneOf<Durable, Ephemeral>;
+  // `idleTimeout`, if set, is how long an object may go without requests before it is evicted
+  // from memory. It will be reconstructed the next time it is needed.
 
 private:
   kj::Filesystem& fs;
@@ -89,6 +118,24 @@ private:
   // code that parses strings from the config file.
 
   kj::Maybe<kj::String> inspectorOverride;
+  kj::Maybe<kj::String> codeCachePath;
+
+  kj::Maybe<kj::Own<DiskModuleCodeCache>> codeCache;
+  // Opened from `codeCachePath` in startServices(). Declared before `services` so that it
+  // outlives all the isolates that use it.
+
+  kj::Maybe<const jsg::ModuleCodeCache&> precompiledCodeCache;
+
+  kj::Maybe<MetricsRegistry&> sharedMetrics;
+  kj::Maybe<kj::Own<MetricsRegistry>> ownMetrics;
+  kj::Maybe<MetricsShard&> metricsShard;
+  // `metricsShard` is created in startServices() if the config has a `metrics` service, and
+  // Workers then record metrics into it; otherwise they use observers that observe nothing.
+  // `ownMetrics` is declared before `services` so that it outlives the Workers that use it.
+
+  kj::Maybe<kj::Own<const kj::Directory>> spillDirectory;
+  size_t spillThreshold = 0;
+  // From the config's `spillDirectory` and `spillThresholdBytes`, opened in startServices().
 
   struct GlobalContext;
   kj::Own<GlobalContext> globalContext;
@@ -147,6 +194,7 @@ private:
   kj::Own<Service> makeDiskDirectoryService(
       kj::StringPtr name, config::DiskDirectory::Reader conf,
       kj::HttpHeaderTable::Builder& headerTableBuilder);
+  kj::Own<Service> makeMetricsService(kj::HttpHeaderTable::Builder& headerTableBuilder);
   kj::Own<Service> makeWorker(kj::StringPtr name, config::Worker::Reader conf,
       capnp::List<config::Extension>::Reader extensions);
   kj::Own<Service> makeService(
@@ -154,6 +202,8 @@ private:
       kj::HttpHeaderTable::Builder& headerTableBuilder,
       capnp::List<config::Extension>::Reader extensions);
 
+  MetricsRegistry& getMetricsRegistry();
+
   Service& lookupService(config::ServiceDesignator::Reader designator, kj::String errorContext);
   // Can only be called in the link stage.
 
@@ -164,6 +214,7 @@ private:
   class ExternalHttpService;
   class NetworkService;
   class DiskDirectoryService;
+  class MetricsService;
   class WorkerService;
   class WorkerEntrypointService;
   class HttpListener;
@@ -21,6 +21,7 @@
 #include <workerd/api/urlpattern.h>
 #include <workerd/api/node/node.h>
 #include <workerd/util/thread-scopes.h>
+#include <kj/encoding.h>
 #include <openssl/sha.h>
 #include <openssl/hmac.h>
 #include <openssl/rand.h>
@@ -77,6 +78,7 @@ JSG_DECLARE_ISOLATE_TYPE(JsgWorkerdIsolate,
 struct WorkerdApiIsolate::Impl {
   kj::Own<CompatibilityFlags::Reader> features;
   JsgWorkerdIsolate jsgIsolate;
+  kj::Maybe<const jsg::ModuleCodeCache&> codeCache;
 
   class Configuration {
   public:
@@ -95,9 +97,11 @@ struct WorkerdApiIsolate::Impl {
 
   Impl(jsg::V8System& v8System,
        CompatibilityFlags::Reader featuresParam,
-       IsolateLimitEnforcer& limitEnforcer)
+       IsolateLimitEnforcer& limitEnforcer,
+       kj::Maybe<const jsg::ModuleCodeCache&> codeCache)
       : features(capnp::clone(featuresParam)),
-        jsgIsolate(v8System, Configuration(*this), limitEnforcer.getCreateParams()) {}
+        jsgIsolate(v8System, Configuration(*this), limitEnforcer.getCreateParams()),
+        codeCache(codeCache) {}
 
   static v8::Local<v8::String> compileTextGlobal(JsgWorkerdIsolate::Lock& lock,
       capnp::Text::Reader reader) {
@@ -135,8 +139,9 @@ struct WorkerdApiIsolate::Impl {
 
 WorkerdApiIsolate::WorkerdApiIsolate(jsg::V8System& v8System,
     CompatibilityFlags::Reader features,
-    IsolateLimitEnforcer& limitEnforcer)
-    : impl(kj::heap<Impl>(v8System, features, limitEnforcer)) {}
+    IsolateLimitEnforcer& limitEnforcer,
+    kj::Maybe<const jsg::ModuleCodeCache&> codeCache)
+    : impl(kj::heap<Impl>(v8System, features, limitEnforcer, codeCache)) {}
 WorkerdApiIsolate::~WorkerdApiIsolate() noexcept(false) {}
 
 kj::Own<jsg::Lock> WorkerdApiIsolate::lock() const {
@@ -316,7 +321,8 @@ kj::Own<jsg::ModuleRegistry> WorkerdApiIsolate::compileModules(
                 module.getName(),
                 module.getEsModule(),
                 jsg::ModuleInfoCompileOption::BUNDLE,
-                *observer));
+                *observer,
+                impl->codeCache));
         break;
       }
       case config::Worker::Module::COMMON_JS_MODULE: {
@@ -656,4 +662,184 @@ WorkerdApiIsolate::Global WorkerdApiIsolate::Global::clone() const {
   return result;
 }
 
+// =======================================================================================
+
+DiskModuleCodeCache::DiskModuleCodeCache(kj::Own<const kj::Directory> dir)
+    : dir(kj::mv(dir)) {}
+
+void DiskModuleCodeCache::logStats() const {
+  uint64_t hits = this->hits.load(std::memory_order_relaxed);
+  uint64_t misses = this->misses.load(std::memory_order_relaxed);
+  uint64_t rejections = this->rejections.load(std::memory_order_relaxed);
+  if (hits + misses > 0) {
+    KJ_LOG(INFO, "V8 code cache statistics", hits, misses, rejections,
+        (hits - rejections) * 100 / (hits + misses));
+  }
+}
+
+namespace {
+
+kj::String hashModuleSource(kj::ArrayPtr<const char> source) {
+  // Code cache data is only valid for the exact V8 version that produced it (V8 would reject it
+  // otherwise), so mix the version into the hash to keep versions from overwriting each other.
+  kj::StringPtr version = v8::V8::GetVersion();
+
+  SHA256_CTX ctx;
+  SHA256_Init(&ctx);
+  SHA256_Update(&ctx, version.begin(), version.size() + 1);  // include NUL as a separator
+  SHA256_Update(&ctx, source.begin(), source.size());
+  kj::byte hash[SHA256_DIGEST_LENGTH];
+  SHA256_Final(hash, &ctx);
+
+  return kj::encodeHex(kj::arrayPtr(hash, sizeof(hash)));
+}
+
+}  // namespace
+
+kj::Path DiskModuleCodeCache::getPath(kj::ArrayPtr<const char> source) const {
+  return kj::Path(kj::str(hashModuleSource(source), ".v8cache"));
+}
+
+kj::Maybe<kj::Array<const kj::byte>> DiskModuleCodeCache::get(
+    kj::ArrayPtr<const char> source) const {
+  // Failing to read the cache shouldn't fail compilation either; treat it as a miss.
+  kj::Maybe<kj::Array<const kj::byte>> result;
+  KJ_IF_MAYBE(exception, kj::runCatchingExceptions([&]() {
+    KJ_IF_MAYBE(file, dir->tryOpenFile(getPath(source))) {
+      result = kj::Array<const kj::byte>(file->get()->readAllBytes());
+    }
+  })) {
+    KJ_LOG(WARNING, "failed to read V8 code cache", *exception);
+  }
+
+  if (result == nullptr) {
+    misses.fetch_add(1, std::memory_order_relaxed);
+  } else {
+    hits.fetch_add(1, std::memory_order_relaxed);
+  }
+  return result;
+}
+
+void DiskModuleCodeCache::put(
+    kj::ArrayPtr<const char> source, kj::ArrayPtr<const kj::byte> data) const {
+  // Failing to write the cache shouldn't fail compilation.
+  KJ_IF_MAYBE(exception, kj::runCatchingExceptions([&]() {
+    auto replacer = dir->replaceFile(getPath(source),
+        kj::WriteMode::CREATE | kj::WriteMode::MODIFY);
+    replacer->get().writeAll(data);
+    replacer->commit();
+  })) {
+    KJ_LOG(WARNING, "failed to write V8 code cache", *exception);
+  }
+}
+
+void DiskModuleCodeCache::reportRejected(kj::ArrayPtr<const char> source) const {
+  rejections.fetch_add(1, std::memory_order_relaxed);
+}
+
+// =======================================================================================
+
+namespace {
+
+struct EmbeddedCodeCacheEntryHeader {
+  // Each entry in an EmbeddedModuleCodeCache section is this header followed by `size` bytes of
+  // code cache data, zero-padded to a multiple of 8 bytes. The section is a sequence of entries.
+
+  char key[SHA256_DIGEST_LENGTH * 2];  // hashModuleSource() of the module.
+  uint64_t size;
+};
+
+static_assert(sizeof(EmbeddedCodeCacheEntryHeader) % sizeof(uint64_t) == 0);
+
+size_t padToWord(size_t size) {
+  return (size + sizeof(uint64_t) - 1) & ~(sizeof(uint64_t) - 1);
+}
+
+}  // namespace
+
+EmbeddedModuleCodeCache::EmbeddedModuleCodeCache(kj::ArrayPtr<const kj::byte> section) {
+  while (section.size() > 0) {
+    EmbeddedCodeCacheEntryHeader header;
+    KJ_REQUIRE(section.size() >= sizeof(header), "embedded code cache is truncated");
+    memcpy(&header, section.begin(), sizeof(header));
+    section = section.slice(sizeof(header), section.size());
+
+    KJ_REQUIRE(header.size <= section.size(), "embedded code cache is truncated");
+    entries.upsert(kj::heapString(header.key, sizeof(header.key)),
+                   section.slice(0, header.size));
+    section = section.slice(kj::min(padToWord(header.size), section.size()), section.size());
+  }
+}
+
+kj::Array<kj::byte> EmbeddedModuleCodeCache::build(config::Config::Reader config) {
+  auto allocator = std::unique_ptr<v8::ArrayBuffer::Allocator>(
+      v8::ArrayBuffer::Allocator::NewDefaultAllocator());
+  v8::Isolate::CreateParams params;
+  params.array_buffer_allocator = allocator.get();
+
+  // A bare isolate is enough: compiling a module doesn't run any of it, so none of the Workers
+  // APIs need to exist yet.
+  v8::Isolate* isolate = v8::Isolate::New(params);
+  KJ_DEFER(isolate->Dispose());
+
+  kj::Vector<kj::byte> result;
+  kj::HashSet<kj::String> seen;
+  {
+    v8::Isolate::Scope isolateScope(isolate);
+    v8::HandleScope handleScope(isolate);
+    auto context = v8::Context::New(isolate);
+    v8::Context::Scope contextScope(context);
+
+    for (auto service: config.getServices()) {
+      if (!service.isWorker()) continue;
+      auto worker = service.getWorker();
+      if (!worker.isModules()) continue;
+
+      for (auto module: worker.getModules()) {
+        if (!module.isEsModule()) continue;
+        auto content = module.getEsModule();
+
+        auto key = hashModuleSource(content);
+        if (seen.contains(key)) continue;
+
+        v8::HandleScope moduleScope(isolate);
+        v8::TryCatch tryCatch(isolate);
+        v8::ScriptOrigin origin(isolate, jsg::v8Str(isolate, module.getName()),
+                                0, 0, false, -1, {}, false, false, true);
+        v8::ScriptCompiler::Source source(jsg::v8Str(isolate, content), origin);
+        v8::Local<v8::Module> compiled;
+        if (!v8::ScriptCompiler::CompileModule(isolate, &source).ToLocal(&compiled)) {
+          // The error will be reported with proper context when the binary runs; there's just
+          // nothing to cache for this module.
+          continue;
+        }
+
+        auto cachedData = std::unique_ptr<v8::ScriptCompiler::CachedData>(
+            v8::ScriptCompiler::CreateCodeCache(compiled->GetUnboundModuleScript()));
+        if (cachedData == nullptr) continue;
+
+        EmbeddedCodeCacheEntryHeader header;
+        KJ_ASSERT(key.size() == sizeof(header.key));
+        memcpy(header.key, key.begin(), sizeof(header.key));
+        header.size = cachedData->length;
+
+        result.addAll(kj::arrayPtr(&header, 1).asBytes());
+        result.addAll(kj::arrayPtr(cachedData->data, cachedData->length));
+        result.resize(padToWord(result.size()));
+        seen.insert(kj::mv(key));
+      }
+    }
+  }
+
+  return result.releaseAsArray();
+}
+
+kj::Maybe<kj::Array<const kj::byte>> EmbeddedModuleCodeCache::get(
+    kj::ArrayPtr<const char> source) const {
+  return entries.find(hashModuleSource(source)).map([](kj::ArrayPtr<const kj::byte> data) {
+    // The data lives as long as this object, which outlives every isolate using it.
+    return kj::Array<const kj::byte>(data.begin(), data.size(), kj::NullArrayDisposer::instance);
+  });
+}
+
 }  // namespace workerd::server
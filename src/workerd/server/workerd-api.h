@@ -6,7 +6,11 @@
 
 #include <workerd/io/worker.h>
 #include <workerd/api/analytics-engine.h>
+#include <workerd/jsg/modules.h>
 #include <workerd/server/workerd.capnp.h>
+#include <kj/filesystem.h>
+#include <kj/map.h>
+#include <atomic>
 
 namespace workerd::server {
 
@@ -15,7 +19,9 @@ class WorkerdApiIsolate final: public Worker::ApiIsolate {
 public:
   WorkerdApiIsolate(jsg::V8System& v8System,
       CompatibilityFlags::Reader features,
-      IsolateLimitEnforcer& limitEnforcer);
+      IsolateLimitEnforcer& limitEnforcer,
+      kj::Maybe<const jsg::ModuleCodeCache&> codeCache = nullptr);
+  // `codeCache`, if provided, must outlive the WorkerdApiIsolate.
   ~WorkerdApiIsolate() noexcept(false);
 
   kj::Own<jsg::Lock> lock() const override;
@@ -156,4 +162,54 @@ private:
       capnp::List<config::Extension>::Reader extensions) const;
 };
 
+class DiskModuleCodeCache final: public jsg::ModuleCodeCache {
+  // A ModuleCodeCache that keeps each module's code cache data in a file in a directory, named
+  // for a hash of the module source and the V8 version. The directory can be shared between
+  // threads and processes, since files are replaced atomically.
+public:
+  explicit DiskModuleCodeCache(kj::Own<const kj::Directory> dir);
+
+  void logStats() const;
+  // Logs the hit rate so far. The server calls this once its Workers have been constructed, which
+  // is when their modules are compiled.
+
+  kj::Maybe<kj::Array<const kj::byte>> get(kj::ArrayPtr<const char> source) const override;
+  void put(kj::ArrayPtr<const char> source, kj::ArrayPtr<const kj::byte> data) const override;
+  void reportRejected(kj::ArrayPtr<const char> source) const override;
+
+private:
+  kj::Own<const kj::Directory> dir;
+
+  mutable std::atomic<uint64_t> hits = 0;
+  mutable std::atomic<uint64_t> misses = 0;
+  mutable std::atomic<uint64_t> rejections = 0;
+
+  kj::Path getPath(kj::ArrayPtr<const char> source) const;
+};
+
+class EmbeddedModuleCodeCache final: public jsg::ModuleCodeCache {
+  // A read-only ModuleCodeCache serving code cache data that `workerd compile --code-cache`
+  // produced ahead of time and appended to the binary, so that a compiled binary doesn't have to
+  // compile its modules from source each time it starts.
+public:
+  explicit EmbeddedModuleCodeCache(kj::ArrayPtr<const kj::byte> section);
+  // `section` is the output of build(). It is not copied, so it must outlive this object. Throws
+  // if the section is malformed.
+
+  static kj::Array<kj::byte> build(config::Config::Reader config);
+  // Compiles (but doesn't evaluate) every ES module of every Worker in `config`, and returns the
+  // resulting code cache data as a section to be embedded in the binary. The size of the result
+  // is always a multiple of 8 bytes. A jsg::V8System must already have been created, with the
+  // same V8 flags the binary will run with, or V8 will reject the data at startup.
+
+  kj::Maybe<kj::Array<const kj::byte>> get(kj::ArrayPtr<const char> source) const override;
+  void put(kj::ArrayPtr<const char> source, kj::ArrayPtr<const kj::byte> data) const override {}
+  // The embedded data can't be updated. A module only gets here if its data was rejected or is
+  // missing, in which case it is compiled from source as if there were no cache.
+
+private:
+  kj::HashMap<kj::String, kj::ArrayPtr<const kj::byte>> entries;
+  // Maps hashModuleSource() of each module to its code cache data.
+};
+
 }  // namespace workerd::server
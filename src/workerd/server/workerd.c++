@@ -16,6 +16,8 @@
 #include <fcntl.h>
 #include <sys/stat.h>
 #include "server.h"
+#include "workerd-api.h"
+#include "metrics.h"
 #include <workerd/jsg/setup.h>
 #include <openssl/rand.h>
 #include <workerd/io/compatibility-date.h>
@@ -29,10 +31,16 @@
 #include <winsock2.h>
 #else
 #include <unistd.h>
+#include <netdb.h>
+#include <stddef.h>
+#include <netinet/in.h>
 #include <sys/socket.h>
 #include <sys/syscall.h>
 #include <sys/ioctl.h>
+#include <sys/un.h>
 #include <kj/async-unix.h>
+#include <kj/mutex.h>
+#include <kj/thread.h>
 #endif
 
 #if __linux__
@@ -516,7 +524,10 @@ public:
       KJ_ASSERT(size > sizeof(COMPILED_MAGIC_SUFFIX) + sizeof(uint64_t));
       kj::byte magic[sizeof(COMPILED_MAGIC_SUFFIX)];
       exe.read(size - sizeof(COMPILED_MAGIC_SUFFIX), magic);
-      if (memcmp(magic, COMPILED_MAGIC_SUFFIX, sizeof(COMPILED_MAGIC_SUFFIX)) == 0) {
+      bool hasCodeCache = memcmp(magic, COMPILED_WITH_CODE_CACHE_MAGIC_SUFFIX,
+                                 sizeof(COMPILED_WITH_CODE_CACHE_MAGIC_SUFFIX)) == 0;
+      if (hasCodeCache ||
+          memcmp(magic, COMPILED_MAGIC_SUFFIX, sizeof(COMPILED_MAGIC_SUFFIX)) == 0) {
         // Oh! It appears we are running a compiled binary, it has a config appended to the end.
         uint64_t configSize;
         exe.read(size - sizeof(COMPILED_MAGIC_SUFFIX) - sizeof(uint64_t),
@@ -533,6 +544,20 @@ public:
         config = capnp::readMessageUnchecked<config::Config>(
             reinterpret_cast<const capnp::word*>(mapping.begin()));
         configOwner = kj::heap(kj::mv(mapping));
+
+        if (hasCodeCache) {
+          // The code cache section immediately precedes the config.
+          uint64_t codeCacheSize;
+          KJ_ASSERT(offset > sizeof(uint64_t));
+          exe.read(offset - sizeof(uint64_t), kj::arrayPtr(&codeCacheSize, 1).asBytes());
+          KJ_ASSERT(offset - sizeof(uint64_t) > codeCacheSize * sizeof(capnp::word));
+          codeCacheMapping = exe.mmap(offset - sizeof(uint64_t) -
+                                      codeCacheSize * sizeof(capnp::word),
+                                      codeCacheSize * sizeof(capnp::word));
+          auto& cache = *embeddedCodeCache.emplace(
+              kj::heap<EmbeddedModuleCodeCache>(codeCacheMapping));
+          server.usePrecompiledCodeCache(cache);
+        }
       }
     } else {
       context.warning(
@@ -597,10 +622,18 @@ public:
                           "<addr> instead of the address specified in the config file.")
         .addOptionWithArg({'i', "inspector-addr"}, CLI_METHOD(enableInspector), "<addr>",
                           "Enable the inspector protocol to connect to the address <addr>.")
+        .addOptionWithArg({"code-cache-dir"}, CLI_METHOD(enableCodeCache), "<path>",
+                          "Cache compiled code for worker modules in the directory <path>, "
+                          "creating it if needed, so that subsequent runs can start faster. "
+                          "The directory may be shared by multiple workerd processes.")
         .addOption({'w', "watch"}, CLI_METHOD(watch),
                    "Watch configuration files (and server binary) and reload if they change. "
                    "Useful for development, but not recommended in production.")
-        .addOption({"experimental"}, [this]() { server.allowExperimental(); return true; },
+        .addOption({"experimental"}, [this]() {
+                     server.allowExperimental();
+                     experimental = true;
+                     return true;
+                   },
                    "Permit the use of experimental features which may break backwards "
                    "compatibility in a future release.");
   }
@@ -613,6 +646,10 @@ public:
         .addOptionWithArg({'S', "socket-fd"}, CLI_METHOD(overrideSocketFd), "<name>=<fd>",
                           "Override the socket named <name> to listen on the already-open socket "
                           "descriptor <fd> instead of the address specified in the config file.")
+        .addOptionWithArg({"threads"}, CLI_METHOD(setThreadCount), "<n>",
+                          "Serve requests on <n> threads, each with its own event loop and its "
+                          "own instance of every service, overriding the `threads` setting in "
+                          "the config file.")
         .callAfterParsing(CLI_METHOD(serve))
         .build();
   }
@@ -678,6 +715,11 @@ public:
           "Only write the encoded binary config to stdout. Do not attach it to an executable. "
           "The encoded config can be used as input to the \"serve\" command, without the need "
           "for any other files to be present.")
+        .addOption({"code-cache"}, [this]() { compileCodeCache = true; return true; },
+          "Compile every Worker's ES modules now and embed V8's compiled code for them in the "
+          "binary, so that the binary can skip compiling them from source each time it starts. "
+          "Top-level module code still runs at startup. The embedded code is only usable by "
+          "this exact version of workerd.")
         .callAfterParsing(CLI_METHOD(compile))
         .build();
   }
@@ -699,6 +741,7 @@ public:
 
   void overrideSocketAddr(kj::StringPtr param) {
     auto [ name, value ] = parseOverride(param);
+    socketAddrOverrides.upsert(kj::str(name), kj::str(value));
     server.overrideSocket(kj::mv(name), kj::str(value));
   }
 
@@ -755,24 +798,46 @@ public:
     validateSocketFd(fd, name);
 
     inheritedFds.add(fd);
+    socketFdOverrides.upsert(kj::str(name), fd);
     server.overrideSocket(kj::mv(name), io.lowLevelProvider->wrapListenSocketFd(
         fd, kj::LowLevelAsyncIoProvider::TAKE_OWNERSHIP));
   }
 
   void overrideDirectory(kj::StringPtr param) {
     auto [ name, value ] = parseOverride(param);
+    directoryOverrides.add(SavedOverride { kj::str(name), kj::str(value) });
     server.overrideDirectory(kj::mv(name), kj::str(value));
   }
 
   void overrideExternal(kj::StringPtr param) {
     auto [ name, value ] = parseOverride(param);
+    externalOverrides.add(SavedOverride { kj::str(name), kj::str(value) });
     server.overrideExternal(kj::mv(name), kj::str(value));
   }
 
+  void setThreadCount(kj::StringPtr param) {
+    uint n = KJ_UNWRAP_OR(param.tryParseAs<uint>(),
+        CLI_ERROR("Thread count must be a positive integer."));
+    if (n == 0) {
+      CLI_ERROR("Thread count must be a positive integer.");
+    }
+#if _WIN32
+    if (n > 1) {
+      CLI_ERROR("Serving on multiple threads is not yet supported on Windows.");
+    }
+#endif
+    threadCount = n;
+  }
+
   void enableInspector(kj::StringPtr param) {
     server.enableInspector(kj::str(param));
   }
 
+  void enableCodeCache(kj::StringPtr param) {
+    codeCacheDir = kj::str(param);
+    server.enableCodeCache(kj::str(param));
+  }
+
   void watch() {
 #if _WIN32
     auto& w = watcher.emplace(io.win32EventPort);
@@ -938,6 +1003,10 @@ public:
     kj::FdOutputStream out(STDOUT_FILENO);
 #endif
 
+    if (configOnly && compileCodeCache) {
+      CLI_ERROR("--code-cache can only be embedded in a binary, not used with --config-only.");
+    }
+
     if (configOnly) {
       // Write just the config -- in normal message format -- to stdout.
       uint64_t size = config.totalSize().wordCount + 1;
@@ -967,6 +1036,21 @@ public:
         }
       }
 
+      if (compileCodeCache) {
+        // Compile with the same V8 flags the binary will run with, since V8 rejects code cache
+        // data produced under different flags.
+        auto platform = jsg::defaultPlatform(0);
+        WorkerdPlatform v8Platform(*platform);
+        jsg::V8System v8System(v8Platform,
+            KJ_MAP(flag, config.getV8Flags()) -> kj::StringPtr { return flag; });
+
+        auto section = EmbeddedModuleCodeCache::build(config);
+        KJ_ASSERT(section.size() % sizeof(capnp::word) == 0);
+        uint64_t size = section.size() / sizeof(capnp::word);
+        out.write(section.begin(), section.size());
+        out.write(&size, sizeof(size));
+      }
+
       // Now write the config, plus magic suffix. We're going to write the config as a
       // single-segment flat message, which makes it easier to consume.
       {
@@ -977,7 +1061,9 @@ public:
         capnp::copyToUnchecked(config, words.slice(0, size));
 
         memcpy(&words[words.size() - 3], &size, sizeof(size));
-        memcpy(&words[words.size() - 2], COMPILED_MAGIC_SUFFIX, sizeof(COMPILED_MAGIC_SUFFIX));
+        memcpy(&words[words.size() - 2],
+               compileCodeCache ? COMPILED_WITH_CODE_CACHE_MAGIC_SUFFIX : COMPILED_MAGIC_SUFFIX,
+               sizeof(COMPILED_MAGIC_SUFFIX));
 
         out.write(words.asBytes().begin(), words.asBytes().size());
       }
@@ -1039,8 +1125,16 @@ public:
   [[noreturn]] void serve() noexcept {
     serveImpl([&](jsg::V8System& v8System, config::Config::Reader config) {
 #if _WIN32
+      if (threadCount.orDefault(config.getThreads()) > 1) {
+        context.warning("Serving on multiple threads is not yet supported on Windows, ignoring "
+                        "`threads` setting.");
+      }
       return server.run(v8System, config);
 #else
+      uint threads = threadCount.orDefault(config.getThreads());
+      if (threads > 1) {
+        return serveOnThreads(v8System, config, threads);
+      }
       return server.run(v8System, config,
           // Gracefully drain when SIGTERM is received.
           io.unixEventPort.onSignal(SIGTERM).ignoreResult());
@@ -1048,6 +1142,263 @@ public:
     });
   }
 
+#if !_WIN32
+  kj::Promise<void> serveOnThreads(jsg::V8System& v8System, config::Config::Reader config,
+                                   uint threads) {
+    // Serves the config on `threads` threads. The main thread runs `server` as usual. Each
+    // additional thread gets its own event loop and its own Server, and therefore its own isolate
+    // for every Worker. Every listen socket is opened once, here, and each thread is handed a dup
+    // of the descriptor, so that the kernel spreads incoming connections across all of the
+    // threads' accept loops.
+
+    for (auto service: config.getServices()) {
+      if (service.isWorker() && service.getWorker().getDurableObjectNamespaces().size() > 0) {
+        context.exitError(kj::str(
+            "Service \"", service.getName(), "\" defines Durable Object namespaces, which cannot "
+            "be used when serving on multiple threads, because each thread would host its own "
+            "separate instance of every object."));
+      }
+    }
+
+    sharedSockets = openSharedSockets(config);
+    server.shareMetrics(metricsRegistry);
+    for (auto& socket: sharedSockets) {
+      if (socketFdOverrides.find(socket.name) == nullptr) {
+        // (Sockets passed with --socket-fd were already given to `server`.)
+        server.overrideSocket(kj::str(socket.name), io.lowLevelProvider->wrapListenSocketFd(
+            dupFd(socket.fd.get()), kj::LowLevelAsyncIoProvider::TAKE_OWNERSHIP));
+      }
+    }
+
+    auto promises = kj::heapArrayBuilder<kj::Promise<void>>(threads);
+    promises.add(server.run(v8System, config,
+        // Gracefully drain all threads when SIGTERM is received.
+        io.unixEventPort.onSignal(SIGTERM).ignoreResult().then([this]() {
+      drainServerThreads();
+    })).then([this]() {
+      // The main server is done, so the others should be too. (This is a no-op after SIGTERM.)
+      drainServerThreads();
+    }, [this](kj::Exception&& exception) {
+      // If the main server fails, the other threads would otherwise keep serving forever, and the
+      // joinPromises() below would never complete.
+      drainServerThreads();
+      kj::throwFatalException(kj::mv(exception));
+    }));
+
+    // Starting the main server constructed every service synchronously, so any config errors have
+    // already been reported. The other threads will construct exactly the same services.
+    for (uint i = 1; i < threads; i++) {
+      // Each thread works from a private copy of the config, since a capnp reader's read limit is
+      // not safe to share across threads.
+      auto threadConfig = kj::heap<capnp::MallocMessageBuilder>();
+      threadConfig->setRoot(config);
+
+      auto paf = kj::newPromiseAndCrossThreadFulfiller<void>();
+      promises.add(kj::mv(paf.promise));
+      serverThreads.add(kj::heap<kj::Thread>(
+          [this, &v8System, threadConfig = kj::mv(threadConfig),
+           fulfiller = kj::mv(paf.fulfiller)]() mutable {
+        runServerThread(v8System, threadConfig->getRoot<config::Config>().asReader(),
+                        kj::mv(fulfiller));
+      }));
+    }
+
+    return kj::joinPromises(promises.finish());
+  }
+
+  void runServerThread(jsg::V8System& v8System, config::Config::Reader config,
+                       kj::Own<kj::CrossThreadPromiseFulfiller<void>> doneFulfiller) {
+    // Body of each additional serving thread started by serveOnThreads().
+
+    KJ_IF_MAYBE(exception, kj::runCatchingExceptions([&]() {
+      auto threadIo = kj::setupAsyncIo();
+      Server threadServer(*fs, threadIo.provider->getTimer(), threadIo.provider->getNetwork(),
+          entropySource, [](kj::String error) {
+        // The main thread already constructed the same config and would have exited on any
+        // error, so we don't expect to get here.
+        KJ_LOG(ERROR, error);
+      });
+
+      if (experimental) {
+        threadServer.allowExperimental();
+      }
+      for (auto& o: directoryOverrides) {
+        threadServer.overrideDirectory(kj::str(o.name), kj::str(o.value));
+      }
+      for (auto& o: externalOverrides) {
+        threadServer.overrideExternal(kj::str(o.name), kj::str(o.value));
+      }
+      KJ_IF_MAYBE(cache, embeddedCodeCache) {
+        threadServer.usePrecompiledCodeCache(**cache);
+      }
+      KJ_IF_MAYBE(path, codeCacheDir) {
+        threadServer.enableCodeCache(kj::str(*path));
+      }
+      threadServer.shareMetrics(metricsRegistry);
+      for (auto& socket: sharedSockets) {
+        threadServer.overrideSocket(kj::str(socket.name),
+            threadIo.lowLevelProvider->wrapListenSocketFd(
+                dupFd(socket.fd.get()), kj::LowLevelAsyncIoProvider::TAKE_OWNERSHIP));
+      }
+
+      auto drain = kj::newPromiseAndCrossThreadFulfiller<void>();
+      {
+        auto lock = serverThreadDrain.lockExclusive();
+        if (lock->draining) {
+          drain.fulfiller->fulfill();
+        } else {
+          lock->fulfillers.add(kj::mv(drain.fulfiller));
+        }
+      }
+
+      threadServer.run(v8System, config, kj::mv(drain.promise)).wait(threadIo.waitScope);
+    })) {
+      doneFulfiller->reject(kj::mv(*exception));
+    } else {
+      doneFulfiller->fulfill();
+    }
+  }
+
+  void drainServerThreads() {
+    auto lock = serverThreadDrain.lockExclusive();
+    lock->draining = true;
+    for (auto& fulfiller: lock->fulfillers) {
+      fulfiller->fulfill();
+    }
+    lock->fulfillers.clear();
+  }
+
+  struct SharedSocket {
+    // A listen socket opened by serveOnThreads(), shared by all threads.
+    kj::String name;
+    kj::AutoCloseFd fd;
+  };
+
+  kj::Vector<SharedSocket> openSharedSockets(config::Config::Reader config) {
+    kj::Vector<SharedSocket> result;
+    for (auto sock: config.getSockets()) {
+      kj::StringPtr name = sock.getName();
+      kj::StringPtr addr;
+      KJ_IF_MAYBE(fd, socketFdOverrides.find(name)) {
+        result.add(SharedSocket { kj::str(name), kj::AutoCloseFd(dupFd(*fd)) });
+        continue;
+      } else KJ_IF_MAYBE(override, socketAddrOverrides.find(name)) {
+        addr = *override;
+      } else if (sock.hasAddress()) {
+        addr = sock.getAddress();
+      } else {
+        // Server::run() will report the missing address.
+        continue;
+      }
+
+      uint defaultPort = sock.isHttps() ? 443 : 80;
+      result.add(SharedSocket { kj::str(name), bindListenSocket(addr, defaultPort) });
+    }
+    return result;
+  }
+
+  static int dupFd(int fd) {
+    int result;
+    KJ_SYSCALL(result = dup(fd));
+    return result;
+  }
+
+  static kj::AutoCloseFd bindListenSocket(kj::StringPtr addr, uint defaultPort) {
+    // Opens a listen socket on an address written in any of the formats accepted by KJ's
+    // parseAddress(). We can't just use kj::Network because it doesn't give us the descriptor,
+    // which we need in order to share the socket between threads.
+    //
+    // TODO(someday): When a host name resolves to multiple addresses, kj::Network listens on all
+    //   of them, but we only listen on the first.
+
+    bool isAbstract = addr.startsWith("unix-abstract:");
+    if (isAbstract || addr.startsWith("unix:")) {
+      auto path = addr.slice(isAbstract ? strlen("unix-abstract:") : strlen("unix:"));
+      size_t offset = isAbstract ? 1 : 0;  // abstract names are prefixed with a NUL byte
+
+      struct sockaddr_un sun;
+      memset(&sun, 0, sizeof(sun));
+      sun.sun_family = AF_UNIX;
+      KJ_REQUIRE(path.size() + offset < sizeof(sun.sun_path), "Unix socket path too long", addr);
+      memcpy(sun.sun_path + offset, path.begin(), path.size());
+      socklen_t len = offsetof(struct sockaddr_un, sun_path) + offset + path.size() +
+                      (isAbstract ? 0 : 1);
+      return openListenSocket(reinterpret_cast<struct sockaddr*>(&sun), len);
+    }
+
+    kj::String host;
+    kj::String port = kj::str(defaultPort);
+    if (addr.startsWith("[")) {
+      size_t close = KJ_REQUIRE_NONNULL(addr.findFirst(']'), "invalid address", addr);
+      host = kj::str(addr.slice(1, close));
+      auto rest = addr.slice(close + 1);
+      if (rest.startsWith(":")) {
+        port = kj::str(rest.slice(1));
+      } else {
+        KJ_REQUIRE(rest.size() == 0, "invalid address", addr);
+      }
+    } else KJ_IF_MAYBE(colon, addr.findFirst(':')) {
+      if (KJ_ASSERT_NONNULL(addr.findLast(':')) == *colon) {
+        host = kj::str(addr.slice(0, *colon));
+        port = kj::str(addr.slice(*colon + 1));
+      } else {
+        // Multiple colons without brackets: a bare IPv6 address.
+        host = kj::str(addr);
+      }
+    } else {
+      host = kj::str(addr);
+    }
+
+    bool isWildcard = host == "*";
+
+    struct addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = AI_PASSIVE;
+
+    struct addrinfo* list = nullptr;
+    int status = getaddrinfo(isWildcard ? nullptr : host.cStr(), port.cStr(), &hints, &list);
+    if (status != 0) {
+      KJ_FAIL_REQUIRE("failed to resolve listen address", addr, gai_strerror(status));
+    }
+    KJ_DEFER(freeaddrinfo(list));
+
+    // For the wildcard address, prefer IPv6 so that we accept both IPv4 and IPv6 connections,
+    // like kj::Network does.
+    struct addrinfo* chosen = list;
+    if (isWildcard) {
+      for (auto ai = list; ai != nullptr; ai = ai->ai_next) {
+        if (ai->ai_family == AF_INET6) {
+          chosen = ai;
+          break;
+        }
+      }
+    }
+
+    return openListenSocket(chosen->ai_addr, chosen->ai_addrlen);
+  }
+
+  static kj::AutoCloseFd openListenSocket(const struct sockaddr* addr, socklen_t addrlen) {
+    int fd;
+    KJ_SYSCALL(fd = socket(addr->sa_family, SOCK_STREAM, 0));
+    kj::AutoCloseFd ownFd(fd);
+
+    if (addr->sa_family == AF_INET || addr->sa_family == AF_INET6) {
+      int one = 1;
+      KJ_SYSCALL(setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one)));
+    }
+    if (addr->sa_family == AF_INET6) {
+      int zero = 0;
+      KJ_SYSCALL(setsockopt(fd, IPPROTO_IPV6, IPV6_V6ONLY, &zero, sizeof(zero)));
+    }
+
+    KJ_SYSCALL(bind(fd, addr, addrlen));
+    KJ_SYSCALL(::listen(fd, SOMAXCONN));
+    return ownFd;
+  }
+#endif
+
   [[noreturn]] void test() noexcept {
     // Always turn on info logging when running tests so that uncaught exceptions are displayed.
     // TODO(beta): This can be removed once we improve our error logging story.
@@ -1112,6 +1463,7 @@ private:
 
   bool binaryConfig = false;
   bool configOnly = false;
+  bool compileCodeCache = false;
   kj::Maybe<FileWatcher> watcher;
 
   kj::Own<kj::Filesystem> fs = kj::newDiskFilesystem();
@@ -1124,6 +1476,14 @@ private:
   kj::Vector<capnp::ConstSchema> topLevelConfigConstants;
 
   kj::Own<void> configOwner;  // backing object for `config`, if it's not `schemaParser`.
+
+  kj::Array<const kj::byte> codeCacheMapping;
+  kj::Maybe<kj::Own<EmbeddedModuleCodeCache>> embeddedCodeCache;
+  // Code cache embedded by `compile --code-cache`, if any. Declared before `server`, which
+  // (along with the Servers of any additional threads) uses it.
+  MetricsRegistry metricsRegistry;
+  // Shared by `server` and the Servers of any additional threads when serving on multiple
+  // threads, so that a `metrics` service reports totals for the process.
   kj::Maybe<config::Config::Reader> config;
 
   kj::Vector<int> inheritedFds;
@@ -1131,6 +1491,22 @@ private:
   kj::Maybe<kj::String> testServicePattern;
   kj::Maybe<kj::String> testEntrypointPattern;
 
+  bool experimental = false;
+  kj::Maybe<uint> threadCount;
+  // Overrides `threads` from the config, if given on the command line.
+
+  struct SavedOverride {
+    kj::String name;
+    kj::String value;
+  };
+  kj::Vector<SavedOverride> directoryOverrides;
+  kj::Vector<SavedOverride> externalOverrides;
+  kj::HashMap<kj::String, kj::String> socketAddrOverrides;
+  kj::HashMap<kj::String, int> socketFdOverrides;
+  kj::Maybe<kj::String> codeCacheDir;
+  // Copies of the overrides given to `server`, so that they can be applied to the Server on each
+  // additional thread when serving on multiple threads.
+
   Server server;
 
   static constexpr uint64_t COMPILED_MAGIC_SUFFIX[2] = {
@@ -1147,6 +1523,22 @@ private:
     0xa3d977fdbf547d7full
   };
 
+  static constexpr uint64_t COMPILED_WITH_CODE_CACHE_MAGIC_SUFFIX[2] = {
+    // Like COMPILED_MAGIC_SUFFIX, but identifies a binary compiled with `--code-cache`, which has
+    // an additional section between the padding and the config:
+    //
+    // - Binary executable data (copy of the Workers Runtime binary).
+    // - Padding to 8-byte boundary.
+    // - Code cache section, as produced by EmbeddedModuleCodeCache::build().
+    // - 8-byte size of code cache section, counted in 8-byte words.
+    // - Cap'n-Proto-encoded config.
+    // - 8-byte size of config, counted in 8-byte words.
+    // - 16-byte magic number COMPILED_WITH_CODE_CACHE_MAGIC_SUFFIX.
+
+    0x5f0c1d4b8e2a97c3ull,
+    0xd1e46a0b37f9c285ull
+  };
+
   struct ExeInfo {
     kj::String path;
     kj::Own<const kj::ReadableFile> file;
@@ -1238,6 +1630,19 @@ private:
 
   bool hadErrors = false;
 
+#if !_WIN32
+  kj::Vector<SharedSocket> sharedSockets;
+
+  struct ThreadDrainState {
+    bool draining = false;
+    kj::Vector<kj::Own<kj::CrossThreadPromiseFulfiller<void>>> fulfillers;
+  };
+  kj::MutexGuarded<ThreadDrainState> serverThreadDrain;
+  // Fulfillers which tell each additional serving thread to drain.
+
+  kj::Vector<kj::Own<kj::Thread>> serverThreads;
+#endif
+
   void reportParsingError(kj::StringPtr file,
       capnp::SchemaFile::SourcePos start, capnp::SchemaFile::SourcePos end,
       kj::StringPtr message) override {
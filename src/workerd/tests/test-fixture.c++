@@ -124,6 +124,8 @@ struct MockLimitEnforcer final: public LimitEnforcer {
   kj::Promise<void> limitDrain() override { return kj::NEVER_DONE; }
   kj::Promise<void> limitScheduled() override { return kj::NEVER_DONE; }
   size_t getBufferingLimit() override { return kj::maxValue; }
+  kj::Maybe<const kj::Directory&> getSpillDirectory() override { return nullptr; }
+  size_t getSpillThreshold() override { return kj::maxValue; }
   kj::Maybe<EventOutcome> getLimitsExceeded() override { return nullptr; }
   kj::Promise<void> onLimitsExceeded() override { return kj::NEVER_DONE; }
   void requireLimitsNotExceeded() override {}
@@ -0,0 +1,117 @@
+// Copyright (c) 2017-2023 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#include "byte-search.h"
+#include <kj/test.h>
+#include <kj/string.h>
+#include <algorithm>
+
+namespace workerd {
+namespace {
+
+constexpr size_t NONE = kj::maxValue;
+
+size_t orNone(kj::Maybe<size_t> index) {
+  KJ_IF_MAYBE(i, index) {
+    return *i;
+  } else {
+    return NONE;
+  }
+}
+
+size_t find(kj::StringPtr haystack, kj::StringPtr needle) {
+  return orNone(findBytes(haystack.asBytes(), needle.asBytes()));
+}
+
+size_t findLast(kj::StringPtr haystack, kj::StringPtr needle) {
+  return orNone(findLastBytes(haystack.asBytes(), needle.asBytes()));
+}
+
+KJ_TEST("findBytes() and findLastBytes() basics") {
+  KJ_EXPECT(find("", "") == 0);
+  KJ_EXPECT(findLast("", "") == 0);
+  KJ_EXPECT(find("abc", "") == 0);
+  KJ_EXPECT(findLast("abc", "") == 3);
+  KJ_EXPECT(find("abc", "abcd") == NONE);
+  KJ_EXPECT(findLast("abc", "abcd") == NONE);
+
+  KJ_EXPECT(find("abcabc", "c") == 2);
+  KJ_EXPECT(findLast("abcabc", "c") == 5);
+  KJ_EXPECT(find("abcabc", "bc") == 1);
+  KJ_EXPECT(findLast("abcabc", "bc") == 4);
+  KJ_EXPECT(find("abcabc", "abc") == 0);
+  KJ_EXPECT(findLast("abcabc", "abc") == 3);
+  KJ_EXPECT(find("abcabc", "cb") == NONE);
+  KJ_EXPECT(findLast("abcabc", "cb") == NONE);
+
+  // Long enough to go through the vector loops, with matches in the scalar tails too.
+  auto text = kj::str(kj::repeat('x', 100), "\r\n--boundary", kj::repeat('y', 100),
+                      "\r\n--boundary", kj::repeat('z', 5));
+  KJ_EXPECT(find(text, "\r\n--boundary") == 100);
+  KJ_EXPECT(findLast(text, "\r\n--boundary") == 212);
+  KJ_EXPECT(find(text, "--boundaryz") == NONE);
+  KJ_EXPECT(find(text, "boundaryzzzzz") == 216);
+  KJ_EXPECT(findLast(text, "xxx\r") == 97);
+  KJ_EXPECT(findLast(text, "xx") == 98);
+  KJ_EXPECT(find(text, "yy") == 112);
+}
+
+KJ_TEST("findBytes() and findLastBytes() agree with std::search()") {
+  uint seed = 1;
+  auto random = [&]() {
+    seed = seed * 1103515245 + 12345;
+    return seed >> 16;
+  };
+
+  for (uint i = 0; i < 20000; i++) {
+    // Small alphabets make partial matches, and so verification, common.
+    uint alphabet = 1 + random() % 4;
+    auto haystack = kj::heapArray<kj::byte>(random() % 300);
+    auto needle = kj::heapArray<kj::byte>(random() % (i % 7 == 0 ? 80 : 12));
+    for (auto& b: haystack) b = 'a' + random() % alphabet;
+    for (auto& b: needle) b = 'a' + random() % alphabet;
+    if (haystack.size() > needle.size() && random() % 2) {
+      memcpy(haystack.begin() + random() % (haystack.size() - needle.size() + 1),
+             needle.begin(), needle.size());
+    }
+
+    size_t expectedFirst = NONE;
+    size_t expectedLast = NONE;
+    if (needle.size() == 0) {
+      expectedFirst = 0;
+      expectedLast = haystack.size();
+    } else {
+      auto first = std::search(haystack.begin(), haystack.end(), needle.begin(), needle.end());
+      if (first != haystack.end()) expectedFirst = first - haystack.begin();
+      auto last = std::find_end(haystack.begin(), haystack.end(), needle.begin(), needle.end());
+      if (last != haystack.end()) expectedLast = last - haystack.begin();
+    }
+
+    KJ_EXPECT(orNone(findBytes(haystack, needle)) == expectedFirst,
+              haystack.size(), needle.size());
+    KJ_EXPECT(orNone(findLastBytes(haystack, needle)) == expectedLast,
+              haystack.size(), needle.size());
+  }
+}
+
+KJ_TEST("findBytes() stays fast on repetitive input") {
+  // Every position is a candidate that fails verification half way through the needle. Without
+  // the switch to Knuth-Morris-Pratt this would take around 400 billion byte comparisons.
+  auto haystack = kj::heapArray<kj::byte>(1 << 22);
+  memset(haystack.begin(), 'a', haystack.size());
+  auto needle = kj::heapArray<kj::byte>(200000);
+  memset(needle.begin(), 'a', needle.size());
+  needle[needle.size() / 2] = 'b';
+
+  KJ_EXPECT(findBytes(haystack, needle) == nullptr);
+  KJ_EXPECT(findLastBytes(haystack, needle) == nullptr);
+
+  size_t match = haystack.size() - needle.size() - 1;
+  haystack[match + needle.size() / 2] = 'b';
+  KJ_EXPECT(orNone(findBytes(haystack, needle)) == match);
+  KJ_EXPECT(orNone(findLastBytes(haystack, needle)) == match);
+}
+
+}  // namespace
+}  // namespace workerd
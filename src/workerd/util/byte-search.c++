@@ -0,0 +1,221 @@
+// Copyright (c) 2017-2023 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#include "byte-search.h"
+#include <kj/array.h>
+#include <string.h>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define BYTE_SEARCH_AVX2 1
+#include <immintrin.h>
+#endif
+
+namespace workerd {
+
+namespace {
+
+constexpr size_t VERIFY_SLACK = 16384;
+// How many bytes of candidate verification we tolerate beyond twice the number of positions
+// scanned before concluding that the input is adversarial and switching to knuthMorrisPratt().
+
+template <typename Text, typename Pattern>
+kj::Maybe<size_t> knuthMorrisPratt(size_t n, Text&& text, size_t m, Pattern&& pattern) {
+  // Returns the first i such that text(i + j) == pattern(j) for all j < m. Takes O(n + m) time
+  // whatever the input, unlike the candidate filter, but is several times slower on typical input.
+  // (std::boyer_moore_searcher would do, except that libstdc++ builds its tables in O(m^2) time
+  // for some patterns.)
+  auto fallback = kj::heapArray<size_t>(m);
+  fallback[0] = 0;
+  for (size_t i = 1, k = 0; i < m; i++) {
+    while (k > 0 && pattern(i) != pattern(k)) k = fallback[k - 1];
+    if (pattern(i) == pattern(k)) k++;
+    fallback[i] = k;
+  }
+
+  for (size_t i = 0, k = 0; i < n; i++) {
+    while (k > 0 && text(i) != pattern(k)) k = fallback[k - 1];
+    if (text(i) == pattern(k)) k++;
+    if (k == m) return i + 1 - m;
+  }
+  return nullptr;
+}
+
+class Search {
+  // State shared by the stages of one findBytes() or findLastBytes() call. `needle` is at least
+  // two bytes and no longer than `haystack`.
+  //
+  // Candidate start positions are numbered [0, positions). The forward search scans them in
+  // increasing order and the backward search in decreasing order; either way `scanned` counts how
+  // many have been ruled out, and `work` how many bytes have been spent verifying candidates.
+public:
+  Search(kj::ArrayPtr<const kj::byte> haystack, kj::ArrayPtr<const kj::byte> needle)
+      : haystack(haystack), needle(needle),
+        positions(haystack.size() - needle.size() + 1),
+        first(needle[0]), last(needle[needle.size() - 1]) {}
+
+  kj::Maybe<size_t> forward() {
+    kj::Maybe<size_t> result;
+#if BYTE_SEARCH_AVX2
+    if (haveAvx2()) result = forwardAvx2();
+#endif
+    if (result == nullptr) result = forwardScalar();
+    if (result == nullptr && scanned < positions) result = forwardFallback();
+    return result;
+  }
+
+  kj::Maybe<size_t> backward() {
+    kj::Maybe<size_t> result;
+#if BYTE_SEARCH_AVX2
+    if (haveAvx2()) result = backwardAvx2();
+#endif
+    if (result == nullptr) result = backwardScalar();
+    if (result == nullptr && scanned < positions) result = backwardFallback();
+    return result;
+  }
+
+private:
+  kj::ArrayPtr<const kj::byte> haystack;
+  kj::ArrayPtr<const kj::byte> needle;
+  size_t positions;
+  kj::byte first;
+  kj::byte last;
+
+  size_t scanned = 0;
+  size_t work = 0;
+
+  bool verify(size_t pos) {
+    // The first and last bytes are already known to match.
+    work += needle.size();
+    return memcmp(haystack.begin() + pos + 1, needle.begin() + 1, needle.size() - 2) == 0;
+  }
+
+  bool tooMuchWork() { return work > scanned * 2 + VERIFY_SLACK; }
+
+  kj::Maybe<size_t> forwardScalar() {
+    while (scanned < positions && !tooMuchWork()) {
+      auto found = reinterpret_cast<const kj::byte*>(
+          memchr(haystack.begin() + scanned, first, positions - scanned));
+      if (found == nullptr) {
+        scanned = positions;
+        break;
+      }
+      size_t pos = found - haystack.begin();
+      scanned = pos + 1;
+      if (haystack[pos + needle.size() - 1] == last && verify(pos)) return pos;
+    }
+    return nullptr;
+  }
+
+  kj::Maybe<size_t> backwardScalar() {
+    while (scanned < positions && !tooMuchWork()) {
+      size_t pos = positions - ++scanned;
+      if (haystack[pos] == first && haystack[pos + needle.size() - 1] == last && verify(pos)) {
+        return pos;
+      }
+    }
+    return nullptr;
+  }
+
+  kj::Maybe<size_t> forwardFallback() {
+    auto text = haystack.slice(scanned, haystack.size());
+    return knuthMorrisPratt(text.size(), [&](size_t i) { return text[i]; },
+                            needle.size(), [&](size_t i) { return needle[i]; })
+        .map([&](size_t index) { return scanned + index; });
+  }
+
+  kj::Maybe<size_t> backwardFallback() {
+    // Search backwards through the part of the haystack that hasn't been ruled out yet, i.e.
+    // among matches that start before positions - scanned, by searching forwards for the reversed
+    // needle in the reversed haystack.
+    auto text = haystack.slice(0, positions - scanned + needle.size() - 1);
+    size_t n = text.size();
+    size_t m = needle.size();
+    return knuthMorrisPratt(n, [&](size_t i) { return text[n - 1 - i]; },
+                            m, [&](size_t i) { return needle[m - 1 - i]; })
+        .map([&](size_t index) { return n - index - m; });
+  }
+
+#if BYTE_SEARCH_AVX2
+  static bool haveAvx2() {
+    static const bool result = __builtin_cpu_supports("avx2");
+    return result;
+  }
+
+  // The vector loops below rule out whole blocks of 32 candidate positions and leave the rest to
+  // the scalar loops. For a block starting at `pos` they load 32 bytes at `pos` and 32 bytes at
+  // `pos + needle.size() - 1`, both within the haystack since pos + 32 <= positions.
+
+  __attribute__((target("avx2"))) kj::Maybe<size_t> forwardAvx2() {
+    const auto firstVec = _mm256_set1_epi8(first);
+    const auto lastVec = _mm256_set1_epi8(last);
+    auto data = haystack.begin();
+
+    while (scanned + 32 <= positions && !tooMuchWork()) {
+      size_t pos = scanned;
+      auto a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + pos));
+      auto b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + pos + needle.size() - 1));
+      uint32_t mask = _mm256_movemask_epi8(
+          _mm256_and_si256(_mm256_cmpeq_epi8(a, firstVec), _mm256_cmpeq_epi8(b, lastVec)));
+      scanned += 32;
+      while (mask != 0) {
+        size_t candidate = pos + __builtin_ctz(mask);
+        if (verify(candidate)) return candidate;
+        mask &= mask - 1;
+      }
+    }
+    return nullptr;
+  }
+
+  __attribute__((target("avx2"))) kj::Maybe<size_t> backwardAvx2() {
+    const auto firstVec = _mm256_set1_epi8(first);
+    const auto lastVec = _mm256_set1_epi8(last);
+    auto data = haystack.begin();
+
+    while (scanned + 32 <= positions && !tooMuchWork()) {
+      size_t pos = positions - scanned - 32;
+      auto a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + pos));
+      auto b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + pos + needle.size() - 1));
+      uint32_t mask = _mm256_movemask_epi8(
+          _mm256_and_si256(_mm256_cmpeq_epi8(a, firstVec), _mm256_cmpeq_epi8(b, lastVec)));
+      scanned += 32;
+      while (mask != 0) {
+        uint bit = 31 - __builtin_clz(mask);
+        if (verify(pos + bit)) return pos + bit;
+        mask &= ~(1u << bit);
+      }
+    }
+    return nullptr;
+  }
+#endif  // BYTE_SEARCH_AVX2
+};
+
+}  // namespace
+
+kj::Maybe<size_t> findBytes(kj::ArrayPtr<const kj::byte> haystack,
+                            kj::ArrayPtr<const kj::byte> needle) {
+  if (needle.size() == 0) return size_t(0);
+  if (needle.size() > haystack.size()) return nullptr;
+  if (needle.size() == 1) {
+    auto found = reinterpret_cast<const kj::byte*>(
+        memchr(haystack.begin(), needle[0], haystack.size()));
+    if (found == nullptr) return nullptr;
+    return size_t(found - haystack.begin());
+  }
+  return Search(haystack, needle).forward();
+}
+
+kj::Maybe<size_t> findLastBytes(kj::ArrayPtr<const kj::byte> haystack,
+                                kj::ArrayPtr<const kj::byte> needle) {
+  if (needle.size() == 0) return haystack.size();
+  if (needle.size() > haystack.size()) return nullptr;
+  if (needle.size() == 1) {
+    for (size_t i = haystack.size(); i-- > 0;) {
+      if (haystack[i] == needle[0]) return i;
+    }
+    return nullptr;
+  }
+  return Search(haystack, needle).backward();
+}
+
+}  // namespace workerd
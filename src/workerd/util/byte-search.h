@@ -0,0 +1,32 @@
+// Copyright (c) 2017-2023 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#pragma once
+
+#include <kj/common.h>
+
+namespace workerd {
+
+kj::Maybe<size_t> findBytes(kj::ArrayPtr<const kj::byte> haystack,
+                            kj::ArrayPtr<const kj::byte> needle);
+// Returns the offset of the first occurrence of `needle` in `haystack`, or null if there is none.
+// An empty needle is found at offset 0.
+//
+// On x86-64 CPUs with AVX2, candidate positions are found 32 at a time by comparing against both
+// the first and the last byte of the needle, and only those are verified with memcmp(); elsewhere
+// the same filter is applied one position at a time, after memchr() finds the first byte. If the
+// haystack turns out to be so repetitive that verification dominates, the rest of the search
+// switches to Knuth-Morris-Pratt, so the worst case is linear rather than O(haystack * needle).
+
+kj::Maybe<size_t> findLastBytes(kj::ArrayPtr<const kj::byte> haystack,
+                                kj::ArrayPtr<const kj::byte> needle);
+// Like findBytes(), but returns the offset of the last occurrence. An empty needle is found at
+// haystack.size().
+
+inline kj::Maybe<size_t> findBytes(kj::ArrayPtr<const char> haystack,
+                                   kj::ArrayPtr<const char> needle) {
+  return findBytes(haystack.asBytes(), needle.asBytes());
+}
+
+}  // namespace workerd
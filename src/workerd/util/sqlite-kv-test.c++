@@ -4,6 +4,7 @@
 
 #include "sqlite-kv.h"
 #include <kj/test.h>
+#include <kj/map.h>
 
 namespace workerd {
 namespace {
@@ -91,5 +92,54 @@ KJ_TEST("SQLite-KV") {
   KJ_EXPECT(list(nullptr, nullptr, nullptr, F) == "");
 }
 
+KJ_TEST("SQLite-KV multi-key operations") {
+  auto dir = kj::newInMemoryDirectory(kj::nullClock());
+  SqliteDatabase::Vfs vfs(*dir);
+  SqliteDatabase db(vfs, kj::Path({"foo"}), kj::WriteMode::CREATE | kj::WriteMode::MODIFY);
+  SqliteKv kv(db);
+
+  struct Pair {
+    kj::String key;
+    kj::Array<const byte> value;
+  };
+
+  // Use a count that isn't a power of two and exceeds MAX_BATCH, so that we exercise several
+  // statement arities.
+  constexpr uint COUNT = SqliteKv::MAX_BATCH * 2 + 5;
+  auto pairsBuilder = kj::heapArrayBuilder<Pair>(COUNT + 1);
+  for (uint i = 0; i < COUNT; i++) {
+    pairsBuilder.add(Pair { kj::str("key", i), kj::heapArray(kj::str("value", i).asBytes()) });
+  }
+  // Duplicate keys in one batch: the last value wins.
+  pairsBuilder.add(Pair { kj::str("key0"), kj::heapArray("replaced"_kj.asBytes()) });
+  auto pairs = pairsBuilder.finish();
+  kv.putMultiple(pairs.asPtr());
+
+  auto keysBuilder = kj::heapArrayBuilder<kj::String>(COUNT + 1);
+  for (uint i = 0; i <= COUNT; i++) {
+    keysBuilder.add(kj::str("key", i));  // includes one key that doesn't exist
+  }
+  auto keys = keysBuilder.finish();
+
+  kj::HashMap<kj::String, kj::String> seen;
+  KJ_EXPECT(kv.getMultiple(keys.asPtr(), [&](kj::StringPtr key, kj::ArrayPtr<const byte> value) {
+    seen.insert(kj::str(key), kj::str(value.asChars()));
+  }) == COUNT);
+  KJ_EXPECT(seen.size() == COUNT);
+  KJ_EXPECT(KJ_ASSERT_NONNULL(seen.find("key0"_kj)) == "replaced");
+  KJ_EXPECT(KJ_ASSERT_NONNULL(seen.find("key1"_kj)) == "value1");
+  KJ_EXPECT(KJ_ASSERT_NONNULL(seen.find(kj::str("key", COUNT - 1))) == kj::str("value", COUNT - 1));
+
+  KJ_EXPECT(kv.deleteMultiple(keys.slice(1, COUNT + 1)) == COUNT - 1);
+  KJ_EXPECT(kv.getMultiple(keys.asPtr(), [&](kj::StringPtr key, kj::ArrayPtr<const byte>) {
+    KJ_EXPECT(key == "key0");
+  }) == 1);
+
+  auto noKeys = kj::ArrayPtr<kj::String>();
+  KJ_EXPECT(kv.getMultiple(noKeys, [&](kj::StringPtr, kj::ArrayPtr<const byte>) {
+    KJ_FAIL_EXPECT("should not call callback for empty batch");
+  }) == 0);
+}
+
 }  // namespace
 }  // namespace workerd
@@ -36,4 +36,40 @@ uint SqliteKv::deleteAll() {
   return query.changeCount();
 }
 
+SqliteDatabase::Statement& SqliteKv::getMultiStatement(MultiOp op, uint arityLog2) {
+  KJ_REQUIRE(arityLog2 <= MAX_BATCH_LOG2);
+  auto& slot = multiStatements[op][arityLog2];
+  KJ_IF_MAYBE(stmt, slot) {
+    return **stmt;
+  }
+
+  auto placeholders = [&](kj::StringPtr placeholder) {
+    auto array = kj::heapArray<kj::StringPtr>(1u << arityLog2);
+    for (auto& p: array) p = placeholder;
+    return kj::strArray(array, ", ");
+  };
+
+  kj::String sql;
+  switch (op) {
+    case MULTI_GET:
+      sql = kj::str("SELECT key, value FROM _cf_KV WHERE key IN (", placeholders("?"), ") "
+                    "ORDER BY key");
+      break;
+    case MULTI_PUT:
+      sql = kj::str("INSERT INTO _cf_KV VALUES ", placeholders("(?, ?)"),
+          " ON CONFLICT DO UPDATE SET value = excluded.value");
+      break;
+    case MULTI_DELETE:
+      sql = kj::str("DELETE FROM _cf_KV WHERE key IN (", placeholders("?"), ")");
+      break;
+    case MULTI_OP_COUNT:
+      KJ_UNREACHABLE;
+  }
+
+  auto stmt = kj::heap(db.prepare(SqliteDatabase::TRUSTED, sql));
+  auto& result = *stmt;
+  slot = kj::mv(stmt);
+  return result;
+}
+
 }  // namespace workerd
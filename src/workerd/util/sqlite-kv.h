@@ -5,6 +5,7 @@
 #pragma once
 
 #include "sqlite.h"
+#include <kj/vector.h>
 
 namespace workerd {
 
@@ -49,14 +50,59 @@ public:
 
   uint deleteAll();
 
-  // TODO(perf): Should we provide multi-get, multi-put, and multi-delete? It's a bit tricky to
-  //   implement them as single SQL queries, while still using prepared statements. The c-array
-  //   extension might help here, though it can only support arrays of NUL-terminated strings, not
-  //   byte blobs or strings containing NUL bytes.
+  template <typename Key, typename Func>
+  uint getMultiple(kj::ArrayPtr<Key> keys, Func&& callback);
+  // Look up several keys at once, calling the callback (with KeyPtr and ValuePtr parameters) for
+  // each one found. Returns the number of matches. Each element of `keys` must be convertible to
+  // KeyPtr. If `keys` is sorted and has no duplicates, the matches are reported in key order.
+
+  template <typename Pair>
+  void putMultiple(kj::ArrayPtr<Pair> pairs);
+  // Store several values at once. Each element of `pairs` must have a `key` member convertible to
+  // KeyPtr and a `value` member with an `asPtr()` returning ValuePtr. If a key appears more than
+  // once, the last value wins.
+
+  template <typename Key>
+  uint deleteMultiple(kj::ArrayPtr<Key> keys);
+  // Delete several keys at once, returning how many were matched.
+
+  // The multi-key operations bind many keys into a single statement rather than running a
+  // single-key statement per key. Statements are prepared lazily for each power-of-two arity up to
+  // MAX_BATCH; a batch whose size isn't a power of two is split into a few statements, so a batch
+  // of N keys runs at most log2(N)+1 statements, plus one per MAX_BATCH keys beyond the first
+  // MAX_BATCH. (The carray extension isn't used because it can't bind blobs or strings
+  // containing NUL bytes.)
+
+  static constexpr uint MAX_BATCH_LOG2 = 7;
+  static constexpr uint MAX_BATCH = 1u << MAX_BATCH_LOG2;
 
 private:
   SqliteDatabase& db;
 
+  enum MultiOp {
+    MULTI_GET,
+    MULTI_PUT,
+    MULTI_DELETE,
+    MULTI_OP_COUNT
+  };
+
+  kj::Maybe<kj::Own<SqliteDatabase::Statement>>
+      multiStatements[MULTI_OP_COUNT][MAX_BATCH_LOG2 + 1];
+  // Lazily-prepared statements for the multi-key operations, indexed by op and log2(arity).
+
+  kj::Vector<SqliteDatabase::Query::ValuePtr> multiBindings;
+  // Scratch space for building bindings, reused to avoid allocating on every call.
+
+  kj::ArrayPtr<const SqliteDatabase::Query::ValuePtr> getMultiBindings() { return multiBindings; }
+
+  SqliteDatabase::Statement& getMultiStatement(MultiOp op, uint arityLog2);
+  // Get (preparing if needed) the statement for `op` taking 2^arityLog2 keys.
+
+  template <typename Func>
+  void forEachBatch(size_t count, Func&& func);
+  // Split `count` items into batches of power-of-two sizes no greater than MAX_BATCH, calling
+  // `func(offset, arityLog2)` for each.
+
   SqliteDatabase::Statement stmtGet = db.prepare(R"(
     SELECT value FROM _cf_KV WHERE key = ?
   )");
@@ -184,4 +230,60 @@ uint SqliteKv::list(KeyPtr begin, kj::Maybe<KeyPtr> end, kj::Maybe<uint> limit,
   }
 }
 
+template <typename Func>
+void SqliteKv::forEachBatch(size_t count, Func&& func) {
+  size_t offset = 0;
+  while (offset < count) {
+    size_t remaining = count - offset;
+    uint arityLog2 = MAX_BATCH_LOG2;
+    while ((size_t(1) << arityLog2) > remaining) --arityLog2;
+    func(offset, arityLog2);
+    offset += size_t(1) << arityLog2;
+  }
+}
+
+template <typename Key, typename Func>
+uint SqliteKv::getMultiple(kj::ArrayPtr<Key> keys, Func&& callback) {
+  uint count = 0;
+  forEachBatch(keys.size(), [&](size_t offset, uint arityLog2) {
+    multiBindings.clear();
+    for (auto& key: keys.slice(offset, offset + (size_t(1) << arityLog2))) {
+      multiBindings.add(KeyPtr(key));
+    }
+    auto query = getMultiStatement(MULTI_GET, arityLog2).run(getMultiBindings());
+    while (!query.isDone()) {
+      callback(query.getText(0), query.getBlob(1));
+      query.nextRow();
+      ++count;
+    }
+  });
+  return count;
+}
+
+template <typename Pair>
+void SqliteKv::putMultiple(kj::ArrayPtr<Pair> pairs) {
+  forEachBatch(pairs.size(), [&](size_t offset, uint arityLog2) {
+    multiBindings.clear();
+    for (auto& pair: pairs.slice(offset, offset + (size_t(1) << arityLog2))) {
+      multiBindings.add(KeyPtr(pair.key));
+      multiBindings.add(ValuePtr(pair.value.asPtr()));
+    }
+    getMultiStatement(MULTI_PUT, arityLog2).run(getMultiBindings());
+  });
+}
+
+template <typename Key>
+uint SqliteKv::deleteMultiple(kj::ArrayPtr<Key> keys) {
+  uint count = 0;
+  forEachBatch(keys.size(), [&](size_t offset, uint arityLog2) {
+    multiBindings.clear();
+    for (auto& key: keys.slice(offset, offset + (size_t(1) << arityLog2))) {
+      multiBindings.add(KeyPtr(key));
+    }
+    auto query = getMultiStatement(MULTI_DELETE, arityLog2).run(getMultiBindings());
+    count += query.changeCount();
+  });
+  return count;
+}
+
 }  // namespace workerd
@@ -294,6 +294,7 @@ bool SqliteDatabase::isAuthorized(int actionCode,
              regulator.isAllowedName(KJ_ASSERT_NONNULL(param2));
 
     case SQLITE_TRANSACTION        :   /* Operation       NULL            */
+      if (!regulator.isAllowedTransactionControl()) return false;
       {
         // Verify param1 is one of the values we expect.
         kj::StringPtr op = KJ_ASSERT_NONNULL(param1);
@@ -303,6 +304,7 @@ bool SqliteDatabase::isAuthorized(int actionCode,
       return true;
 
     case SQLITE_SAVEPOINT          :   /* Operation       Savepoint Name  */
+      if (!regulator.isAllowedTransactionControl()) return false;
       {
         // Verify param1 is one of the values we expect.
         kj::StringPtr op = KJ_ASSERT_NONNULL(param1);
@@ -118,6 +118,11 @@ public:
   //   created, but how do we track that? In practice we probably never expect triggers to run on
   //   trusted queries.
 
+  virtual bool isAllowedTransactionControl() { return true; }
+  // Returns whether statements that begin, commit, or roll back a transaction or savepoint are
+  // allowed. Denied when the database's transactions are managed by the caller, as ActorSqlite
+  // does, since application-issued BEGIN or COMMIT would interfere with them.
+
   virtual void onError(kj::StringPtr message) {}
   // Report that an error occurred. `message` is the detail message constructed by SQLite. This
   // function should typically throw an exception. If no exception is thrown, a simple KJ exception